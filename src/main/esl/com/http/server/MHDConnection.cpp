@@ -0,0 +1,34 @@
+#include <esl/com/http/server/MHDConnection.h>
+
+#include <mhd4esl/com/http/server/Connection.h>
+#include <mhd4esl/com/http/server/Native.h>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+using mhd4esl::com::http::server::getNative;
+
+bool MHDConnection::send(Connection& connection, const Response& response, const std::vector<Segment>& segments, std::shared_ptr<const void> owner) {
+	return getNative(connection).send(response, segments, std::move(owner));
+}
+
+bool MHDConnection::sendMapped(Connection& connection, const Response& response, std::shared_ptr<const void> data, std::size_t size) {
+	return getNative(connection).sendMapped(response, std::move(data), size);
+}
+
+std::shared_ptr<MHDConnection::Notifier> MHDConnection::sendNotifiable(Connection& connection, const Response& response, esl::io::Output output) {
+	return getNative(connection).sendNotifiable(response, std::move(output));
+}
+
+std::shared_ptr<const void> MHDConnection::mapFile(const std::string& path, std::size_t& size) {
+	return mhd4esl::com::http::server::Connection::mapFile(path, size);
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
@@ -0,0 +1,58 @@
+#ifndef ESL_COM_HTTP_SERVER_MHDCONNECTION_H_
+#define ESL_COM_HTTP_SERVER_MHDCONNECTION_H_
+
+#include <esl/com/http/server/Connection.h>
+#include <esl/com/http/server/Response.h>
+#include <esl/io/Output.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Extensions for connections of MHDSocket. Using them with any other connection throws an exception. */
+class MHDConnection {
+public:
+	struct Segment {
+		const void* data;
+		std::size_t size;
+	};
+
+	/* Wakes up a streamed body whose reader has returned 0 because it had no data yet. It can be called from any thread. */
+	class Notifier {
+	public:
+		virtual ~Notifier() = default;
+
+		virtual void notify() = 0;
+	};
+
+	MHDConnection() = delete;
+
+	/* Sends all segments as one body without concatenating them. Segments must stay valid
+	 * until the response has been destroyed. If owner is set, it is released at this time. */
+	static bool send(Connection& connection, const Response& response, const std::vector<Segment>& segments, std::shared_ptr<const void> owner = nullptr);
+
+	/* Sends data without copying it. The reference to data is released when the response has been destroyed. */
+	static bool sendMapped(Connection& connection, const Response& response, std::shared_ptr<const void> data, std::size_t size);
+
+	/* Sends output as streamed body. If its reader returns 0, the connection waits without calling
+	 * the reader again until notify() of the returned notifier is called. Returns nullptr if it fails. */
+	static std::shared_ptr<Notifier> sendNotifiable(Connection& connection, const Response& response, esl::io::Output output);
+
+	/* Maps a file read only into memory. The mapping is released with the last reference. */
+	static std::shared_ptr<const void> mapFile(const std::string& path, std::size_t& size);
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
+
+#endif /* ESL_COM_HTTP_SERVER_MHDCONNECTION_H_ */
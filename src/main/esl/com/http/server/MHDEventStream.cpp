@@ -0,0 +1,34 @@
+#include <esl/com/http/server/MHDEventStream.h>
+#include <esl/system/Stacktrace.h>
+
+#include <mhd4esl/com/http/server/Connection.h>
+#include <mhd4esl/com/http/server/EventStream.h>
+#include <mhd4esl/com/http/server/Native.h>
+
+#include <stdexcept>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+using mhd4esl::com::http::server::getNative;
+
+std::shared_ptr<MHDEventStream::Sink> MHDEventStream::send(Connection& connection) {
+	return send(connection, Settings());
+}
+
+std::shared_ptr<MHDEventStream::Sink> MHDEventStream::send(Connection& connection, const Settings& settings) {
+	std::shared_ptr<mhd4esl::com::http::server::EventStream> eventStream = getNative(connection).sendEventStream(settings);
+	if(!eventStream) {
+		throw system::Stacktrace::add(std::runtime_error("Cannot send event stream"));
+	}
+	return eventStream;
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
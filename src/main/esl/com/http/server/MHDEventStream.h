@@ -0,0 +1,61 @@
+#ifndef ESL_COM_HTTP_SERVER_MHDEVENTSTREAM_H_
+#define ESL_COM_HTTP_SERVER_MHDEVENTSTREAM_H_
+
+#include <esl/com/http/server/Connection.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Server-Sent Events for connections of MHDSocket. Using it with any other connection throws an exception.
+ * Idle streams do not occupy a thread of MHDSocket, except if MHDSocket uses a thread per connection. */
+class MHDEventStream {
+public:
+	struct Settings {
+		/* a comment is sent if nothing has been sent for this time, 0 disables heartbeats */
+		unsigned int heartbeatSeconds = 15;
+
+		/* maximum size of events waiting to be sent. Sink::push returns false if it would be exceeded. */
+		std::size_t maxQueueSize = 1024 * 1024;
+
+		/* value of field "retry" sent before the first event, 0 means none */
+		unsigned int retryMs = 0;
+
+		/* an event replaces a waiting event of the same type instead of being queued behind it */
+		bool coalesce = false;
+	};
+
+	class Sink {
+	public:
+		virtual ~Sink() = default;
+
+		/* Thread safe. Returns false if the stream is closed or if the queue is full. */
+		virtual bool push(const std::string& data, const std::string& event = "", const std::string& id = "") = 0;
+
+		/* Thread safe. The response ends after all waiting events have been sent. */
+		virtual void close() = 0;
+
+		/* true if the stream has been closed or the client has disconnected */
+		virtual bool isClosed() const noexcept = 0;
+	};
+
+	MHDEventStream() = delete;
+
+	/* Queues a response with content type "text/event-stream" and returns the sink for its events. */
+	static std::shared_ptr<Sink> send(Connection& connection);
+	static std::shared_ptr<Sink> send(Connection& connection, const Settings& settings);
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
+
+#endif /* ESL_COM_HTTP_SERVER_MHDEVENTSTREAM_H_ */
@@ -0,0 +1,90 @@
+#include <esl/com/http/server/MHDIntrospection.h>
+#include <esl/com/http/server/Response.h>
+#include <esl/io/output/String.h>
+#include <esl/utility/MIME.h>
+
+#include <mhd4esl/com/http/server/Json.h>
+
+#include <chrono>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+void appendMilliseconds(std::string& json, std::chrono::steady_clock::duration duration) {
+	json += std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+}
+}
+
+MHDIntrospection::MHDIntrospection(const MHDSocket& aSocket)
+: socket(aSocket)
+{ }
+
+io::Input MHDIntrospection::accept(RequestContext& requestContext) const {
+	Response response(200, utility::MIME::Type::applicationJson);
+	response.addHeader("Cache-Control", "no-store");
+	requestContext.getConnection().send(response, io::output::String::create(toJson(socket.getIntrospection())));
+	return io::Input();
+}
+
+std::string MHDIntrospection::toJson(const MHDSocket::Introspection& introspection) {
+	std::string json;
+	json.reserve(256 + introspection.connections.size() * 256);
+
+	json += "{\"currentConnections\":";
+	json += std::to_string(introspection.currentConnections);
+	json += ",\"connectionLimit\":";
+	json += std::to_string(introspection.connectionLimit);
+	json += ",\"threadPerConnection\":";
+	json += introspection.threadPerConnection ? "true" : "false";
+	json += ",\"externalLoop\":";
+	json += introspection.externalLoop ? "true" : "false";
+	json += ",\"pollingThreads\":";
+	json += std::to_string(introspection.pollingThreads);
+	json += ",\"handlerThreads\":";
+	json += std::to_string(introspection.handlerThreads);
+	json += ",\"pendingHandlerTasks\":";
+	json += std::to_string(introspection.pendingHandlerTasks);
+	json += ",\"fileReadAhead\":";
+	mhd4esl::com::http::server::Json::appendString(json, introspection.fileReadAhead);
+	json += ",\"connections\":[";
+
+	bool first = true;
+	for(const auto& connection : introspection.connections) {
+		json += first ? "{\"state\":" : ",{\"state\":";
+		first = false;
+
+		mhd4esl::com::http::server::Json::appendString(json, connection.state);
+		json += ",\"stateAge\":";
+		appendMilliseconds(json, connection.stateAge);
+		json += ",\"age\":";
+		appendMilliseconds(json, connection.age);
+		json += ",\"remoteAddress\":";
+		mhd4esl::com::http::server::Json::appendString(json, connection.remoteAddress);
+		json += ",\"remotePort\":";
+		json += std::to_string(connection.remotePort);
+		json += ",\"requests\":";
+		json += std::to_string(connection.requests);
+		json += ",\"bodyBytesReceived\":";
+		json += std::to_string(connection.bodyBytesReceived);
+		if(!connection.tlsProtocol.empty()) {
+			json += ",\"tlsProtocol\":";
+			mhd4esl::com::http::server::Json::appendString(json, connection.tlsProtocol);
+			json += ",\"tlsCipher\":";
+			mhd4esl::com::http::server::Json::appendString(json, connection.tlsCipher);
+		}
+		json += '}';
+	}
+	json += "]}";
+
+	return json;
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
@@ -0,0 +1,38 @@
+#ifndef ESL_COM_HTTP_SERVER_MHDINTROSPECTION_H_
+#define ESL_COM_HTTP_SERVER_MHDINTROSPECTION_H_
+
+#include <esl/com/http/server/MHDSocket.h>
+#include <esl/com/http/server/RequestContext.h>
+#include <esl/com/http/server/RequestHandler.h>
+#include <esl/io/Input.h>
+
+#include <string>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Request handler that answers every request with MHDSocket::getIntrospection() of a socket as JSON.
+ * It exposes the addresses of all clients, so it should be routed to a path that is not public. */
+class MHDIntrospection : public RequestHandler {
+public:
+	MHDIntrospection(const MHDSocket& socket);
+
+	io::Input accept(RequestContext& requestContext) const override;
+
+	/* durations are in milliseconds */
+	static std::string toJson(const MHDSocket::Introspection& introspection);
+
+private:
+	const MHDSocket& socket;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
+
+#endif /* ESL_COM_HTTP_SERVER_MHDINTROSPECTION_H_ */
@@ -0,0 +1,38 @@
+#include <esl/com/http/server/MHDRequest.h>
+
+#include <mhd4esl/com/http/server/ClientCertificateCache.h>
+#include <mhd4esl/com/http/server/Native.h>
+#include <mhd4esl/com/http/server/Request.h>
+#include <mhd4esl/com/http/server/RequestContext.h>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+using mhd4esl::com::http::server::getNative;
+
+MHDRequest::Address MHDRequest::getRemoteAddress(const Request& request) {
+	return getNative(request).getRemoteAddressBinary();
+}
+
+std::string MHDRequest::getClientCertificateSubject(const Request& request) {
+	const std::shared_ptr<const mhd4esl::com::http::server::ClientCertificate>& clientCertificate = getNative(request).getClientCertificate();
+	return clientCertificate ? clientCertificate->subject : std::string();
+}
+
+std::string MHDRequest::getClientCertificateFingerprint(const Request& request) {
+	const std::shared_ptr<const mhd4esl::com::http::server::ClientCertificate>& clientCertificate = getNative(request).getClientCertificate();
+	return clientCertificate ? clientCertificate->fingerprint : std::string();
+}
+
+void MHDRequest::setMaxBodySize(RequestContext& requestContext, std::uint64_t maxBodySize) {
+	getNative(requestContext).setMaxBodySize(maxBodySize);
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
@@ -0,0 +1,57 @@
+#ifndef ESL_COM_HTTP_SERVER_MHDREQUEST_H_
+#define ESL_COM_HTTP_SERVER_MHDREQUEST_H_
+
+#include <esl/com/http/server/Request.h>
+#include <esl/com/http/server/RequestContext.h>
+
+#include <cstdint>
+#include <string>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Extensions for requests of MHDSocket. Using them with any other request throws an exception. */
+class MHDRequest {
+public:
+	/* IPv4 addresses use the first 4 bytes. IPv4-mapped IPv6 addresses are converted to IPv4. */
+	struct Address {
+		enum class Family : std::uint8_t {
+			unknown,
+			ipv4,
+			ipv6
+		};
+
+		Family family = Family::unknown;
+		std::uint8_t bytes[16] = {};
+
+		std::uint8_t getSize() const noexcept {
+			return family == Family::ipv4 ? 4 : (family == Family::ipv6 ? 16 : 0);
+		}
+	};
+
+	MHDRequest() = delete;
+
+	static Address getRemoteAddress(const Request& request);
+
+	/* Verified client certificate of a socket with "tls-client-auth". Both are empty if the client has not sent a
+	 * valid certificate. The subject is the distinguished name in RFC 4514 format, the fingerprint is the
+	 * lowercase hex SHA-256 hash of the DER encoded certificate. */
+	static std::string getClientCertificateSubject(const Request& request);
+	static std::string getClientCertificateFingerprint(const Request& request);
+
+	/* Replaces the maximum body size of the socket for this request, 0 means unlimited. It is called by
+	 * request handlers before they return an input. Throws exception::StatusCode(413) if the value of
+	 * header "Content-Length" exceeds the limit, so the body is not read at all. */
+	static void setMaxBodySize(RequestContext& requestContext, std::uint64_t maxBodySize);
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
+
+#endif /* ESL_COM_HTTP_SERVER_MHDREQUEST_H_ */
@@ -0,0 +1,95 @@
+#include <esl/com/http/server/MHDResponseCache.h>
+#include <esl/system/Stacktrace.h>
+#include <esl/utility/String.h>
+
+#include <mhd4esl/com/http/server/ResponseCache.h>
+
+#include <stdexcept>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+MHDResponseCache::Settings::Settings(const std::vector<std::pair<std::string, std::string>>& settings) {
+	bool hasShards = false;
+	bool hasMaxEntries = false;
+	bool hasMaxSize = false;
+	bool hasMaxEntrySize = false;
+
+	for(const auto& setting : settings) {
+		if(setting.first == "shards") {
+			if(hasShards) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'shards'."));
+			}
+			hasShards = true;
+
+			shards = utility::String::toNumber<std::size_t>(setting.second);
+		    if(shards == 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+		}
+		else if(setting.first == "max-entries") {
+			if(hasMaxEntries) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'max-entries'."));
+			}
+			hasMaxEntries = true;
+
+			maxEntries = utility::String::toNumber<std::size_t>(setting.second);
+		    if(maxEntries == 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+		}
+		else if(setting.first == "max-size") {
+			if(hasMaxSize) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'max-size'."));
+			}
+			hasMaxSize = true;
+
+			maxSize = utility::String::toNumber<std::size_t>(setting.second);
+		    if(maxSize == 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+		}
+		else if(setting.first == "max-entry-size") {
+			if(hasMaxEntrySize) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'max-entry-size'."));
+			}
+			hasMaxEntrySize = true;
+
+			maxEntrySize = utility::String::toNumber<std::size_t>(setting.second);
+		}
+		else if(setting.first == "vary") {
+			if(setting.second.empty()) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+			}
+			varyHeaders.push_back(setting.second);
+		}
+		else {
+			throw system::Stacktrace::add(std::runtime_error("Key \"" + setting.first + "\" is unknown"));
+		}
+	}
+
+	if(shards > maxEntries) {
+    	throw system::Stacktrace::add(std::runtime_error("Value of \"shards\" must not be greater than \"max-entries\""));
+	}
+}
+
+MHDResponseCache::MHDResponseCache(const Settings& settings, const RequestHandler& requestHandler)
+: responseCache(new mhd4esl::com::http::server::ResponseCache(settings, requestHandler))
+{ }
+
+io::Input MHDResponseCache::accept(RequestContext& requestContext) const {
+	return responseCache->accept(requestContext);
+}
+
+void MHDResponseCache::clear() {
+	static_cast<mhd4esl::com::http::server::ResponseCache&>(*responseCache).clear();
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
@@ -0,0 +1,62 @@
+#ifndef ESL_COM_HTTP_SERVER_MHDRESPONSECACHE_H_
+#define ESL_COM_HTTP_SERVER_MHDRESPONSECACHE_H_
+
+#include <esl/com/http/server/RequestContext.h>
+#include <esl/com/http/server/RequestHandler.h>
+#include <esl/io/Input.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* In-process cache for GET requests in front of another request handler.
+ * Responses are cached only if the handler sets "Cache-Control" with "max-age" or "s-maxage".
+ * Requests with "Authorization" are never served from the cache and their responses are stored only
+ * if "Cache-Control" contains "public", "s-maxage" or "must-revalidate".
+ * Entries are separated by scheme, "Host" header, path, query arguments and the vary headers of the settings.
+ * Concurrent requests for the same uncached key that run on handler threads wait for a single call of
+ * the request handler. Requests on threads of MHD call the request handler on their own, because waiting
+ * would block the other connections of the thread. So misses are coalesced only if the socket has
+ * "handler-threads" greater than 0; with the default of 0 every concurrent miss calls the request handler.
+ * If the socket uses "auto-etag", the ETag of a cached response is created once when it is stored and
+ * "If-None-Match" is answered with status 304 for hits as well as for misses. */
+class MHDResponseCache : public RequestHandler {
+public:
+	struct Settings {
+		Settings() = default;
+		Settings(const std::vector<std::pair<std::string, std::string>>& settings);
+
+		std::size_t shards = 16;
+		std::size_t maxEntries = 10000;
+		std::size_t maxSize = 64 * 1024 * 1024;
+		std::size_t maxEntrySize = 1024 * 1024;
+
+		/* request headers that are part of the cache key */
+		std::vector<std::string> varyHeaders;
+	};
+
+	MHDResponseCache(const Settings& settings, const RequestHandler& requestHandler);
+
+	io::Input accept(RequestContext& requestContext) const override;
+
+	void clear();
+
+private:
+	std::unique_ptr<RequestHandler> responseCache;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
+
+#endif /* ESL_COM_HTTP_SERVER_MHDRESPONSECACHE_H_ */
@@ -0,0 +1,79 @@
+#include <esl/com/http/server/MHDRouter.h>
+#include <esl/system/Stacktrace.h>
+
+#include <mhd4esl/com/http/server/Router.h>
+
+#include <stdexcept>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+const std::string* findParameter(const RequestContext& requestContext, const std::string& name, std::string::size_type& offset, std::string::size_type& length) noexcept {
+	const mhd4esl::com::http::server::Router::Parameters* parameters = mhd4esl::com::http::server::Router::getParameters(requestContext);
+	if(parameters == nullptr) {
+		return nullptr;
+	}
+
+	for(std::size_t i = 0; i < parameters->size && i < parameters->names->size(); ++i) {
+		if((*parameters->names)[i] == name) {
+			offset = parameters->slots[i].first;
+			length = parameters->slots[i].second;
+			return &requestContext.getPath();
+		}
+	}
+
+	return nullptr;
+}
+}
+
+MHDRouter::MHDRouter()
+: router(new mhd4esl::com::http::server::Router)
+{ }
+
+void MHDRouter::add(const std::string& method, const std::string& pattern, const RequestHandler& requestHandler) {
+	static_cast<mhd4esl::com::http::server::Router&>(*router).add(method, pattern, requestHandler);
+}
+
+void MHDRouter::build() {
+	static_cast<mhd4esl::com::http::server::Router&>(*router).build();
+}
+
+io::Input MHDRouter::accept(RequestContext& requestContext) const {
+	return router->accept(requestContext);
+}
+
+bool MHDRouter::hasParameter(const RequestContext& requestContext, const std::string& name) noexcept {
+	std::string::size_type offset;
+	std::string::size_type length;
+	return findParameter(requestContext, name, offset, length) != nullptr;
+}
+
+std::string MHDRouter::getParameter(const RequestContext& requestContext, const std::string& name) {
+	std::string::size_type offset;
+	std::string::size_type length;
+	const std::string* path = findParameter(requestContext, name, offset, length);
+
+	if(path == nullptr) {
+		throw system::Stacktrace::add(std::runtime_error("path parameter \"" + name + "\" not found"));
+	}
+	return path->substr(offset, length);
+}
+
+std::string MHDRouter::getParameter(const RequestContext& requestContext, std::size_t index) {
+	const mhd4esl::com::http::server::Router::Parameters* parameters = mhd4esl::com::http::server::Router::getParameters(requestContext);
+
+	if(parameters == nullptr || index >= parameters->size) {
+		throw system::Stacktrace::add(std::runtime_error("path parameter #" + std::to_string(index) + " not found"));
+	}
+	return requestContext.getPath().substr(parameters->slots[index].first, parameters->slots[index].second);
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
@@ -0,0 +1,52 @@
+#ifndef ESL_COM_HTTP_SERVER_MHDROUTER_H_
+#define ESL_COM_HTTP_SERVER_MHDROUTER_H_
+
+#include <esl/com/http/server/RequestContext.h>
+#include <esl/com/http/server/RequestHandler.h>
+#include <esl/io/Input.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Request handler that dispatches to other request handlers by method and path.
+ * Routes are compiled into a radix trie, so the costs of routing do not depend
+ * on the number of routes.
+ *
+ * Examples of patterns: "/users", "/users/{id}", "/users/{id}/posts/{postId}", "/static/{path...}" */
+class MHDRouter : public RequestHandler {
+public:
+	MHDRouter();
+
+	/* method "*" matches any method. A GET route matches HEAD requests as well, if there is no HEAD route.
+	 * Static segments are preferred to parameters, but a parameter route is used if the static route has no
+	 * endpoint for the method. If routes match the path but none the method, status 405 is sent with header "Allow". */
+	void add(const std::string& method, const std::string& pattern, const RequestHandler& requestHandler);
+
+	/* has to be called once after adding all routes */
+	void build();
+
+	io::Input accept(RequestContext& requestContext) const override;
+
+	/* path parameters of the matching route, available while the routed request handler is called */
+	static bool hasParameter(const RequestContext& requestContext, const std::string& name) noexcept;
+	static std::string getParameter(const RequestContext& requestContext, const std::string& name);
+	static std::string getParameter(const RequestContext& requestContext, std::size_t index);
+
+private:
+	std::unique_ptr<RequestHandler> router;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
+
+#endif /* ESL_COM_HTTP_SERVER_MHDROUTER_H_ */
@@ -2,7 +2,10 @@
 #include <esl/system/Stacktrace.h>
 #include <esl/utility/String.h>
 
+#include <mhd4esl/com/http/server/Metrics.h>
 #include <mhd4esl/com/http/server/Socket.h>
+#include <mhd4esl/com/http/server/TrustedProxies.h>
+#include <mhd4esl/Logging.h>
 
 #include <stdexcept>
 
@@ -18,6 +21,33 @@ MHDSocket::Settings::Settings(const std::vector<std::pair<std::string, std::stri
 	bool hasConnectionTimeout = false;
 	bool hasConnectionLimit = false;
 	bool hasPerIpConnectionLimit = false;
+	bool hasLoggingLevel = false;
+	bool hasHandlerThreads = false;
+	bool hasProxyProtocol = false;
+	bool hasProxyProtocolTimeout = false;
+	bool hasCertificateReloadInterval = false;
+	bool hasOcspRefreshInterval = false;
+	bool hasPriorities = false;
+	bool hasEcdheAead = false;
+	bool hasClientAuth = false;
+	bool hasClientCa = false;
+	bool hasClientCacheSize = false;
+	bool hasClientCacheTtl = false;
+	bool hasSkipStatusCodeMessages = false;
+	bool hasTraceFile = false;
+	bool hasExternalLoop = false;
+	bool hasIntrospection = false;
+	bool hasRuntimeLimits = false;
+	bool hasMaxConnectionLimit = false;
+	bool hasMaxBodySize = false;
+	bool hasMaxHeaderCount = false;
+	bool hasMaxHeaderSize = false;
+	bool hasConnectionMemoryLimit = false;
+	bool hasSmallBodySize = false;
+	bool hasAutoETag = false;
+	bool hasAutoETagStreamSize = false;
+	bool hasFileReadAhead = false;
+	bool hasFileReadAheadThreads = false;
 
 	for(const auto& setting : settings) {
 		if(setting.first == "https") {
@@ -110,6 +140,302 @@ MHDSocket::Settings::Settings(const std::vector<std::pair<std::string, std::stri
 		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
 		    }
 		}
+		else if(setting.first == "handler-threads") {
+			if(hasHandlerThreads) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'handler-threads'."));
+			}
+			hasHandlerThreads = true;
+
+			int i = utility::String::toNumber<int>(setting.second);
+		    if(i < 0 || i > 0xFFFF) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			handlerThreads = static_cast<uint16_t>(i);
+		}
+		else if(setting.first == "logging-level") {
+			if(hasLoggingLevel) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'logging-level'."));
+			}
+			hasLoggingLevel = true;
+
+			// throws an exception if level is invalid
+			mhd4esl::Logging::toLevel(setting.second);
+			loggingLevel = setting.second;
+		}
+		else if(setting.first == "trusted-proxy") {
+			trustedProxies.push_back(setting.second);
+		}
+		else if(setting.first == "tls-certificate") {
+			// hostname is empty for a default certificate
+			std::vector<std::string> values = utility::String::split(setting.second, ';');
+			if(values.size() < 3 || values.size() > 4 || values[1].empty() || values[2].empty()) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+			}
+
+			Certificate certificate;
+			certificate.hostname = values[0];
+			certificate.certificateFile = values[1];
+			certificate.keyFile = values[2];
+			if(values.size() == 4) {
+				certificate.ocspFile = values[3];
+			}
+			certificates.push_back(std::move(certificate));
+		}
+		else if(setting.first == "tls-certificate-reload-interval") {
+			if(hasCertificateReloadInterval) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'tls-certificate-reload-interval'."));
+			}
+			hasCertificateReloadInterval = true;
+
+			int i = utility::String::toNumber<int>(setting.second);
+		    if(i < 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid negative value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			certificateReloadInterval = static_cast<unsigned int>(i);
+		}
+		else if(setting.first == "tls-ocsp-refresh-interval") {
+			if(hasOcspRefreshInterval) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'tls-ocsp-refresh-interval'."));
+			}
+			hasOcspRefreshInterval = true;
+
+			int i = utility::String::toNumber<int>(setting.second);
+		    if(i <= 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			ocspRefreshInterval = static_cast<unsigned int>(i);
+		}
+		else if(setting.first == "tls-priorities") {
+			if(hasPriorities) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'tls-priorities'."));
+			}
+			hasPriorities = true;
+			tlsPriorities = setting.second;
+		}
+		else if(setting.first == "tls-ecdhe-aead") {
+			if(hasEcdheAead) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'tls-ecdhe-aead'."));
+			}
+			hasEcdheAead = true;
+			tlsEcdheAead = esl::utility::String::toBool(setting.second);
+		}
+		else if(setting.first == "tls-client-auth") {
+			if(hasClientAuth) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'tls-client-auth'."));
+			}
+			hasClientAuth = true;
+
+			if(setting.second == "none") {
+				tlsClientAuth = false;
+				tlsClientAuthRequired = false;
+			}
+			else if(setting.second == "optional") {
+				tlsClientAuth = true;
+				tlsClientAuthRequired = false;
+			}
+			else if(setting.second == "required") {
+				tlsClientAuth = true;
+				tlsClientAuthRequired = true;
+			}
+			else {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+			}
+		}
+		else if(setting.first == "tls-client-ca") {
+			if(hasClientCa) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'tls-client-ca'."));
+			}
+			hasClientCa = true;
+			tlsClientCa = setting.second;
+		}
+		else if(setting.first == "tls-client-cache-size") {
+			if(hasClientCacheSize) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'tls-client-cache-size'."));
+			}
+			hasClientCacheSize = true;
+
+			long long i = utility::String::toNumber<long long>(setting.second);
+		    if(i < 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			tlsClientCacheSize = static_cast<std::size_t>(i);
+		}
+		else if(setting.first == "tls-client-cache-ttl") {
+			if(hasClientCacheTtl) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'tls-client-cache-ttl'."));
+			}
+			hasClientCacheTtl = true;
+
+			int i = utility::String::toNumber<int>(setting.second);
+		    if(i < 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			tlsClientCacheTtl = static_cast<unsigned int>(i);
+		}
+		else if(setting.first == "skip-status-code-messages") {
+			if(hasSkipStatusCodeMessages) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'skip-status-code-messages'."));
+			}
+			hasSkipStatusCodeMessages = true;
+			skipStatusCodeMessages = esl::utility::String::toBool(setting.second);
+		}
+		else if(setting.first == "max-body-size") {
+			if(hasMaxBodySize) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'max-body-size'."));
+			}
+			hasMaxBodySize = true;
+
+			long long i = utility::String::toNumber<long long>(setting.second);
+		    if(i < 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			maxBodySize = static_cast<std::uint64_t>(i);
+		}
+		else if(setting.first == "max-header-count") {
+			if(hasMaxHeaderCount) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'max-header-count'."));
+			}
+			hasMaxHeaderCount = true;
+
+			long long i = utility::String::toNumber<long long>(setting.second);
+		    if(i < 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			maxHeaderCount = static_cast<unsigned int>(i);
+		}
+		else if(setting.first == "max-header-size") {
+			if(hasMaxHeaderSize) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'max-header-size'."));
+			}
+			hasMaxHeaderSize = true;
+
+			long long i = utility::String::toNumber<long long>(setting.second);
+		    if(i < 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			maxHeaderSize = static_cast<std::size_t>(i);
+		}
+		else if(setting.first == "connection-memory-limit") {
+			if(hasConnectionMemoryLimit) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'connection-memory-limit'."));
+			}
+			hasConnectionMemoryLimit = true;
+
+			long long i = utility::String::toNumber<long long>(setting.second);
+		    if(i <= 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			connectionMemoryLimit = static_cast<std::size_t>(i);
+		}
+		else if(setting.first == "small-body-size") {
+			if(hasSmallBodySize) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'small-body-size'."));
+			}
+			hasSmallBodySize = true;
+
+			long long i = utility::String::toNumber<long long>(setting.second);
+		    if(i < 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			smallBodySize = static_cast<std::size_t>(i);
+		}
+		else if(setting.first == "auto-etag") {
+			if(hasAutoETag) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'auto-etag'."));
+			}
+			hasAutoETag = true;
+			autoETag = esl::utility::String::toBool(setting.second);
+		}
+		else if(setting.first == "auto-etag-stream-size") {
+			if(hasAutoETagStreamSize) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'auto-etag-stream-size'."));
+			}
+			hasAutoETagStreamSize = true;
+
+			long long i = utility::String::toNumber<long long>(setting.second);
+		    if(i < 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			autoETagStreamSize = static_cast<std::size_t>(i);
+		}
+		else if(setting.first == "file-read-ahead") {
+			if(hasFileReadAhead) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'file-read-ahead'."));
+			}
+			hasFileReadAhead = true;
+			fileReadAhead = esl::utility::String::toBool(setting.second);
+		}
+		else if(setting.first == "file-read-ahead-threads") {
+			if(hasFileReadAheadThreads) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'file-read-ahead-threads'."));
+			}
+			hasFileReadAheadThreads = true;
+
+			int i = utility::String::toNumber<int>(setting.second);
+		    if(i <= 0 || i > 0xFFFF) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			fileReadAheadThreads = static_cast<uint16_t>(i);
+		}
+		else if(setting.first == "trace-file") {
+			if(hasTraceFile) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'trace-file'."));
+			}
+			hasTraceFile = true;
+			traceFile = setting.second;
+		}
+		else if(setting.first == "external-loop") {
+			if(hasExternalLoop) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'external-loop'."));
+			}
+			hasExternalLoop = true;
+			externalLoop = esl::utility::String::toBool(setting.second);
+		}
+		else if(setting.first == "introspection") {
+			if(hasIntrospection) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'introspection'."));
+			}
+			hasIntrospection = true;
+			introspection = esl::utility::String::toBool(setting.second);
+		}
+		else if(setting.first == "runtime-limits") {
+			if(hasRuntimeLimits) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'runtime-limits'."));
+			}
+			hasRuntimeLimits = true;
+			runtimeLimits = esl::utility::String::toBool(setting.second);
+		}
+		else if(setting.first == "max-connection-limit") {
+			if(hasMaxConnectionLimit) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'max-connection-limit'."));
+			}
+			hasMaxConnectionLimit = true;
+
+			int i = utility::String::toNumber<int>(setting.second);
+		    if(i < 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			maxConnectionLimit = static_cast<unsigned int>(i);
+		}
+		else if(setting.first == "proxy-protocol") {
+			if(hasProxyProtocol) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'proxy-protocol'."));
+			}
+			hasProxyProtocol = true;
+			proxyProtocol = esl::utility::String::toBool(setting.second);
+		}
+		else if(setting.first == "proxy-protocol-timeout") {
+			if(hasProxyProtocolTimeout) {
+	            throw system::Stacktrace::add(std::runtime_error("multiple definition of attribute 'proxy-protocol-timeout'."));
+			}
+			hasProxyProtocolTimeout = true;
+
+			int i = utility::String::toNumber<int>(setting.second);
+		    if(i <= 0) {
+		    	throw system::Stacktrace::add(std::runtime_error("Invalid value for \"" + setting.first + "\"=\"" + setting.second + "\""));
+		    }
+			proxyProtocolTimeout = static_cast<unsigned int>(i);
+		}
 		else {
 			throw system::Stacktrace::add(std::runtime_error("Key \"" + setting.first + "\" is unknown"));
 		}
@@ -118,6 +444,17 @@ MHDSocket::Settings::Settings(const std::vector<std::pair<std::string, std::stri
 	if(port == 0) {
     	throw system::Stacktrace::add(std::runtime_error("Parameter \"port\" is missing"));
 	}
+
+	if(maxConnectionLimit > 0 && maxConnectionLimit < connectionLimit) {
+    	throw system::Stacktrace::add(std::runtime_error("Parameter \"max-connection-limit\" is smaller than \"connection-limit\""));
+	}
+
+	if(tlsClientAuth && tlsClientCa.empty()) {
+    	throw system::Stacktrace::add(std::runtime_error("Parameter \"tls-client-ca\" is missing for \"tls-client-auth\""));
+	}
+
+	// throws an exception if a network is invalid
+	mhd4esl::com::http::server::TrustedProxies validateTrustedProxies(trustedProxies);
 }
 
 MHDSocket::MHDSocket(const Settings& settings)
@@ -144,6 +481,81 @@ void MHDSocket::release() {
 	socket->release();
 }
 
+void MHDSocket::reloadCertificates() {
+	static_cast<mhd4esl::com::http::server::Socket&>(*socket).reloadCertificates();
+}
+
+int MHDSocket::getEventFd() const {
+	return static_cast<const mhd4esl::com::http::server::Socket&>(*socket).getEventFd();
+}
+
+void MHDSocket::run() {
+	static_cast<mhd4esl::com::http::server::Socket&>(*socket).run();
+}
+
+long MHDSocket::getTimeout() const {
+	return static_cast<const mhd4esl::com::http::server::Socket&>(*socket).getTimeout();
+}
+
+MHDSocket::Limits MHDSocket::getLimits() const {
+	return static_cast<const mhd4esl::com::http::server::Socket&>(*socket).getLimits();
+}
+
+void MHDSocket::setLimits(const Limits& limits) {
+	static_cast<mhd4esl::com::http::server::Socket&>(*socket).setLimits(limits);
+}
+
+MHDSocket::Introspection MHDSocket::getIntrospection() const {
+	return static_cast<const mhd4esl::com::http::server::Socket&>(*socket).getIntrospection();
+}
+
+MHDSocket::Metrics MHDSocket::getMetrics() {
+	const mhd4esl::com::http::server::Metrics& metrics = mhd4esl::com::http::server::Metrics::get();
+	Metrics rv;
+
+	rv.tlsCertificateRequests = metrics.tlsCertificateRequests.load(std::memory_order_relaxed);
+	rv.tlsCertificateNotFound = metrics.tlsCertificateNotFound.load(std::memory_order_relaxed);
+	rv.tlsCertificateReloads = metrics.tlsCertificateReloads.load(std::memory_order_relaxed);
+	rv.tlsCertificateReloadFailures = metrics.tlsCertificateReloadFailures.load(std::memory_order_relaxed);
+	rv.tlsOcspStapled = metrics.tlsOcspStapled.load(std::memory_order_relaxed);
+	rv.tlsOcspRefreshes = metrics.tlsOcspRefreshes.load(std::memory_order_relaxed);
+	rv.tlsOcspRefreshFailures = metrics.tlsOcspRefreshFailures.load(std::memory_order_relaxed);
+	rv.tlsClientVerifications = metrics.tlsClientVerifications.load(std::memory_order_relaxed);
+	rv.tlsClientCacheHits = metrics.tlsClientCacheHits.load(std::memory_order_relaxed);
+	rv.tlsClientRejected = metrics.tlsClientRejected.load(std::memory_order_relaxed);
+
+	rv.responseCacheHits = metrics.responseCacheHits.load(std::memory_order_relaxed);
+	rv.responseCacheMisses = metrics.responseCacheMisses.load(std::memory_order_relaxed);
+	rv.responseCacheCoalesced = metrics.responseCacheCoalesced.load(std::memory_order_relaxed);
+	rv.responsesNotModified = metrics.responsesNotModified.load(std::memory_order_relaxed);
+
+	for(std::size_t statusCode = 0; statusCode < mhd4esl::com::http::server::Metrics::maxStatusCode; ++statusCode) {
+		std::uint64_t count = metrics.statusCodeExceptions[statusCode].load(std::memory_order_relaxed);
+		if(count > 0) {
+			rv.statusCodeExceptions[static_cast<unsigned short>(statusCode)] = count;
+		}
+	}
+	rv.statusCodeResponsesShared = metrics.statusCodeResponsesShared.load(std::memory_order_relaxed);
+
+	rv.streamsCompleted = metrics.streamsCompleted.load(std::memory_order_relaxed);
+	rv.streamsFailed = metrics.streamsFailed.load(std::memory_order_relaxed);
+	rv.streamSuspends = metrics.streamSuspends.load(std::memory_order_relaxed);
+	rv.fileReadAheadWaits = metrics.fileReadAheadWaits.load(std::memory_order_relaxed);
+
+	rv.requestsRejectedBodySize = metrics.requestsRejectedBodySize.load(std::memory_order_relaxed);
+	rv.requestsRejectedHeaders = metrics.requestsRejectedHeaders.load(std::memory_order_relaxed);
+	rv.requestsRejectedExpectation = metrics.requestsRejectedExpectation.load(std::memory_order_relaxed);
+
+	rv.connectionsRejectedLimit = metrics.connectionsRejectedLimit.load(std::memory_order_relaxed);
+	rv.connectionsRejectedPerIpLimit = metrics.connectionsRejectedPerIpLimit.load(std::memory_order_relaxed);
+
+	rv.tracesExported = metrics.tracesExported.load(std::memory_order_relaxed);
+	rv.tracesDropped = metrics.tracesDropped.load(std::memory_order_relaxed);
+	rv.tracesFailed = metrics.tracesFailed.load(std::memory_order_relaxed);
+
+	return rv;
+}
+
 } /* namespace server */
 } /* namespace http */
 } /* namespace com */
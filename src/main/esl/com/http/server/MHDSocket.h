@@ -4,8 +4,11 @@
 #include <esl/com/http/server/RequestHandler.h>
 #include <esl/com/http/server/Socket.h>
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
@@ -19,7 +22,84 @@ namespace server {
 
 class MHDSocket : public Socket {
 public:
+	/* timeline of a completed request */
+	struct Trace {
+		/* W3C trace context of the request, lowercase hex strings. If the request had no valid "traceparent"
+		 * header, traceId is random and parentSpanId is empty. */
+		std::string traceId;
+		std::string spanId;
+		std::string parentSpanId;
+		std::uint8_t traceFlags = 0;
+
+		std::string method;
+		std::string path;
+		unsigned short statusCode = 0;
+		/* false if MHD terminated the request, e.g. because of a timeout or a closed connection */
+		bool completed = false;
+
+		/* wall clock time of headersReceived */
+		std::chrono::system_clock::time_point startTime;
+
+		/* monotonic timestamps, time_point() if the point has not been reached */
+		std::chrono::steady_clock::time_point headersReceived;
+		std::chrono::steady_clock::time_point acceptReturned;
+		std::chrono::steady_clock::time_point uploadCompleted;
+		/* the response has been handed to MHD, it starts sending it right after */
+		std::chrono::steady_clock::time_point responseQueued;
+		std::chrono::steady_clock::time_point requestCompleted;
+	};
+
+	/* open connection at the time of getIntrospection() */
+	struct ConnectionInfo {
+		/* "waiting" for a request, "handler" is called, "uploading" the request body, "sending" the response or "upgraded" to a WebSocket */
+		std::string state;
+		std::string remoteAddress;
+		std::uint16_t remotePort = 0;
+		/* empty without TLS or before the first request of the connection */
+		std::string tlsProtocol;
+		std::string tlsCipher;
+		std::uint64_t requests = 0;
+		std::uint64_t bodyBytesReceived = 0;
+		std::chrono::steady_clock::duration age;
+		/* time since the connection has entered its state */
+		std::chrono::steady_clock::duration stateAge;
+	};
+
+	struct Introspection {
+		/* empty if Settings::introspection is false */
+		std::vector<ConnectionInfo> connections;
+		unsigned int currentConnections = 0;
+		unsigned int connectionLimit = 0;
+		bool threadPerConnection = false;
+		bool externalLoop = false;
+		/* threads of MHD that poll the connections */
+		std::uint16_t pollingThreads = 0;
+		std::size_t handlerThreads = 0;
+		/* calls of request handlers and writers waiting for a handler thread */
+		std::size_t pendingHandlerTasks = 0;
+		/* "io_uring", "threads" or empty if files are not read ahead */
+		std::string fileReadAhead;
+	};
+
+	/* limits that can be changed while listening if Settings::runtimeLimits is true, 0 means unlimited */
+	struct Limits {
+		unsigned int connectionLimit = 0;
+		unsigned int perIpConnectionLimit = 0;
+		/* seconds, it applies to new connections and to open connections at their next request */
+		unsigned int connectionTimeout = 0;
+	};
+
 	struct Settings {
+		struct Certificate {
+			/* hostname pattern like "www.example.com", "*.example.com" or empty for all hostnames */
+			std::string hostname;
+			std::string certificateFile;
+			std::string keyFile;
+			/* DER encoded OCSP response to staple, empty means none. Responses are stapled only if the certificate
+			 * file contains the issuer to verify them. */
+			std::string ocspFile;
+		};
+
 		Settings(const std::vector<std::pair<std::string, std::string>>& settings);
 
 		bool https = false;
@@ -28,6 +108,144 @@ public:
 		unsigned int connectionTimeout = 120;
 		unsigned int connectionLimit = 15;
 		unsigned int perIpConnectionLimit = 0;
+
+		/* number of threads to call request handlers and to write request bodies.
+		 * 0 means that this is done by the threads of MHD. */
+		uint16_t handlerThreads = 0;
+
+		/* Process wide level for mhd4esl log messages, empty means that the esl logger decides. Only one socket
+		 * at a time may set it, listen() throws an exception if another listening socket has set it already. */
+		std::string loggingLevel;
+
+		/* networks in CIDR notation (e.g. "10.0.0.0/8") of proxies that are trusted to send
+		 * "Forwarded" or "X-Forwarded-For" headers and PROXY protocol headers */
+		std::vector<std::string> trustedProxies;
+
+		/* expect a PROXY protocol header (version 1 or 2) at the beginning of each connection */
+		bool proxyProtocol = false;
+		unsigned int proxyProtocolTimeout = 5;
+
+		/* PEM files of certificates in addition to gtx4esl::crypto::Entries of the plugin registry.
+		 * Value of "tls-certificate" is "<hostname>;<certificate file>;<key file>[;<OCSP response file>]". */
+		std::vector<Certificate> certificates;
+
+		/* interval to check if certificate files have been modified, 0 disables the check */
+		unsigned int certificateReloadInterval = 0;
+
+		/* Returns a DER encoded OCSP response for a certificate without OCSP response file or an empty string.
+		 * It gets the hostname pattern and the DER encoded certificate and it is not called by handshakes. */
+		std::function<std::string(const std::string& hostname, const std::string& certificate)> ocspProvider;
+
+		/* interval to check if OCSP responses have to be refreshed, they are refreshed after half of their validity */
+		unsigned int ocspRefreshInterval = 60;
+
+		/* GnuTLS priority string of the handshakes, e.g. "SECURE128:-VERS-TLS1.0", empty means the default of MHD */
+		std::string tlsPriorities;
+
+		/* Restrict the key exchange to ECDHE with X25519, P-256 or P-384 and the ciphers to AES-GCM and ChaCha20-Poly1305
+		 * by appending to tlsPriorities. These are the cheapest suites with AES-NI or without AES acceleration. The client
+		 * keeps choosing among them, because it knows best if it has AES acceleration. */
+		bool tlsEcdheAead = false;
+
+		/* Client certificates are requested if "tls-client-auth" is "optional" or "required". They are verified against
+		 * the CAs of the PEM file tlsClientCa, revocation is not checked. Without a valid certificate requests get status 403
+		 * if it is required, otherwise MHDRequest::getClientCertificateSubject() is empty. Verified certificates are
+		 * cached by their fingerprint for tlsClientCacheTtl seconds, but not beyond their expiration. */
+		bool tlsClientAuth = false;
+		bool tlsClientAuthRequired = false;
+		std::string tlsClientCa;
+		std::size_t tlsClientCacheSize = 1024;
+		unsigned int tlsClientCacheTtl = 300;
+
+		/* Answer every exception::StatusCode of a common status code with its pre-built default response,
+		 * even if the exception has a custom message or MIME type. */
+		bool skipStatusCodeMessages = false;
+
+		/* maximum size of request bodies, 0 means unlimited. Request handlers can replace it with MHDRequest::setMaxBodySize.
+		 * Requests with a larger "Content-Length" get status 413 before their body is read. */
+		std::uint64_t maxBodySize = 0;
+
+		/* maximum number and total size in bytes of request headers, 0 means unlimited. Requests exceeding them get status 431. */
+		unsigned int maxHeaderCount = 0;
+		std::size_t maxHeaderSize = 0;
+
+		/* memory of MHD per connection for headers and buffers. MHD answers requests whose headers do not fit with status 431. */
+		std::size_t connectionMemoryLimit = 32 * 1024;
+
+		/* Bodies with a "Content-Length" up to this size are collected and given to the writer of the input
+		 * in one call when the request is complete, followed by the usual call with size 0. 0 disables it. */
+		std::size_t smallBodySize = 0;
+
+		/* Responses of GET and HEAD requests with status 200 get an ETag of the XXH64 hash of their body if the request
+		 * handler has not set one. This applies to buffered bodies and to outputs that complete within autoETagStreamSize
+		 * bytes. If the ETag matches header "If-None-Match" of the request, status 304 is sent without body. */
+		bool autoETag = false;
+		std::size_t autoETagStreamSize = 64 * 1024;
+
+		/* Read files of MHDConnection::sendFile ahead with io_uring, so the threads of MHD do not block on disk reads.
+		 * It is used for HTTPS only, because MHD uses sendfile otherwise. If io_uring is not available,
+		 * files are read by fileReadAheadThreads threads. */
+		bool fileReadAhead = false;
+		uint16_t fileReadAheadThreads = 2;
+
+		/* Called with the trace of every completed request by the thread that has completed it, so it must not block. */
+		std::function<void(const Trace& trace)> traceExporter;
+
+		/* file to append traces of completed requests to as OTLP JSON lines, empty disables it.
+		 * Traces are written by a separate thread and dropped if it cannot keep up. */
+		std::string traceFile;
+
+		/* Do not start threads to poll the connections. The application has to wait for events of getEventFd()
+		 * and to call run(), e.g. in its own event loop. Request handlers are called by the thread calling run()
+		 * unless there are handler threads. Only available on Linux, because it uses epoll. */
+		bool externalLoop = false;
+
+		/* keep a list of the open connections and their state for getIntrospection() */
+		bool introspection = false;
+
+		/* Enforce connectionLimit, perIpConnectionLimit and connectionTimeout by mhd4esl instead of MHD, so they
+		 * can be changed by setLimits() while listening. MHD keeps maxConnectionLimit as hard limit then,
+		 * 0 means connectionLimit. */
+		bool runtimeLimits = false;
+		unsigned int maxConnectionLimit = 0;
+	};
+
+	struct Metrics {
+		std::uint64_t tlsCertificateRequests = 0;
+		std::uint64_t tlsCertificateNotFound = 0;
+		std::uint64_t tlsCertificateReloads = 0;
+		std::uint64_t tlsCertificateReloadFailures = 0;
+		std::uint64_t tlsOcspStapled = 0;
+		std::uint64_t tlsOcspRefreshes = 0;
+		std::uint64_t tlsOcspRefreshFailures = 0;
+		std::uint64_t tlsClientVerifications = 0;
+		std::uint64_t tlsClientCacheHits = 0;
+		std::uint64_t tlsClientRejected = 0;
+
+		std::uint64_t responseCacheHits = 0;
+		std::uint64_t responseCacheMisses = 0;
+		std::uint64_t responseCacheCoalesced = 0;
+		std::uint64_t responsesNotModified = 0;
+
+		/* status codes that have been thrown at least once */
+		std::map<unsigned short, std::uint64_t> statusCodeExceptions;
+		std::uint64_t statusCodeResponsesShared = 0;
+
+		std::uint64_t streamsCompleted = 0;
+		std::uint64_t streamsFailed = 0;
+		std::uint64_t streamSuspends = 0;
+		std::uint64_t fileReadAheadWaits = 0;
+
+		std::uint64_t requestsRejectedBodySize = 0;
+		std::uint64_t requestsRejectedHeaders = 0;
+		std::uint64_t requestsRejectedExpectation = 0;
+
+		std::uint64_t connectionsRejectedLimit = 0;
+		std::uint64_t connectionsRejectedPerIpLimit = 0;
+
+		std::uint64_t tracesExported = 0;
+		std::uint64_t tracesDropped = 0;
+		std::uint64_t tracesFailed = 0;
 	};
 
 	MHDSocket(const Settings& settings);
@@ -43,6 +261,33 @@ public:
 
 	void release() override;
 
+	/* Loads all certificates again. Handshakes in flight are not affected and connections are kept.
+	 * Throws an exception if a certificate cannot be loaded, the previous certificates are used then. */
+	void reloadCertificates();
+
+	/* Methods for Settings::externalLoop. They are available after the non-blocking listen and,
+	 * like release(), they must be called by the thread of the application loop. */
+
+	/* epoll file descriptor that becomes readable if run() has something to do */
+	int getEventFd() const;
+
+	/* processes all pending events of the socket without blocking */
+	void run();
+
+	/* milliseconds until run() has to be called even without events, -1 if there is no timeout */
+	long getTimeout() const;
+
+	/* Current limits. setLimits() throws an exception if Settings::runtimeLimits is false
+	 * or if the connection limit exceeds the hard limit of MHD. */
+	Limits getLimits() const;
+	void setLimits(const Limits& limits);
+
+	/* open connections and utilization of the threads, available while listening */
+	Introspection getIntrospection() const;
+
+	/* process wide counters of all MHD sockets */
+	static Metrics getMetrics();
+
 private:
 	std::unique_ptr<Socket> socket;
 };
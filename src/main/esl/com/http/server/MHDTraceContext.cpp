@@ -0,0 +1,64 @@
+#include <esl/com/http/server/MHDTraceContext.h>
+
+#include <utility>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+const std::string MHDTraceContext::id = "traceparent";
+
+MHDTraceContext::MHDTraceContext(std::string aTraceId, std::string aParentSpanId, std::string aSpanId, std::uint8_t aTraceFlags, std::string aTraceState)
+: traceId(std::move(aTraceId)),
+  parentSpanId(std::move(aParentSpanId)),
+  spanId(std::move(aSpanId)),
+  traceFlags(aTraceFlags),
+  traceState(std::move(aTraceState))
+{ }
+
+const std::string& MHDTraceContext::getTraceId() const noexcept {
+	return traceId;
+}
+
+const std::string& MHDTraceContext::getParentSpanId() const noexcept {
+	return parentSpanId;
+}
+
+const std::string& MHDTraceContext::getSpanId() const noexcept {
+	return spanId;
+}
+
+std::uint8_t MHDTraceContext::getTraceFlags() const noexcept {
+	return traceFlags;
+}
+
+bool MHDTraceContext::isSampled() const noexcept {
+	return (traceFlags & 0x01) != 0;
+}
+
+const std::string& MHDTraceContext::getTraceState() const noexcept {
+	return traceState;
+}
+
+std::string MHDTraceContext::getTraceParent() const {
+	static const char hex[] = "0123456789abcdef";
+
+	std::string rv;
+	rv.reserve(55);
+	rv += "00-";
+	rv += traceId;
+	rv += '-';
+	rv += spanId;
+	rv += '-';
+	rv += hex[traceFlags >> 4];
+	rv += hex[traceFlags & 0x0f];
+	return rv;
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
@@ -0,0 +1,54 @@
+#ifndef ESL_COM_HTTP_SERVER_MHDTRACECONTEXT_H_
+#define ESL_COM_HTTP_SERVER_MHDTRACECONTEXT_H_
+
+#include <esl/object/Object.h>
+
+#include <cstdint>
+#include <string>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* W3C trace context of a request of MHDSocket. Requests with a valid "traceparent" header have it
+ * in their object context with id MHDTraceContext::id. IDs are lowercase hex strings. */
+class MHDTraceContext : public object::Object {
+public:
+	static const std::string id;
+
+	MHDTraceContext(std::string traceId, std::string parentSpanId, std::string spanId, std::uint8_t traceFlags, std::string traceState);
+
+	const std::string& getTraceId() const noexcept;
+
+	/* span of the caller, taken from the "traceparent" header */
+	const std::string& getParentSpanId() const noexcept;
+
+	/* span of this request, it is the parent span of requests sent while handling it */
+	const std::string& getSpanId() const noexcept;
+
+	std::uint8_t getTraceFlags() const noexcept;
+	bool isSampled() const noexcept;
+
+	/* value of the "tracestate" header or empty */
+	const std::string& getTraceState() const noexcept;
+
+	/* value of the "traceparent" header for requests sent while handling this request */
+	std::string getTraceParent() const;
+
+private:
+	std::string traceId;
+	std::string parentSpanId;
+	std::string spanId;
+	std::uint8_t traceFlags;
+	std::string traceState;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
+
+#endif /* ESL_COM_HTTP_SERVER_MHDTRACECONTEXT_H_ */
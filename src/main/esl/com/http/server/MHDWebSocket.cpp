@@ -0,0 +1,53 @@
+#include <esl/com/http/server/MHDWebSocket.h>
+#include <esl/com/http/server/exception/StatusCode.h>
+#include <esl/system/Stacktrace.h>
+
+#include <mhd4esl/com/http/server/Connection.h>
+#include <mhd4esl/com/http/server/Native.h>
+#include <mhd4esl/com/http/server/Request.h>
+#include <mhd4esl/com/http/server/WebSocket.h>
+
+#include <stdexcept>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+using mhd4esl::com::http::server::getNative;
+
+bool MHDWebSocket::isUpgradeRequest(const Request& request) {
+	return mhd4esl::com::http::server::WebSocket::isUpgradeRequest(getNative(request));
+}
+
+void MHDWebSocket::accept(Connection& connection, const Request& request, std::shared_ptr<Handler> handler) {
+	accept(connection, request, std::move(handler), Settings());
+}
+
+void MHDWebSocket::accept(Connection& connection, const Request& request, std::shared_ptr<Handler> handler, const Settings& settings) {
+	const mhd4esl::com::http::server::Request& nativeRequest = getNative(request);
+	mhd4esl::com::http::server::Connection& nativeConnection = getNative(connection);
+
+	if(!handler) {
+		throw system::Stacktrace::add(std::runtime_error("WebSocket handler is missing"));
+	}
+	if(!mhd4esl::com::http::server::WebSocket::isUpgradeRequest(nativeRequest)) {
+		throw exception::StatusCode(400);
+	}
+
+	std::unique_ptr<mhd4esl::com::http::server::WebSocket::Upgrade> upgrade(new mhd4esl::com::http::server::WebSocket::Upgrade);
+	upgrade->handler = std::move(handler);
+	upgrade->settings = settings;
+
+	const std::string acceptKey = mhd4esl::com::http::server::WebSocket::createAcceptKey(nativeRequest.findHeader("Sec-WebSocket-Key"));
+	if(!nativeConnection.sendWebSocket(acceptKey, std::move(upgrade))) {
+		throw system::Stacktrace::add(std::runtime_error("Cannot upgrade connection to WebSocket"));
+	}
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
@@ -0,0 +1,82 @@
+#ifndef ESL_COM_HTTP_SERVER_MHDWEBSOCKET_H_
+#define ESL_COM_HTTP_SERVER_MHDWEBSOCKET_H_
+
+#include <esl/com/http/server/Connection.h>
+#include <esl/com/http/server/Request.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* WebSocket (RFC 6455) for connections of MHDSocket. Using it with any other connection throws an exception. */
+class MHDWebSocket {
+public:
+	struct Settings {
+		/* maximum size of a message after reassembling its fragments. Larger messages close the session with 1009. */
+		std::size_t maxMessageSize = 16 * 1024 * 1024;
+
+		/* maximum size of data waiting to be sent. Session::send returns false if it would be exceeded. */
+		std::size_t maxQueueSize = 4 * 1024 * 1024;
+
+		/* value of header "Sec-WebSocket-Protocol" of the response, empty means none */
+		std::string protocol;
+	};
+
+	class Session {
+	public:
+		virtual ~Session() = default;
+
+		/* Thread safe. Returns false if the session is closed or if the send queue is full. */
+		virtual bool send(const void* data, std::size_t size, bool binary) = 0;
+		bool send(const std::string& text) {
+			return send(text.data(), text.size(), false);
+		}
+
+		/* Thread safe. Sends a close frame, Handler::onClose is called when the session is closed. */
+		virtual void close(std::uint16_t code = 1000, const std::string& reason = "") = 0;
+
+		virtual std::size_t getQueuedSize() const noexcept = 0;
+	};
+
+	/* Methods are called by a single thread of MHDSocket per session and must not block. */
+	class Handler {
+	public:
+		virtual ~Handler() = default;
+
+		/* called first. Keep the session to send messages from other threads. */
+		virtual void onOpen(const std::shared_ptr<Session>& session) { }
+
+		/* called with complete messages, fragmented messages are reassembled */
+		virtual void onMessage(Session& session, const std::string& message, bool binary) = 0;
+
+		/* called if the send queue has been drained after Session::send returned false */
+		virtual void onWritable(Session& session) { }
+
+		/* called last */
+		virtual void onClose(Session& session, std::uint16_t code) { }
+	};
+
+	MHDWebSocket() = delete;
+
+	static bool isUpgradeRequest(const Request& request);
+
+	/* Answers an upgrade request with status 101 and hands over the connection to the handler afterwards.
+	 * Throws exception::StatusCode(400) if the request is not a valid upgrade request. */
+	static void accept(Connection& connection, const Request& request, std::shared_ptr<Handler> handler);
+	static void accept(Connection& connection, const Request& request, std::shared_ptr<Handler> handler, const Settings& settings);
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace esl */
+
+#endif /* ESL_COM_HTTP_SERVER_MHDWEBSOCKET_H_ */
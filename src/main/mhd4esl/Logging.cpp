@@ -0,0 +1,79 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/Logging.h>
+
+#include <esl/system/Stacktrace.h>
+
+#include <stdexcept>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+
+// everything that is compiled in is passed to the esl logger, unless a level has been set
+std::atomic<int> Logging::runtimeLevel(static_cast<int>(Logging::Level::trace));
+std::atomic<const void*> Logging::owner(nullptr);
+
+Logging::Level Logging::toLevel(const std::string& str) {
+	if(str == "trace") {
+		return Level::trace;
+	}
+	else if(str == "debug") {
+		return Level::debug;
+	}
+	else if(str == "info") {
+		return Level::info;
+	}
+	else if(str == "warn") {
+		return Level::warn;
+	}
+	else if(str == "error") {
+		return Level::error;
+	}
+	else if(str == "silent") {
+		return Level::silent;
+	}
+	throw esl::system::Stacktrace::add(std::runtime_error("Invalid logging level \"" + str + "\""));
+}
+
+void Logging::setLevel(Level level) noexcept {
+	runtimeLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+Logging::Level Logging::getLevel() noexcept {
+	return static_cast<Level>(runtimeLevel.load(std::memory_order_relaxed));
+}
+
+bool Logging::setLevel(Level level, const void* aOwner) noexcept {
+	const void* currentOwner = nullptr;
+	if(!owner.compare_exchange_strong(currentOwner, aOwner) && currentOwner != aOwner) {
+		return false;
+	}
+	setLevel(level);
+	return true;
+}
+
+void Logging::releaseLevel(const void* aOwner) noexcept {
+	const void* currentOwner = aOwner;
+	if(owner.compare_exchange_strong(currentOwner, nullptr)) {
+		setLevel(Level::trace);
+	}
+}
+
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
@@ -0,0 +1,92 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_LOGGING_H_
+#define MHD4ESL_LOGGING_H_
+
+#include <atomic>
+#include <string>
+
+/* Lowest level that is compiled in at all. Everything below is removed by the compiler. */
+#if defined(MHD4ESL_LOGGING_LEVEL_TRACE)
+#define MHD4ESL_LOGGING_LEVEL_MIN 0
+#elif defined(MHD4ESL_LOGGING_LEVEL_DEBUG)
+#define MHD4ESL_LOGGING_LEVEL_MIN 1
+#elif defined(MHD4ESL_LOGGING_LEVEL_INFO)
+#define MHD4ESL_LOGGING_LEVEL_MIN 2
+#elif defined(MHD4ESL_LOGGING_LEVEL_WARN)
+#define MHD4ESL_LOGGING_LEVEL_MIN 3
+#elif defined(MHD4ESL_LOGGING_LEVEL_ERROR)
+#define MHD4ESL_LOGGING_LEVEL_MIN 4
+#elif defined(MHD4ESL_LOGGING_LEVEL_SILENT)
+#define MHD4ESL_LOGGING_LEVEL_MIN 5
+#else
+#define MHD4ESL_LOGGING_LEVEL_MIN 0
+#endif
+
+#if defined(__GNUC__)
+#define MHD4ESL_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define MHD4ESL_UNLIKELY(x) (x)
+#endif
+
+/* Usage: MHD4ESL_LOG(logger, debug) << "text " << value << "\n";
+ * If the level is disabled, the stream expression is not evaluated at all. */
+#define MHD4ESL_LOG(logger, level) \
+	if(!MHD4ESL_UNLIKELY(::mhd4esl::Logging::isEnabled(::mhd4esl::Logging::Level::level))) { } \
+	else (logger).level
+
+namespace mhd4esl {
+inline namespace v1_6 {
+
+class Logging {
+public:
+	enum class Level : int {
+		trace = 0,
+		debug = 1,
+		info = 2,
+		warn = 3,
+		error = 4,
+		silent = 5
+	};
+
+	static Level toLevel(const std::string& str);
+
+	static void setLevel(Level level) noexcept;
+	static Level getLevel() noexcept;
+
+	/* The level is process wide, so only one owner (e.g. the socket with setting "logging-level") may set it.
+	 * Returns false if another owner has set it already. */
+	static bool setLevel(Level level, const void* owner) noexcept;
+	/* resets the level to trace if it has been set by owner, so the configuration of the esl logger decides again */
+	static void releaseLevel(const void* owner) noexcept;
+
+	static bool isEnabled(Level level) noexcept {
+		return static_cast<int>(level) >= MHD4ESL_LOGGING_LEVEL_MIN
+				&& static_cast<int>(level) >= runtimeLevel.load(std::memory_order_relaxed);
+	}
+
+private:
+	static std::atomic<int> runtimeLevel;
+	static std::atomic<const void*> owner;
+};
+
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_LOGGING_H_ */
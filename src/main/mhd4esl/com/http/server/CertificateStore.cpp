@@ -0,0 +1,592 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/CertificateStore.h>
+#include <mhd4esl/com/http/server/Metrics.h>
+#include <mhd4esl/Logging.h>
+
+#include <gtx4esl/crypto/Entries.h>
+#include <gtx4esl/crypto/Entry.h>
+
+#include <esl/Logger.h>
+#include <esl/plugin/Registry.h>
+#include <esl/system/Stacktrace.h>
+
+#include <gnutls/ocsp.h>
+#include <gnutls/x509.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+esl::Logger logger("mhd4esl::com::http::server::CertificateStore");
+
+const unsigned int maxChainSize = 16;
+
+std::string readFile(const std::string& path) {
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	if(!file) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot open file \"" + path + "\""));
+	}
+
+	std::ostringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+
+std::time_t getModificationTime(const std::string& path) noexcept {
+	struct stat fileStat;
+	if(stat(path.c_str(), &fileStat) != 0) {
+		return 0;
+	}
+	return fileStat.st_mtime;
+}
+
+std::unique_ptr<gnutls_x509_crt_int, decltype(&gnutls_x509_crt_deinit)> exportCertificate(const gnutls_pcert_st& pcert) {
+	gnutls_x509_crt_t certificate;
+	int rc = gnutls_pcert_export_x509(const_cast<gnutls_pcert_st*>(&pcert), &certificate);
+	if(rc < 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error(std::string("Cannot export certificate: ") + gnutls_strerror(rc)));
+	}
+	return std::unique_ptr<gnutls_x509_crt_int, decltype(&gnutls_x509_crt_deinit)>(certificate, &gnutls_x509_crt_deinit);
+}
+
+/* Signature schemes of TLS 1.2 and 1.3 use the low byte 1 for RSA and 3 for ECDSA, the schemes 0x0804 to 0x0806
+ * of TLS 1.3 are RSA-PSS with RSA keys. */
+int parseSignatureAlgorithms(void* ctx, unsigned int tlsId, const unsigned char* data, unsigned int dataSize) {
+	if(tlsId != 13 || dataSize < 2) {
+		return 0;
+	}
+
+	CertificateStore::ClientPkAlgorithms& clientPkAlgorithms = *static_cast<CertificateStore::ClientPkAlgorithms*>(ctx);
+	bool rsa = false;
+	bool ecdsa = false;
+	const unsigned int size = std::min(dataSize - 2, (static_cast<unsigned int>(data[0]) << 8) | data[1]);
+	for(unsigned int i = 2; i + 1 < size + 2; i += 2) {
+		if(data[i + 1] == 1 || (data[i] == 8 && data[i + 1] >= 4 && data[i + 1] <= 6)) {
+			rsa = true;
+		}
+		else if(data[i + 1] == 3) {
+			ecdsa = true;
+		}
+	}
+
+	clientPkAlgorithms.count = 0;
+	if(ecdsa) {
+		clientPkAlgorithms.algorithms[clientPkAlgorithms.count++] = GNUTLS_PK_ECDSA;
+	}
+	if(rsa) {
+		clientPkAlgorithms.algorithms[clientPkAlgorithms.count++] = GNUTLS_PK_RSA;
+	}
+	return 0;
+}
+
+/* responses without next update are refreshed with every interval */
+bool isOcspRefreshDue(const CertificateStore::OcspResponse* ocspResponse, std::time_t now) noexcept {
+	if(ocspResponse == nullptr || ocspResponse->nextUpdate == static_cast<std::time_t>(-1)) {
+		return true;
+	}
+	return now >= ocspResponse->thisUpdate + (ocspResponse->nextUpdate - ocspResponse->thisUpdate) / 2;
+}
+}
+
+void CertificateStore::checkOcspResponse(OcspResponse& ocspResponse, const std::vector<gnutls_pcert_st>& chain) {
+	gnutls_ocsp_resp_t response;
+	int rc = gnutls_ocsp_resp_init(&response);
+	if(rc < 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error(std::string("Cannot create OCSP response: ") + gnutls_strerror(rc)));
+	}
+	std::unique_ptr<gnutls_ocsp_resp_int, decltype(&gnutls_ocsp_resp_deinit)> responsePtr(response, &gnutls_ocsp_resp_deinit);
+
+	gnutls_datum_t datum;
+	datum.data = reinterpret_cast<unsigned char*>(&ocspResponse.der[0]);
+	datum.size = static_cast<unsigned int>(ocspResponse.der.size());
+	rc = gnutls_ocsp_resp_import(response, &datum);
+	if(rc < 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error(std::string("Invalid OCSP response: ") + gnutls_strerror(rc)));
+	}
+	if(gnutls_ocsp_resp_get_status(response) != GNUTLS_OCSP_RESP_SUCCESSFUL) {
+		throw esl::system::Stacktrace::add(std::runtime_error("OCSP response is not successful"));
+	}
+
+	auto certificate = exportCertificate(chain.at(0));
+	rc = gnutls_ocsp_resp_check_crt(response, 0, certificate.get());
+	if(rc < 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error(std::string("OCSP response does not match certificate: ") + gnutls_strerror(rc)));
+	}
+
+	// a response that cannot be verified might be forged, so it is not stapled
+	if(chain.size() < 2) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot verify OCSP response, because the chain does not contain the issuer of the certificate"));
+	}
+	auto issuer = exportCertificate(chain[1]);
+	unsigned int verify = 0;
+	rc = gnutls_ocsp_resp_verify_direct(response, issuer.get(), &verify, 0);
+	if(rc < 0 || verify != 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error("OCSP response is not signed by the issuer of the certificate"));
+	}
+
+	unsigned int status;
+	std::time_t revocationTime;
+	unsigned int revocationReason;
+	rc = gnutls_ocsp_resp_get_single(response, 0, nullptr, nullptr, nullptr, nullptr, &status,
+			&ocspResponse.thisUpdate, &ocspResponse.nextUpdate, &revocationTime, &revocationReason);
+	if(rc < 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error(std::string("Invalid OCSP response: ") + gnutls_strerror(rc)));
+	}
+	if(status != GNUTLS_OCSP_CERT_GOOD) {
+		throw esl::system::Stacktrace::add(std::runtime_error("OCSP response does not report the certificate as good"));
+	}
+	if(ocspResponse.nextUpdate != static_cast<std::time_t>(-1) && ocspResponse.nextUpdate <= std::time(nullptr)) {
+		throw esl::system::Stacktrace::add(std::runtime_error("OCSP response has expired"));
+	}
+}
+
+class CertificateStore::Certificates {
+public:
+	Certificates() = default;
+	Certificates(const Certificates&) = delete;
+	Certificates& operator=(const Certificates&) = delete;
+
+	~Certificates() {
+		for(auto& entry : entries) {
+			delete entry->certificate.ocspResponse.load(std::memory_order_relaxed);
+
+			if(!entry->owned) {
+				continue;
+			}
+			for(auto& pcert : entry->certificate.chain) {
+				gnutls_pcert_deinit(&pcert);
+			}
+			if(entry->certificate.key) {
+				gnutls_privkey_deinit(entry->certificate.key);
+			}
+		}
+	}
+
+	/* owned certificates are released by the destructor */
+	Certificate& add(const std::string& hostname, bool owned) {
+		entries.push_back(std::unique_ptr<Entry>(new Entry));
+		entries.back()->certificate.hostname = hostname;
+		entries.back()->owned = owned;
+		return entries.back()->certificate;
+	}
+
+	/* has to be called after all certificates have been added */
+	void buildIndex() {
+		// later certificates replace earlier certificates with the same hostname and key type
+		std::unordered_map<std::string, std::pair<std::size_t, std::size_t>> byHostname;
+		const std::size_t none = entries.size();
+		for(std::size_t i = 0; i < entries.size(); ++i) {
+			Certificate& certificate = entries[i]->certificate;
+			certificate.pkAlgorithm = certificate.key ? static_cast<gnutls_pk_algorithm_t>(gnutls_privkey_get_pk_algorithm(certificate.key, nullptr)) : GNUTLS_PK_UNKNOWN;
+
+			auto iter = byHostname.insert(std::make_pair(certificate.hostname, std::make_pair(none, none))).first;
+			if(certificate.pkAlgorithm == GNUTLS_PK_ECDSA) {
+				iter->second.first = i;
+			}
+			else {
+				iter->second.second = i;
+			}
+		}
+
+		for(const auto& hostnameEntry : byHostname) {
+			std::size_t ecdsaIndex = hostnameEntry.second.first;
+			std::size_t otherIndex = hostnameEntry.second.second;
+			std::size_t i = ecdsaIndex != none ? ecdsaIndex : otherIndex;
+			if(ecdsaIndex != none && otherIndex != none) {
+				entries[ecdsaIndex]->certificate.alternative = &entries[otherIndex]->certificate;
+			}
+
+			const std::string& hostname = hostnameEntry.first;
+			if(hostname.empty() || hostname.at(0) == '*') {
+				patterns.push_back(i);
+			}
+			else {
+				exact[hostname] = i;
+			}
+		}
+
+		// the longest pattern is the best match
+		std::sort(patterns.begin(), patterns.end(), [this](std::size_t i1, std::size_t i2) {
+			const std::size_t size1 = entries[i1]->certificate.hostname.size();
+			const std::size_t size2 = entries[i2]->certificate.hostname.size();
+			return size1 != size2 ? size1 > size2 : i1 > i2;
+		});
+	}
+
+	const Certificate* find(const std::string& hostname, const gnutls_pk_algorithm_t* pkAlgorithms, unsigned int pkAlgorithmCount) const noexcept {
+		auto iter = exact.find(hostname);
+		if(iter != exact.end()) {
+			return select(entries[iter->second]->certificate, pkAlgorithms, pkAlgorithmCount);
+		}
+
+		for(std::size_t i : patterns) {
+			const std::string& pattern = entries[i]->certificate.hostname;
+			const std::size_t suffixSize = pattern.empty() ? 0 : pattern.size() - 1;
+
+			if(hostname.size() >= suffixSize && hostname.compare(hostname.size() - suffixSize, suffixSize, pattern, pattern.size() - suffixSize, suffixSize) == 0) {
+				return select(entries[i]->certificate, pkAlgorithms, pkAlgorithmCount);
+			}
+		}
+
+		return nullptr;
+	}
+
+	void forEach(const std::function<void(const Certificate&)>& function) const {
+		for(const auto& entry : entries) {
+			function(entry->certificate);
+		}
+	}
+
+private:
+	struct Entry {
+		Certificate certificate;
+		bool owned = false;
+	};
+
+	static const Certificate* select(const Certificate& certificate, const gnutls_pk_algorithm_t* pkAlgorithms, unsigned int pkAlgorithmCount) noexcept {
+		if(certificate.alternative == nullptr || pkAlgorithmCount == 0) {
+			return &certificate;
+		}
+		for(unsigned int i = 0; i < pkAlgorithmCount; ++i) {
+			if(pkAlgorithms[i] == certificate.pkAlgorithm) {
+				return &certificate;
+			}
+		}
+		return certificate.alternative;
+	}
+
+	// entries are not movable because of the atomic OCSP response
+	std::vector<std::unique_ptr<Entry>> entries;
+	std::unordered_map<std::string, std::size_t> exact;
+	std::vector<std::size_t> patterns;
+};
+
+CertificateStore::CertificateStore(const std::vector<esl::com::http::server::MHDSocket::Settings::Certificate>& aFiles, OcspProvider aOcspProvider, unsigned int aConnectionTimeout)
+: files(aFiles),
+  ocspProvider(std::move(aOcspProvider)),
+  connectionTimeout(aConnectionTimeout)
+{ }
+
+CertificateStore::~CertificateStore() {
+	stopWatcher();
+	delete current.exchange(nullptr);
+}
+
+void CertificateStore::reload() {
+	std::unique_ptr<Certificates> certificates(new Certificates);
+	std::vector<std::time_t> newModificationTimes;
+
+	try {
+		gtx4esl::crypto::Entries* keyStoreEntriesPtr = esl::plugin::Registry::get().findObject<gtx4esl::crypto::Entries>();
+		if(keyStoreEntriesPtr) {
+			for(auto& entry : keyStoreEntriesPtr->entryByHostname) {
+				Certificate& certificate = certificates->add(entry.first, false);
+				certificate.chain.push_back(entry.second.pcrt);
+				certificate.key = entry.second.key;
+			}
+		}
+
+		for(const auto& file : files) {
+			newModificationTimes.push_back(getModificationTime(file.certificateFile));
+			newModificationTimes.push_back(getModificationTime(file.keyFile));
+
+			std::string certificateData = readFile(file.certificateFile);
+			std::string keyData = readFile(file.keyFile);
+			Certificate& certificate = certificates->add(file.hostname, true);
+			certificate.ocspFile = file.ocspFile;
+			gnutls_datum_t datum;
+
+			std::vector<gnutls_pcert_st> chain(maxChainSize);
+			unsigned int chainSize = maxChainSize;
+			datum.data = reinterpret_cast<unsigned char*>(&certificateData[0]);
+			datum.size = static_cast<unsigned int>(certificateData.size());
+			int rc = gnutls_pcert_list_import_x509_raw(chain.data(), &chainSize, &datum, GNUTLS_X509_FMT_PEM, 0);
+			if(rc < 0) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Cannot load certificate file \"" + file.certificateFile + "\": " + gnutls_strerror(rc)));
+			}
+			chain.resize(chainSize);
+			certificate.chain = std::move(chain);
+
+			rc = gnutls_privkey_init(&certificate.key);
+			if(rc < 0) {
+				certificate.key = nullptr;
+				throw esl::system::Stacktrace::add(std::runtime_error(std::string("Cannot create private key: ") + gnutls_strerror(rc)));
+			}
+			datum.data = reinterpret_cast<unsigned char*>(&keyData[0]);
+			datum.size = static_cast<unsigned int>(keyData.size());
+			rc = gnutls_privkey_import_x509_raw(certificate.key, &datum, GNUTLS_X509_FMT_PEM, nullptr, 0);
+			if(rc < 0) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Cannot load key file \"" + file.keyFile + "\": " + gnutls_strerror(rc)));
+			}
+		}
+
+		certificates->buildIndex();
+	}
+	catch(...) {
+		Metrics::get().tlsCertificateReloadFailures.fetch_add(1, std::memory_order_relaxed);
+		throw;
+	}
+
+	{
+		// a missing OCSP response does not fail the reload, the certificates are just not stapled
+		std::lock_guard<std::mutex> lock(reloadMutex);
+		updateOcspResponses(*certificates);
+	}
+
+	publish(std::move(certificates));
+
+	std::lock_guard<std::mutex> lock(reloadMutex);
+	modificationTimes = std::move(newModificationTimes);
+}
+
+const CertificateStore::Certificate* CertificateStore::find(const std::string& hostname, const gnutls_pk_algorithm_t* pkAlgorithms, unsigned int pkAlgorithmCount) const noexcept {
+	const Certificates* certificates = current.load(std::memory_order_acquire);
+	return certificates ? certificates->find(hostname, pkAlgorithms, pkAlgorithmCount) : nullptr;
+}
+
+const CertificateStore::OcspResponse* CertificateStore::getOcspResponse(const Certificate& certificate) const noexcept {
+	const OcspResponse* ocspResponse = certificate.ocspResponse.load(std::memory_order_acquire);
+	if(ocspResponse && ocspResponse->nextUpdate != static_cast<std::time_t>(-1) && ocspResponse->nextUpdate <= std::time(nullptr)) {
+		return nullptr;
+	}
+	return ocspResponse;
+}
+
+void CertificateStore::parseClientHello(const gnutls_datum_t& clientHello, ClientPkAlgorithms& clientPkAlgorithms) noexcept {
+	clientPkAlgorithms.count = 0;
+	gnutls_ext_raw_parse(&clientPkAlgorithms, parseSignatureAlgorithms, &clientHello, GNUTLS_EXT_RAW_FLAG_TLS_CLIENT_HELLO);
+}
+
+void CertificateStore::setConnectionTimeout(unsigned int aConnectionTimeout) noexcept {
+	unsigned int current = connectionTimeout.load();
+	while(current != 0 && (aConnectionTimeout == 0 || aConnectionTimeout > current)) {
+		if(connectionTimeout.compare_exchange_weak(current, aConnectionTimeout)) {
+			break;
+		}
+	}
+}
+
+void CertificateStore::startWatcher(unsigned int reloadIntervalSeconds, unsigned int ocspRefreshIntervalSeconds) {
+	if(reloadIntervalSeconds == 0 && (ocspRefreshIntervalSeconds == 0 || !hasOcspSources())) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(watcherMutex);
+
+	if(!watcher.joinable()) {
+		watcherStopped = false;
+		watcher = std::thread(&CertificateStore::runWatcher, this, reloadIntervalSeconds, ocspRefreshIntervalSeconds);
+	}
+}
+
+void CertificateStore::stopWatcher() noexcept {
+	{
+		std::lock_guard<std::mutex> lock(watcherMutex);
+		watcherStopped = true;
+	}
+	watcherCondVar.notify_all();
+
+	if(watcher.joinable()) {
+		watcher.join();
+	}
+}
+
+void CertificateStore::publish(std::unique_ptr<const Certificates> certificates) {
+	std::lock_guard<std::mutex> lock(reloadMutex);
+	const auto now = std::chrono::steady_clock::now();
+
+	retired.erase(std::remove_if(retired.begin(), retired.end(), [this, now](const std::pair<std::chrono::steady_clock::time_point, std::unique_ptr<const Certificates>>& entry) {
+		return isGracePeriodOver(entry.first, now);
+	}), retired.end());
+	retired.reserve(retired.size() + 1);
+
+	// handshakes that have loaded the previous certificates can still use them during the grace period
+	const Certificates* previous = current.exchange(certificates.release(), std::memory_order_acq_rel);
+	if(previous) {
+		retired.emplace_back(now, std::unique_ptr<const Certificates>(previous));
+	}
+
+	Metrics::get().tlsCertificateReloads.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::unique_ptr<const CertificateStore::OcspResponse> CertificateStore::loadOcspResponse(const Certificate& certificate) const {
+	std::unique_ptr<OcspResponse> ocspResponse(new OcspResponse);
+
+	if(!certificate.ocspFile.empty()) {
+		ocspResponse->der = readFile(certificate.ocspFile);
+	}
+	else if(ocspProvider && !certificate.chain.empty()) {
+		const gnutls_datum_t& der = certificate.chain[0].cert;
+		ocspResponse->der = ocspProvider(certificate.hostname, std::string(reinterpret_cast<const char*>(der.data), der.size));
+	}
+	if(ocspResponse->der.empty() || certificate.chain.empty()) {
+		return nullptr;
+	}
+
+	checkOcspResponse(*ocspResponse, certificate.chain);
+
+	ocspResponse->data.version = 1;
+	ocspResponse->data.response.data = reinterpret_cast<unsigned char*>(&ocspResponse->der[0]);
+	ocspResponse->data.response.size = static_cast<unsigned int>(ocspResponse->der.size());
+	ocspResponse->data.exptime = ocspResponse->nextUpdate == static_cast<std::time_t>(-1) ? 0 : ocspResponse->nextUpdate;
+
+	return std::unique_ptr<const OcspResponse>(ocspResponse.release());
+}
+
+void CertificateStore::updateOcspResponses(const Certificates& certificates) noexcept {
+	const auto steadyNow = std::chrono::steady_clock::now();
+	const std::time_t now = std::time(nullptr);
+
+	retiredOcspResponses.erase(std::remove_if(retiredOcspResponses.begin(), retiredOcspResponses.end(), [this, steadyNow](const std::pair<std::chrono::steady_clock::time_point, std::unique_ptr<const OcspResponse>>& entry) {
+		return isGracePeriodOver(entry.first, steadyNow);
+	}), retiredOcspResponses.end());
+
+	certificates.forEach([this, steadyNow, now](const Certificate& certificate) {
+		if(certificate.ocspFile.empty() && !ocspProvider) {
+			return;
+		}
+
+		const OcspResponse* previous = certificate.ocspResponse.load(std::memory_order_acquire);
+		if(!isOcspRefreshDue(previous, now)) {
+			return;
+		}
+
+		try {
+			std::unique_ptr<const OcspResponse> ocspResponse = loadOcspResponse(certificate);
+			if(!ocspResponse) {
+				// the previous response is used until it expires
+				if(previous == nullptr) {
+					return;
+				}
+				throw esl::system::Stacktrace::add(std::runtime_error("No OCSP response available"));
+			}
+
+			retiredOcspResponses.reserve(retiredOcspResponses.size() + 1);
+			previous = certificate.ocspResponse.exchange(ocspResponse.release(), std::memory_order_acq_rel);
+			if(previous) {
+				retiredOcspResponses.emplace_back(steadyNow, std::unique_ptr<const OcspResponse>(previous));
+			}
+
+			Metrics::get().tlsOcspRefreshes.fetch_add(1, std::memory_order_relaxed);
+		}
+		catch (const std::exception& e) {
+			Metrics::get().tlsOcspRefreshFailures.fetch_add(1, std::memory_order_relaxed);
+			logger.warn << "Loading OCSP response for hostname \"" << certificate.hostname << "\" failed: " << e.what() << std::endl;
+		}
+		catch (...) {
+			Metrics::get().tlsOcspRefreshFailures.fetch_add(1, std::memory_order_relaxed);
+			logger.warn << "Loading OCSP response for hostname \"" << certificate.hostname << "\" failed: unknown exception" << std::endl;
+		}
+	});
+}
+
+bool CertificateStore::hasOcspSources() const noexcept {
+	if(ocspProvider) {
+		return true;
+	}
+	for(const auto& file : files) {
+		if(!file.ocspFile.empty()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool CertificateStore::isGracePeriodOver(std::chrono::steady_clock::time_point retiredAt, std::chrono::steady_clock::time_point now) const noexcept {
+	const unsigned int timeout = connectionTimeout.load();
+	return timeout != 0 && retiredAt + std::chrono::seconds(timeout) + std::chrono::seconds(60) <= now;
+}
+
+bool CertificateStore::hasModifiedFiles() noexcept {
+	std::lock_guard<std::mutex> lock(reloadMutex);
+
+	std::size_t i = 0;
+	for(const auto& file : files) {
+		if(i + 1 >= modificationTimes.size()
+				|| getModificationTime(file.certificateFile) != modificationTimes[i]
+				|| getModificationTime(file.keyFile) != modificationTimes[i + 1]) {
+			return true;
+		}
+		i += 2;
+	}
+
+	return false;
+}
+
+void CertificateStore::runWatcher(unsigned int reloadIntervalSeconds, unsigned int ocspRefreshIntervalSeconds) noexcept {
+	const bool checkFiles = reloadIntervalSeconds > 0;
+	const bool refreshOcsp = ocspRefreshIntervalSeconds > 0 && hasOcspSources();
+	auto nextCheck = std::chrono::steady_clock::now() + std::chrono::seconds(reloadIntervalSeconds);
+	auto nextRefresh = std::chrono::steady_clock::now() + std::chrono::seconds(ocspRefreshIntervalSeconds);
+
+	std::unique_lock<std::mutex> lock(watcherMutex);
+
+	while(!watcherCondVar.wait_until(lock, checkFiles && (!refreshOcsp || nextCheck < nextRefresh) ? nextCheck : nextRefresh, [this] { return watcherStopped; })) {
+		lock.unlock();
+		const auto now = std::chrono::steady_clock::now();
+
+		if(refreshOcsp && nextRefresh <= now) {
+			nextRefresh = now + std::chrono::seconds(ocspRefreshIntervalSeconds);
+
+			std::lock_guard<std::mutex> reloadLock(reloadMutex);
+			const Certificates* certificates = current.load(std::memory_order_acquire);
+			if(certificates) {
+				updateOcspResponses(*certificates);
+			}
+		}
+
+		if(checkFiles && nextCheck <= now) {
+			nextCheck = now + std::chrono::seconds(reloadIntervalSeconds);
+
+			if(hasModifiedFiles()) {
+				try {
+					reload();
+					MHD4ESL_LOG(logger, info) << "Certificates reloaded\n";
+				}
+				catch (const std::exception& e) {
+					// files might be written right now, so it is tried again with the next interval
+					logger.warn << "Reloading certificates failed: " << e.what() << std::endl;
+				}
+				catch (...) {
+					logger.warn << "Reloading certificates failed: unknown exception" << std::endl;
+				}
+			}
+		}
+
+		lock.lock();
+	}
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
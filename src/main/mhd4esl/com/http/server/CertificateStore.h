@@ -0,0 +1,162 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_CERTIFICATESTORE_H_
+#define MHD4ESL_COM_HTTP_SERVER_CERTIFICATESTORE_H_
+
+#include <esl/com/http/server/MHDSocket.h>
+
+#include <gnutls/gnutls.h>
+#include <gnutls/abstract.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Certificates for TLS handshakes. A reload builds a new immutable set of certificates and publishes it
+ * with an atomic pointer, so handshakes look up certificates without locking. Replaced sets are destroyed
+ * after a grace period, so handshakes in flight keep using the set they have started with. The grace period
+ * is the longest connection timeout that has been set plus one minute. A connection timeout of 0 means
+ * that handshakes are not limited, replaced sets are kept until the store is destroyed then.
+ * OCSP responses to staple are replaced the same way per certificate. */
+class CertificateStore {
+public:
+	using OcspProvider = std::function<std::string(const std::string& hostname, const std::string& certificate)>;
+
+	struct OcspResponse {
+		OcspResponse() = default;
+		OcspResponse(const OcspResponse&) = delete;
+		OcspResponse& operator=(const OcspResponse&) = delete;
+
+		/* DER encoded response, data.response points to it */
+		std::string der;
+		gnutls_ocsp_data_st data;
+		std::time_t thisUpdate = 0;
+		/* (time_t) -1 if the responder has not specified it */
+		std::time_t nextUpdate = static_cast<std::time_t>(-1);
+	};
+
+	struct Certificate {
+		/* hostname pattern like "www.example.com", "*.example.com" or empty for all hostnames */
+		std::string hostname;
+		std::vector<gnutls_pcert_st> chain;
+		gnutls_privkey_t key = nullptr;
+		gnutls_pk_algorithm_t pkAlgorithm = GNUTLS_PK_UNKNOWN;
+		/* certificate of the same hostname with another key type. It is set for ECDSA certificates only,
+		 * because they are preferred if the client accepts them. */
+		const Certificate* alternative = nullptr;
+
+		std::string ocspFile;
+		mutable std::atomic<const OcspResponse*> ocspResponse{nullptr};
+	};
+
+	/* public key algorithms of the certificates that a client accepts */
+	struct ClientPkAlgorithms {
+		gnutls_pk_algorithm_t algorithms[2];
+		unsigned int count = 0;
+	};
+
+	CertificateStore(const std::vector<esl::com::http::server::MHDSocket::Settings::Certificate>& files, OcspProvider ocspProvider, unsigned int connectionTimeout);
+	~CertificateStore();
+
+	/* Loads the certificates of gtx4esl::crypto::Entries from the plugin registry and of all files.
+	 * Throws an exception if a file cannot be loaded, the current certificates are kept then. */
+	void reload();
+
+	/* Returns the certificate of the exact hostname or of the longest matching pattern. If there is an ECDSA and
+	 * another certificate for the hostname, the ECDSA certificate is returned unless the public key algorithms
+	 * accepted by the client do not contain ECDSA. No accepted algorithms means that all are accepted.
+	 * The result stays valid for the grace period after the next reload. */
+	const Certificate* find(const std::string& hostname, const gnutls_pk_algorithm_t* pkAlgorithms = nullptr, unsigned int pkAlgorithmCount = 0) const noexcept;
+
+	/* Returns the OCSP response to staple for a certificate found by this store or nullptr if there is
+	 * no response or it has expired. The result stays valid for the grace period after its replacement. */
+	const OcspResponse* getOcspResponse(const Certificate& certificate) const noexcept;
+
+	/* Sets the algorithms of the signature algorithms in a ClientHello message without its handshake header.
+	 * GnuTLS passes the accepted algorithms to the certificate callback of clients only, so servers have to
+	 * take them from the ClientHello. The count stays 0 if the client has not sent signature algorithms. */
+	static void parseClientHello(const gnutls_datum_t& clientHello, ClientPkAlgorithms& clientPkAlgorithms) noexcept;
+
+	/* Checks that the response is a good response of the first certificate of the chain, that is not expired
+	 * and signed by the issuer, which has to be the second certificate of the chain.
+	 * It sets thisUpdate and nextUpdate of the response and throws an exception if the check fails. */
+	static void checkOcspResponse(OcspResponse& ocspResponse, const std::vector<gnutls_pcert_st>& chain);
+
+	/* Extends the grace period if the connection timeout is longer than all timeouts set before.
+	 * Replaced sets are kept for the extended grace period as well. */
+	void setConnectionTimeout(unsigned int connectionTimeout) noexcept;
+
+	/* Reloads the certificates if a file has been modified and refreshes OCSP responses.
+	 * A reload interval of 0 disables the check for modified files. */
+	void startWatcher(unsigned int reloadIntervalSeconds, unsigned int ocspRefreshIntervalSeconds);
+	void stopWatcher() noexcept;
+
+private:
+	class Certificates;
+
+	std::unique_ptr<const OcspResponse> loadOcspResponse(const Certificate& certificate) const;
+	/* reloadMutex has to be locked */
+	void updateOcspResponses(const Certificates& certificates) noexcept;
+	bool hasOcspSources() const noexcept;
+	bool isGracePeriodOver(std::chrono::steady_clock::time_point retiredAt, std::chrono::steady_clock::time_point now) const noexcept;
+
+	void publish(std::unique_ptr<const Certificates> certificates);
+	bool hasModifiedFiles() noexcept;
+	void runWatcher(unsigned int reloadIntervalSeconds, unsigned int ocspRefreshIntervalSeconds) noexcept;
+
+	const std::vector<esl::com::http::server::MHDSocket::Settings::Certificate> files;
+	const OcspProvider ocspProvider;
+	/* longest connection timeout in seconds, 0 if connections are not limited */
+	std::atomic<unsigned int> connectionTimeout;
+
+	std::atomic<const Certificates*> current{nullptr};
+
+	std::mutex reloadMutex;
+	std::vector<std::pair<std::chrono::steady_clock::time_point, std::unique_ptr<const Certificates>>> retired;
+	std::vector<std::pair<std::chrono::steady_clock::time_point, std::unique_ptr<const OcspResponse>>> retiredOcspResponses;
+	std::vector<std::time_t> modificationTimes;
+
+	std::mutex watcherMutex;
+	std::condition_variable watcherCondVar;
+	bool watcherStopped = false;
+	std::thread watcher;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_CERTIFICATESTORE_H_ */
@@ -0,0 +1,178 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/ClientCertificateCache.h>
+#include <mhd4esl/com/http/server/Metrics.h>
+#include <mhd4esl/Logging.h>
+
+#include <esl/Logger.h>
+
+#include <gnutls/x509.h>
+
+#include <ctime>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+esl::Logger logger("mhd4esl::com::http::server::ClientCertificateCache");
+
+std::string toHex(const unsigned char* data, std::size_t size) {
+	static const char digits[] = "0123456789abcdef";
+	std::string hex;
+	hex.reserve(size * 2);
+	for(std::size_t i = 0; i < size; ++i) {
+		hex += digits[data[i] >> 4];
+		hex += digits[data[i] & 0x0f];
+	}
+	return hex;
+}
+}
+
+ClientCertificateCache::ClientCertificateCache(std::size_t aMaxEntries, std::chrono::seconds aTtl)
+: maxEntries(aMaxEntries),
+  ttl(aTtl)
+{ }
+
+std::shared_ptr<const ClientCertificate> ClientCertificateCache::verify(gnutls_session_t session) noexcept {
+	unsigned int peersLength = 0;
+	const gnutls_datum_t* peers = gnutls_certificate_get_peers(session, &peersLength);
+	if(peers == nullptr || peersLength == 0) {
+		return nullptr;
+	}
+
+	unsigned char digest[32];
+	std::size_t digestSize = sizeof(digest);
+	if(gnutls_fingerprint(GNUTLS_DIG_SHA256, &peers[0], digest, &digestSize) != GNUTLS_E_SUCCESS) {
+		return nullptr;
+	}
+
+	try {
+		std::string fingerprint = toHex(digest, digestSize);
+
+		std::shared_ptr<const ClientCertificate> certificate = find(fingerprint);
+		if(certificate) {
+			Metrics::get().tlsClientCacheHits.fetch_add(1, std::memory_order_relaxed);
+			return certificate;
+		}
+
+		// full verification of the chain against the trusted CAs of the credentials
+		Metrics::get().tlsClientVerifications.fetch_add(1, std::memory_order_relaxed);
+		unsigned int status = 0;
+		if(gnutls_certificate_verify_peers2(session, &status) != GNUTLS_E_SUCCESS || status != 0) {
+			MHD4ESL_LOG(logger, debug) << "Client certificate " << fingerprint << " is not valid, status " << status << "\n";
+			return nullptr;
+		}
+
+		gnutls_x509_crt_t crt;
+		if(gnutls_x509_crt_init(&crt) != GNUTLS_E_SUCCESS) {
+			return nullptr;
+		}
+		std::shared_ptr<ClientCertificate> verifiedCertificate;
+		std::time_t expirationTime = static_cast<std::time_t>(-1);
+		if(gnutls_x509_crt_import(crt, &peers[0], GNUTLS_X509_FMT_DER) == GNUTLS_E_SUCCESS) {
+			gnutls_datum_t dn = { nullptr, 0 };
+			if(gnutls_x509_crt_get_dn2(crt, &dn) == GNUTLS_E_SUCCESS) {
+				verifiedCertificate = std::make_shared<ClientCertificate>();
+				verifiedCertificate->subject.assign(reinterpret_cast<const char*>(dn.data), dn.size);
+				verifiedCertificate->fingerprint = std::move(fingerprint);
+				gnutls_free(dn.data);
+			}
+			expirationTime = gnutls_x509_crt_get_expiration_time(crt);
+		}
+		gnutls_x509_crt_deinit(crt);
+
+		if(!verifiedCertificate) {
+			return nullptr;
+		}
+
+		// the cache entry must not outlive the certificate
+		std::chrono::steady_clock::time_point expires = std::chrono::steady_clock::now() + ttl;
+		std::time_t now = std::time(nullptr);
+		if(expirationTime != static_cast<std::time_t>(-1) && expirationTime - now < ttl.count()) {
+			expires = std::chrono::steady_clock::now() + std::chrono::seconds(expirationTime - now);
+		}
+		add(verifiedCertificate, expires);
+
+		return verifiedCertificate;
+	}
+	catch(...) {
+		logger.warn << "Verification of client certificate failed\n";
+	}
+
+	return nullptr;
+}
+
+std::shared_ptr<const ClientCertificate> ClientCertificateCache::find(const std::string& fingerprint) noexcept {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto iter = entries.find(fingerprint);
+	if(iter == entries.end()) {
+		return nullptr;
+	}
+
+	if(iter->second.expires <= std::chrono::steady_clock::now()) {
+		lru.erase(iter->second.lruIter);
+		entries.erase(iter);
+		return nullptr;
+	}
+
+	lru.splice(lru.begin(), lru, iter->second.lruIter);
+	return iter->second.certificate;
+}
+
+void ClientCertificateCache::add(std::shared_ptr<const ClientCertificate> certificate, std::chrono::steady_clock::time_point expires) noexcept {
+	if(maxEntries == 0 || expires <= std::chrono::steady_clock::now()) {
+		return;
+	}
+
+	try {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto iter = entries.find(certificate->fingerprint);
+		if(iter != entries.end()) {
+			// verified by concurrent handshakes
+			iter->second.certificate = std::move(certificate);
+			iter->second.expires = expires;
+			lru.splice(lru.begin(), lru, iter->second.lruIter);
+			return;
+		}
+
+		while(entries.size() >= maxEntries && !lru.empty()) {
+			entries.erase(lru.back());
+			lru.pop_back();
+		}
+
+		lru.push_front(certificate->fingerprint);
+		Entry& entry = entries[certificate->fingerprint];
+		entry.certificate = std::move(certificate);
+		entry.expires = expires;
+		entry.lruIter = lru.begin();
+	}
+	catch(...) {
+	}
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
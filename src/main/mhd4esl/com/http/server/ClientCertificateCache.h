@@ -0,0 +1,82 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_CLIENTCERTIFICATECACHE_H_
+#define MHD4ESL_COM_HTTP_SERVER_CLIENTCERTIFICATECACHE_H_
+
+#include <gnutls/gnutls.h>
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* verified certificate of a TLS client */
+struct ClientCertificate {
+	/* distinguished name in RFC 4514 format */
+	std::string subject;
+	/* lowercase hex SHA-256 fingerprint of the DER encoded certificate */
+	std::string fingerprint;
+};
+
+/* Verifies client certificates against the trusted CAs of the TLS credentials. Verified certificates are
+ * cached by fingerprint until their TTL or the certificate expires, so repeated connections of the same client
+ * skip the chain validation. The client still proves the possession of its key in every handshake.
+ * Failed verifications are not cached, because the same certificate might be sent with another chain. */
+class ClientCertificateCache {
+public:
+	ClientCertificateCache(std::size_t maxEntries, std::chrono::seconds ttl);
+
+	/* returns nullptr if the peer of the session has not sent a certificate or if it is not valid */
+	std::shared_ptr<const ClientCertificate> verify(gnutls_session_t session) noexcept;
+
+private:
+	struct Entry {
+		std::shared_ptr<const ClientCertificate> certificate;
+		std::chrono::steady_clock::time_point expires;
+		std::list<std::string>::iterator lruIter;
+	};
+
+	std::shared_ptr<const ClientCertificate> find(const std::string& fingerprint) noexcept;
+	void add(std::shared_ptr<const ClientCertificate> certificate, std::chrono::steady_clock::time_point expires) noexcept;
+
+	const std::size_t maxEntries;
+	const std::chrono::seconds ttl;
+
+	std::mutex mutex;
+	/* fingerprints, most recently used first */
+	std::list<std::string> lru;
+	std::unordered_map<std::string, Entry> entries;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_CLIENTCERTIFICATECACHE_H_ */
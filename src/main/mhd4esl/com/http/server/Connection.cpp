@@ -17,6 +17,12 @@
  */
 
 #include <mhd4esl/com/http/server/Connection.h>
+#include <mhd4esl/com/http/server/ConnectionContext.h>
+#include <mhd4esl/com/http/server/ETag.h>
+#include <mhd4esl/com/http/server/EventStreamRegistry.h>
+#include <mhd4esl/com/http/server/FileStream.h>
+#include <mhd4esl/com/http/server/Headers.h>
+#include <mhd4esl/com/http/server/Metrics.h>
 
 #include <esl/io/Reader.h>
 #include <esl/Logger.h>
@@ -27,6 +33,15 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
 
 namespace mhd4esl {
 inline namespace v1_6 {
@@ -44,7 +59,9 @@ Connection::Connection(MHD_Connection& mhdConnection)
 
 Connection::~Connection() {
 	for(auto& response : responseQueue) {
-		MHD_destroy_response(std::get<1>(response));
+		if(std::get<1>(response) != nullptr) {
+			MHD_destroy_response(std::get<1>(response));
+		}
 	}
 }
 
@@ -70,19 +87,246 @@ bool Connection::hasResponseSent() noexcept {
 }
 
 bool Connection::send(const esl::com::http::server::Response& response, const void* data, std::size_t size) noexcept {
+	if(capture && !capture->response && size <= capture->maxSize) {
+		try {
+			capture->body = std::make_shared<std::string>(static_cast<const char*>(data), size);
+			capture->response.reset(new esl::com::http::server::Response(response));
+			return true;
+		}
+		catch(...) {
+			capture->body.reset();
+		}
+	}
+	if(capture) {
+		capture->bypassed = true;
+	}
+
+	std::string etag;
+	if(autoETag && response.getStatusCode() == MHD_HTTP_OK && matchETag(response, data, size, etag)) {
+		return sendNotModified(response, etag);
+	}
+
     MHD_Response* mhdResponse = MHD_create_response_from_buffer(size, const_cast<void*>(data), MHD_RESPMEM_PERSISTENT);
+    if(mhdResponse && !etag.empty()) {
+    	MHD_add_response_header(mhdResponse, MHD_HTTP_HEADER_ETAG, etag.c_str());
+    }
 
     return sendResponse(response, mhdResponse);
 }
 
-bool Connection::send(const esl::com::http::server::Response& response, esl::io::Output output) {
-	esl::io::Output* outputPtr = new esl::io::Output(std::move(output));
-	MHD_Response* mhdResponse = MHD_create_response_from_callback(-1, 8192, contentReaderCallback, outputPtr, contentReaderFreeCallback);
+bool Connection::send(const esl::com::http::server::Response& response, const std::vector<esl::com::http::server::MHDConnection::Segment>& segments, std::shared_ptr<const void> owner) noexcept {
+	if(capture) {
+		capture->bypassed = true;
+	}
+
+	std::vector<MHD_IoVec> iov;
+	try {
+		iov.reserve(segments.size());
+	}
+	catch(...) {
+		logger.warn << "- cannot allocate segments\n";
+		return false;
+	}
+	for(const auto& segment : segments) {
+		if(segment.size > 0) {
+			MHD_IoVec ioVec;
+			ioVec.iov_base = segment.data;
+			ioVec.iov_len = segment.size;
+			iov.push_back(ioVec);
+		}
+	}
+
+	// MHD copies the array of MHD_IoVec, so it can be released after creating the response
+	std::shared_ptr<const void>* ownerPtr = nullptr;
+	if(owner) {
+		ownerPtr = new (std::nothrow) std::shared_ptr<const void>(std::move(owner));
+		if(ownerPtr == nullptr) {
+			logger.warn << "- cannot allocate owner of segments\n";
+			return false;
+		}
+	}
+	MHD_Response* mhdResponse = MHD_create_response_from_iovec(iov.data(), static_cast<unsigned int>(iov.size()), ownerPtr ? sharedDataFreeCallback : nullptr, ownerPtr);
+
+	if(mhdResponse == nullptr) {
+		delete ownerPtr;
+	}
 
 	return sendResponse(response, mhdResponse);
 }
 
+bool Connection::sendMapped(const esl::com::http::server::Response& response, std::shared_ptr<const void> data, std::size_t size) noexcept {
+	static const std::string noETag;
+	return sendData(response, std::move(data), size, noETag);
+}
+
+std::shared_ptr<const void> Connection::mapFile(const std::string& path, std::size_t& size) {
+#ifdef _WIN32
+	throw esl::system::Stacktrace::add(std::runtime_error("Memory mapped files are not supported on this platform"));
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+    	throw esl::system::Stacktrace::add(std::runtime_error("Cannot open file \"" + path + "\""));
+    }
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0) {
+    	close(fd);
+    	throw esl::system::Stacktrace::add(std::runtime_error("Cannot stat file \"" + path + "\""));
+    }
+    size = static_cast<std::size_t>(fileStat.st_size);
+
+    if(size == 0) {
+    	close(fd);
+    	static const char empty = 0;
+    	return std::shared_ptr<const void>(&empty, [](const void*) {});
+    }
+
+    void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid after closing the file descriptor
+    close(fd);
+
+    if(address == MAP_FAILED) {
+    	throw esl::system::Stacktrace::add(std::runtime_error("Cannot map file \"" + path + "\""));
+    }
+
+    std::size_t mappedSize = size;
+    return std::shared_ptr<const void>(address, [mappedSize](const void* mappedAddress) {
+    	munmap(const_cast<void*>(mappedAddress), mappedSize);
+    });
+#endif
+}
+
+bool Connection::send(const esl::com::http::server::Response& response, esl::io::Output output) {
+	std::unique_ptr<Stream> stream(new Stream);
+	stream->output = std::move(output);
+
+	if(capture && !capture->response) {
+		// read as much as allowed. If the output is complete within the limit, it is recorded as buffered response
+		std::shared_ptr<std::string> body = std::make_shared<std::string>();
+		if(readOutput(stream->output, *body, capture->maxSize)) {
+			capture->body = std::move(body);
+			capture->response.reset(new esl::com::http::server::Response(response));
+			return true;
+		}
+		stream->prefix = std::move(*body);
+	}
+	if(capture) {
+		capture->bypassed = true;
+	}
+	else if(autoETag && response.getStatusCode() == MHD_HTTP_OK) {
+		// the body needs an ETag before the first byte is sent, so only outputs that complete within the limit get one
+		std::shared_ptr<std::string> body = std::make_shared<std::string>();
+		if(readOutput(stream->output, *body, autoETagStreamSize)) {
+			std::string etag;
+			if(matchETag(response, body->data(), body->size(), etag)) {
+				return sendNotModified(response, etag);
+			}
+			if(etag.empty()) {
+				return sendMapped(response, std::shared_ptr<const void>(body, body->data()), body->size());
+			}
+
+			esl::com::http::server::Response responseWithETag(response);
+			responseWithETag.addHeader(MHD_HTTP_HEADER_ETAG, etag);
+			return sendMapped(responseWithETag, std::shared_ptr<const void>(body, body->data()), body->size());
+		}
+		stream->prefix = std::move(*body);
+	}
+
+	return sendStream(response, stream.release());
+}
+
+bool Connection::readOutput(esl::io::Output& output, std::string& body, std::size_t maxSize) {
+	char buffer[8192];
+
+	while(body.size() <= maxSize) {
+		std::size_t size = output.getReader().read(buffer, sizeof(buffer));
+		if(size == esl::io::Reader::npos) {
+			return true;
+		}
+		if(size == 0) {
+			// reader is not ready, so the output is not complete yet
+			return false;
+		}
+		body.append(buffer, size);
+	}
+
+	return false;
+}
+
+bool Connection::sendShared(unsigned short httpStatusCode, std::shared_ptr<MHD_Response> mhdResponse) noexcept {
+	if(!mhdResponse) {
+		logger.warn << "- mhdResponse == nullptr\n";
+		return false;
+	}
+
+	if(capture) {
+		capture->bypassed = true;
+	}
+
+	// the lambda keeps the shared response alive until this connection is destroyed
+	std::function<bool()> sendFunc = [this, httpStatusCode, mhdResponse]() {
+	    return MHD_queue_response(&mhdConnection, httpStatusCode, mhdResponse.get()) == MHD_YES;
+	};
+
+	responseQueue.push_back(std::make_tuple(sendFunc, static_cast<MHD_Response*>(nullptr)));
+
+	return true;
+}
+
+bool Connection::sendShared(const esl::com::http::server::Response& response, std::shared_ptr<MHD_Response> mhdResponse, const std::string& etag) noexcept {
+	if(autoETag && response.getStatusCode() == MHD_HTTP_OK && !etag.empty() && ETag::matches(ifNoneMatch, etag)) {
+		if(capture) {
+			capture->bypassed = true;
+		}
+
+		// an ETag set by the request handler is kept by sendNotModified, a created one has to be added
+		static const std::string noETag;
+		return sendNotModified(response, Headers::find(response, MHD_HTTP_HEADER_ETAG) ? noETag : etag);
+	}
+
+	return sendShared(response.getStatusCode(), std::move(mhdResponse));
+}
+
+bool Connection::sendCaptured(const esl::com::http::server::Response& response, std::shared_ptr<const std::string> body) noexcept {
+	std::string etag;
+	if(autoETag && response.getStatusCode() == MHD_HTTP_OK && matchETag(response, body->data(), body->size(), etag)) {
+		return sendNotModified(response, etag);
+	}
+
+	const void* data = body->data();
+	const std::size_t size = body->size();
+	return sendData(response, std::shared_ptr<const void>(std::move(body), data), size, etag);
+}
+
+void Connection::startCapture(Capture& aCapture) noexcept {
+	capture = &aCapture;
+}
+
+void Connection::stopCapture() noexcept {
+	capture = nullptr;
+}
+
+void Connection::setAutoETag(const char* aIfNoneMatch, std::size_t maxStreamSize) noexcept {
+	autoETag = true;
+	ifNoneMatch = aIfNoneMatch;
+	autoETagStreamSize = maxStreamSize;
+}
+
+bool Connection::hasAutoETag() const noexcept {
+	return autoETag;
+}
+
+void Connection::addHeaders(const esl::com::http::server::Response& response, MHD_Response* mhdResponse) noexcept {
+	for(const auto& header : response.getHeaders()) {
+		MHD_add_response_header(mhdResponse, header.first.c_str(), header.second.c_str());
+	}
+}
+
 bool Connection::sendFile(const esl::com::http::server::Response& response, const std::string& path) {
+	if(capture) {
+		capture->bypassed = true;
+	}
+
     int fd = open(path.c_str(), O_RDONLY);
     if(fd < 0) {
         return false;
@@ -90,21 +334,152 @@ bool Connection::sendFile(const esl::com::http::server::Response& response, cons
     size_t size = static_cast<size_t>(lseek(fd, 0, SEEK_END));
     lseek(fd, 0, SEEK_SET);
 
+	const MHD_ConnectionInfo* socketContextInfo = MHD_get_connection_info(&mhdConnection, MHD_CONNECTION_INFO_SOCKET_CONTEXT);
+	const ConnectionContext* connectionContext = socketContextInfo ? static_cast<const ConnectionContext*>(socketContextInfo->socket_context) : nullptr;
+	if(connectionContext && connectionContext->fileReadAhead && size > 0) {
+		// FileStream closes fd
+		FileStream* fileStream = new FileStream(*connectionContext->fileReadAhead, fd, size, mhdConnection, connectionContext->streamNotifierRegistry);
+		MHD_Response* mhdResponse = MHD_create_response_from_callback(size, 32 * 1024, FileStream::contentReaderCallback, fileStream, FileStream::contentReaderFreeCallback);
+		if(mhdResponse == nullptr) {
+			FileStream::contentReaderFreeCallback(fileStream);
+		}
+		return sendResponse(response, mhdResponse);
+	}
+
     MHD_Response* mhdResponse = MHD_create_response_from_fd(size, fd);
 
     return sendResponse(response, mhdResponse);
 }
 
-bool Connection::sendResponse(const esl::com::http::server::Response& response, MHD_Response* mhdResponse) noexcept {
+std::shared_ptr<StreamNotifier> Connection::sendNotifiable(const esl::com::http::server::Response& response, esl::io::Output output) noexcept {
+	const MHD_ConnectionInfo* socketContextInfo = MHD_get_connection_info(&mhdConnection, MHD_CONNECTION_INFO_SOCKET_CONTEXT);
+	StreamNotifierRegistry* streamNotifierRegistry = socketContextInfo && socketContextInfo->socket_context
+			? static_cast<ConnectionContext*>(socketContextInfo->socket_context)->streamNotifierRegistry : nullptr;
+
+	std::shared_ptr<StreamNotifier> notifier;
+	Stream* stream = nullptr;
+	try {
+		notifier = std::make_shared<StreamNotifier>(mhdConnection, streamNotifierRegistry);
+		stream = new Stream;
+		stream->output = std::move(output);
+		stream->notifier = notifier;
+	}
+	catch(...) {
+		logger.warn << "- cannot create stream\n";
+		return nullptr;
+	}
+
+	// a stream that waits for its producer cannot be captured
+	if(capture) {
+		capture->bypassed = true;
+	}
+
+	if(!sendStream(response, stream)) {
+		return nullptr;
+	}
+	return notifier;
+}
+
+std::shared_ptr<EventStream> Connection::sendEventStream(const esl::com::http::server::MHDEventStream::Settings& settings) noexcept {
+	const MHD_ConnectionInfo* socketContextInfo = MHD_get_connection_info(&mhdConnection, MHD_CONNECTION_INFO_SOCKET_CONTEXT);
+	if(socketContextInfo == nullptr || socketContextInfo->socket_context == nullptr
+			|| static_cast<ConnectionContext*>(socketContextInfo->socket_context)->eventStreamRegistry == nullptr) {
+		logger.warn << "- no connection context for event stream\n";
+		return nullptr;
+	}
+	EventStreamRegistry& registry = *static_cast<ConnectionContext*>(socketContextInfo->socket_context)->eventStreamRegistry;
+
+	std::shared_ptr<EventStream>* eventStreamPtr = nullptr;
+	MHD_Response* mhdResponse = nullptr;
+	try {
+		eventStreamPtr = new std::shared_ptr<EventStream>(std::make_shared<EventStream>(mhdConnection, registry, settings));
+		mhdResponse = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, 8192, EventStream::contentReaderCallback, eventStreamPtr, EventStream::contentReaderFreeCallback);
+	}
+	catch(...) {
+	}
+
 	if(mhdResponse == nullptr) {
 		logger.warn << "- mhdResponse == nullptr\n";
+		delete eventStreamPtr;
+		return nullptr;
+	}
+	std::shared_ptr<EventStream> eventStream = *eventStreamPtr;
+
+	MHD_add_response_header(mhdResponse, MHD_HTTP_HEADER_CONTENT_TYPE, "text/event-stream");
+	MHD_add_response_header(mhdResponse, MHD_HTTP_HEADER_CACHE_CONTROL, "no-cache");
+	// reverse proxies must not buffer events
+	MHD_add_response_header(mhdResponse, "X-Accel-Buffering", "no");
+
+	if(capture) {
+		capture->bypassed = true;
+	}
+
+	std::function<bool()> sendFunc = [this, mhdResponse]() {
+	    return MHD_queue_response(&mhdConnection, MHD_HTTP_OK, mhdResponse) == MHD_YES;
+	};
+
+	try {
+		registry.add(eventStream);
+		responseQueue.push_back(std::make_tuple(sendFunc, mhdResponse));
+	}
+	catch(...) {
+		// the free callback removes the event stream from the registry
+		MHD_destroy_response(mhdResponse);
+		return nullptr;
+	}
+
+	return eventStream;
+}
+
+bool Connection::sendWebSocket(const std::string& acceptKey, std::unique_ptr<WebSocket::Upgrade> upgrade) noexcept {
+	const MHD_ConnectionInfo* socketContextInfo = MHD_get_connection_info(&mhdConnection, MHD_CONNECTION_INFO_SOCKET_CONTEXT);
+	if(socketContextInfo == nullptr || socketContextInfo->socket_context == nullptr) {
+		logger.warn << "- no connection context for WebSocket\n";
 		return false;
 	}
+	ConnectionContext& connectionContext = *static_cast<ConnectionContext*>(socketContextInfo->socket_context);
 
-	for(const auto& header : response.getHeaders()) {
-		MHD_add_response_header(mhdResponse, header.first.c_str(), header.second.c_str());
+	MHD_Response* mhdResponse = MHD_create_response_for_upgrade(&WebSocket::mhdUpgradeHandler, &connectionContext);
+	if(mhdResponse == nullptr) {
+		logger.warn << "- mhdResponse == nullptr\n";
+		return false;
+	}
+
+	// MHD adds header "Connection: Upgrade"
+	MHD_add_response_header(mhdResponse, MHD_HTTP_HEADER_UPGRADE, "websocket");
+	MHD_add_response_header(mhdResponse, "Sec-WebSocket-Accept", acceptKey.c_str());
+	if(!upgrade->settings.protocol.empty()) {
+		MHD_add_response_header(mhdResponse, "Sec-WebSocket-Protocol", upgrade->settings.protocol.c_str());
+	}
+
+	if(capture) {
+		capture->bypassed = true;
+	}
+	connectionContext.webSocketUpgrade = std::move(upgrade);
+
+	std::function<bool()> sendFunc = [this, mhdResponse]() {
+	    return MHD_queue_response(&mhdConnection, MHD_HTTP_SWITCHING_PROTOCOLS, mhdResponse) == MHD_YES;
+	};
+
+	try {
+		responseQueue.push_back(std::make_tuple(sendFunc, mhdResponse));
+	}
+	catch(...) {
+		MHD_destroy_response(mhdResponse);
+		return false;
 	}
 
+	return true;
+}
+
+bool Connection::sendResponse(const esl::com::http::server::Response& response, MHD_Response* mhdResponse) noexcept {
+	if(mhdResponse == nullptr) {
+		logger.warn << "- mhdResponse == nullptr\n";
+		return false;
+	}
+
+	addHeaders(response, mhdResponse);
+
 	std::function<bool()> sendFunc;
 	unsigned short httpStatusCode = response.getStatusCode();
 
@@ -117,47 +492,149 @@ bool Connection::sendResponse(const esl::com::http::server::Response& response,
 	return true;
 }
 
+bool Connection::sendData(const esl::com::http::server::Response& response, std::shared_ptr<const void> data, std::size_t size, const std::string& etag) noexcept {
+	if(capture) {
+		capture->bypassed = true;
+	}
+
+	std::shared_ptr<const void>* dataPtr = new (std::nothrow) std::shared_ptr<const void>(std::move(data));
+	if(dataPtr == nullptr) {
+		logger.warn << "- cannot allocate owner of mapped data\n";
+		return false;
+	}
+	MHD_Response* mhdResponse = MHD_create_response_from_buffer_with_free_callback_cls(size, dataPtr->get(), sharedDataFreeCallback, dataPtr);
+
+	if(mhdResponse == nullptr) {
+		delete dataPtr;
+	}
+	else if(!etag.empty()) {
+		MHD_add_response_header(mhdResponse, MHD_HTTP_HEADER_ETAG, etag.c_str());
+	}
+
+	return sendResponse(response, mhdResponse);
+}
+
+bool Connection::matchETag(const esl::com::http::server::Response& response, const void* data, std::size_t size, std::string& etag) const noexcept {
+	const std::string* responseETag = Headers::find(response, MHD_HTTP_HEADER_ETAG);
+	if(responseETag) {
+		return ETag::matches(ifNoneMatch, *responseETag);
+	}
+
+	try {
+		etag = ETag::create(data, size);
+	}
+	catch(...) {
+		etag.clear();
+		return false;
+	}
+	return ETag::matches(ifNoneMatch, etag);
+}
+
+bool Connection::sendNotModified(const esl::com::http::server::Response& response, const std::string& etag) noexcept {
+	MHD_Response* mhdResponse = MHD_create_response_from_buffer(0, nullptr, MHD_RESPMEM_PERSISTENT);
+	if(mhdResponse == nullptr) {
+		logger.warn << "- mhdResponse == nullptr\n";
+		return false;
+	}
+
+	// RFC 9110 15.4.5: fields of a response with status 200 that are no representation metadata
+	static const char* const keptHeaders[] = {
+			MHD_HTTP_HEADER_CACHE_CONTROL,
+			MHD_HTTP_HEADER_CONTENT_LOCATION,
+			MHD_HTTP_HEADER_ETAG,
+			MHD_HTTP_HEADER_EXPIRES,
+			MHD_HTTP_HEADER_VARY };
+	for(const auto& header : response.getHeaders()) {
+		for(const char* key : keptHeaders) {
+			if(Headers::equals(header.first, key)) {
+				MHD_add_response_header(mhdResponse, header.first.c_str(), header.second.c_str());
+				break;
+			}
+		}
+	}
+	if(!etag.empty()) {
+		MHD_add_response_header(mhdResponse, MHD_HTTP_HEADER_ETAG, etag.c_str());
+	}
+
+	Metrics::get().responsesNotModified.fetch_add(1, std::memory_order_relaxed);
+
+	std::function<bool()> sendFunc = [this, mhdResponse]() {
+	    return MHD_queue_response(&mhdConnection, MHD_HTTP_NOT_MODIFIED, mhdResponse) == MHD_YES;
+	};
+
+	responseQueue.push_back(std::make_tuple(sendFunc, mhdResponse));
+
+	return true;
+}
+
+bool Connection::sendStream(const esl::com::http::server::Response& response, Stream* stream) noexcept {
+	MHD_Response* mhdResponse = MHD_create_response_from_callback(-1, 8192, contentReaderCallback, stream, contentReaderFreeCallback);
+	if(mhdResponse == nullptr) {
+		delete stream;
+	}
+
+	return sendResponse(response, mhdResponse);
+}
+
 ssize_t Connection::contentReaderCallback(void* cls, uint64_t bytesTransmitted, char* buffer, size_t bufferSize) {
-    esl::io::Output* outputPtr = static_cast<esl::io::Output*>(cls);
-    if(outputPtr == nullptr) {
+    Stream* stream = static_cast<Stream*>(cls);
+    if(stream == nullptr) {
         return MHD_CONTENT_READER_END_OF_STREAM;
     }
 
-    std::unique_ptr<esl::system::Stacktrace> stacktrace = nullptr;
+    if(stream->prefixPos < stream->prefix.size()) {
+    	std::size_t size = std::min(bufferSize, stream->prefix.size() - stream->prefixPos);
+    	std::memcpy(buffer, stream->prefix.data() + stream->prefixPos, size);
+    	stream->prefixPos += size;
+    	return static_cast<ssize_t>(size);
+    }
+
     try {
-        std::size_t size = outputPtr->getReader().read(buffer, bufferSize);
+        std::size_t size = stream->output.getReader().read(buffer, bufferSize);
     	if(size == esl::io::Reader::npos) {
+    		Metrics::get().streamsCompleted.fetch_add(1, std::memory_order_relaxed);
             return MHD_CONTENT_READER_END_OF_STREAM;
         }
 
-        return size;
+    	if(size == 0 && stream->notifier) {
+    		// returns 0 to MHD after suspending the connection, so MHD does not poll the reader
+    		stream->notifier->wait();
+    	}
+
+        return static_cast<ssize_t>(size);
     }
-    catch (std::exception& e) {
+    catch (const std::exception& e) {
+    	// the stacktrace is dumped while the exception is still alive, so it does not have to be cloned
     	logger.error << e.what() << std::endl;
 
-    	const esl::system::Stacktrace* stacktracePtr = esl::system::Stacktrace::get(e);
-    	if(stacktracePtr) {
-            stacktrace = stacktracePtr->clone();
+    	const esl::system::Stacktrace* stacktrace = esl::system::Stacktrace::get(e);
+    	if(stacktrace) {
+    		stacktrace->dump(logger.error);
     	}
     }
     catch (...) {
     	logger.error << "unknown exception" << std::endl;
     }
 
-    if(stacktrace) {
-        stacktrace->dump(logger.error);
-    }
+    Metrics::get().streamsFailed.fetch_add(1, std::memory_order_relaxed);
     return MHD_CONTENT_READER_END_WITH_ERROR;
 }
 
 void Connection::contentReaderFreeCallback(void* cls) {
-    esl::io::Output* outputPtr = static_cast<esl::io::Output*>(cls);
+    Stream* stream = static_cast<Stream*>(cls);
 
-    if(outputPtr) {
-        delete outputPtr;
+    if(stream) {
+    	if(stream->notifier) {
+    		stream->notifier->detach();
+    	}
+        delete stream;
     }
 }
 
+void Connection::sharedDataFreeCallback(void* cls) {
+	delete static_cast<std::shared_ptr<const void>*>(cls);
+}
+
 } /* namespace server */
 } /* namespace http */
 } /* namespace com */
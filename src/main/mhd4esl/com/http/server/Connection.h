@@ -19,7 +19,13 @@
 #ifndef MHD4ESL_COM_HTTP_SERVER_CONNECTION_H_
 #define MHD4ESL_COM_HTTP_SERVER_CONNECTION_H_
 
+#include <mhd4esl/com/http/server/EventStream.h>
+#include <mhd4esl/com/http/server/StreamNotifier.h>
+#include <mhd4esl/com/http/server/WebSocket.h>
+
 #include <esl/com/http/server/Connection.h>
+#include <esl/com/http/server/MHDConnection.h>
+#include <esl/com/http/server/MHDEventStream.h>
 #include <esl/com/http/server/Response.h>
 #include <esl/io/Output.h>
 
@@ -41,6 +47,15 @@ namespace server {
 class Connection : public esl::com::http::server::Connection {
 friend class Socket;
 public:
+	/* A captured response has not been queued. The body is complete, if it did not exceed the limit of the capture. */
+	struct Capture {
+		std::size_t maxSize = 0;
+		std::unique_ptr<esl::com::http::server::Response> response;
+		std::shared_ptr<std::string> body;
+		/* true if a response has been queued that could not be captured */
+		bool bypassed = false;
+	};
+
 	Connection(MHD_Connection& mhdConnection);
 	~Connection();
 
@@ -50,18 +65,82 @@ public:
 
 	bool send(const esl::com::http::server::Response& response, const void* data, std::size_t size) noexcept;
 
+	/* segments are sent with writev, owner is released when MHD has destroyed the response */
+	bool send(const esl::com::http::server::Response& response, const std::vector<esl::com::http::server::MHDConnection::Segment>& segments, std::shared_ptr<const void> owner) noexcept;
+
+	/* data is kept alive until MHD has destroyed the response */
+	bool sendMapped(const esl::com::http::server::Response& response, std::shared_ptr<const void> data, std::size_t size) noexcept;
+
+	/* returns a read only mapping of the file that is unmapped if the last reference is released */
+	static std::shared_ptr<const void> mapFile(const std::string& path, std::size_t& size);
+
 	bool send(const esl::com::http::server::Response& response, esl::io::Output output) override;
 	bool sendFile(const esl::com::http::server::Response& response, const std::string& path) override;
 
+	/* queues a streamed response that waits for the returned notifier if its reader has no data, returns nullptr if it fails */
+	std::shared_ptr<StreamNotifier> sendNotifiable(const esl::com::http::server::Response& response, esl::io::Output output) noexcept;
+
+	/* queues a response that might be queued on other connections as well */
+	bool sendShared(unsigned short httpStatusCode, std::shared_ptr<MHD_Response> mhdResponse) noexcept;
+
+	/* Queues a cached response that might be queued on other connections as well. etag is the ETag of the
+	 * response or the one it has been given by auto ETags. It is matched like the ETag of a buffered response. */
+	bool sendShared(const esl::com::http::server::Response& response, std::shared_ptr<MHD_Response> mhdResponse, const std::string& etag) noexcept;
+
+	/* queues a response recorded by a capture, auto ETags apply as if it had not been captured */
+	bool sendCaptured(const esl::com::http::server::Response& response, std::shared_ptr<const std::string> body) noexcept;
+
+	/* queues a response with content type "text/event-stream", returns nullptr if it fails */
+	std::shared_ptr<EventStream> sendEventStream(const esl::com::http::server::MHDEventStream::Settings& settings) noexcept;
+
+	/* queues the response with status 101 to upgrade the connection to a WebSocket */
+	bool sendWebSocket(const std::string& acceptKey, std::unique_ptr<WebSocket::Upgrade> upgrade) noexcept;
+
+	/* Buffered responses and streamed responses up to maxSize are recorded instead of queued until capture is stopped */
+	void startCapture(Capture& capture) noexcept;
+	void stopCapture() noexcept;
+
+	/* Buffered responses with status 200 and streamed responses whose output completes within maxStreamSize get
+	 * an ETag of their body if they have none. If the ETag matches ifNoneMatch, a response with status 304 and
+	 * without body is queued instead. ifNoneMatch has to live as long as the connection object. */
+	void setAutoETag(const char* ifNoneMatch, std::size_t maxStreamSize) noexcept;
+	bool hasAutoETag() const noexcept;
+
+	static void addHeaders(const esl::com::http::server::Response& response, MHD_Response* mhdResponse) noexcept;
+
 private:
+	struct Stream {
+		std::string prefix;
+		std::size_t prefixPos = 0;
+		esl::io::Output output;
+		std::shared_ptr<StreamNotifier> notifier;
+	};
+
 	bool sendResponse(const esl::com::http::server::Response& response, MHD_Response* mhdResponse) noexcept;
+	/* data is kept alive until MHD has destroyed the response, etag is added as header if it is not empty */
+	bool sendData(const esl::com::http::server::Response& response, std::shared_ptr<const void> data, std::size_t size, const std::string& etag) noexcept;
+
+	/* Returns true if the ETag of the response matches "If-None-Match". etag is set if it has been created,
+	 * because the response has none. */
+	bool matchETag(const esl::com::http::server::Response& response, const void* data, std::size_t size, std::string& etag) const noexcept;
+	bool sendNotModified(const esl::com::http::server::Response& response, const std::string& etag) noexcept;
+	bool sendStream(const esl::com::http::server::Response& response, Stream* stream) noexcept;
+	/* Reads the output into body until it is complete, body exceeds maxSize or the reader has no data.
+	 * Returns true if the output is complete. */
+	static bool readOutput(esl::io::Output& output, std::string& body, std::size_t maxSize);
 
     static ssize_t contentReaderCallback(void* cls, uint64_t bytesTransmitted, char* buffer, size_t bufferSize);
     static void contentReaderFreeCallback(void* cls);
+    static void sharedDataFreeCallback(void* cls);
 
 	MHD_Connection& mhdConnection;
 	std::vector<std::tuple<std::function<bool()>, MHD_Response*>> responseQueue;
 	bool responseSent = false;
+	Capture* capture = nullptr;
+
+	bool autoETag = false;
+	const char* ifNoneMatch = nullptr;
+	std::size_t autoETagStreamSize = 0;
 };
 
 } /* namespace server */
@@ -0,0 +1,137 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_CONNECTIONCONTEXT_H_
+#define MHD4ESL_COM_HTTP_SERVER_CONNECTIONCONTEXT_H_
+
+#include <mhd4esl/com/http/server/CertificateStore.h>
+#include <mhd4esl/com/http/server/TrustedProxies.h>
+#include <mhd4esl/com/http/server/WebSocket.h>
+
+#include <esl/com/http/server/MHDRequest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct MHD_Connection;
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+class ClientCertificateCache;
+struct ClientCertificate;
+class EventStreamRegistry;
+class FileReadAhead;
+class StreamNotifierRegistry;
+
+/* State that lives as long as the TCP connection, i.e. across all requests of a keep-alive connection. */
+struct ConnectionContext {
+	enum class State : int {
+		waiting,
+		handler,
+		uploading,
+		sending,
+		upgraded
+	};
+
+	/* set only if the peer of the connection is a trusted proxy */
+	const TrustedProxies* trustedProxies = nullptr;
+
+	/* forwarding header of the previous request and the client address resolved from it */
+	bool hasForwardedAddress = false;
+	bool isForwardedRfc7239 = false;
+	std::string forwardedHeader;
+	esl::com::http::server::MHDRequest::Address forwardedAddress;
+
+	WebSocketReactor* webSocketReactor = nullptr;
+	EventStreamRegistry* eventStreamRegistry = nullptr;
+	const CertificateStore* certificateStore = nullptr;
+	/* set by the ClientHello of the TLS handshake */
+	CertificateStore::ClientPkAlgorithms clientPkAlgorithms;
+	/* socket of the connection if the callbacks of the TLS handshake can find this context by it, otherwise -1 */
+	int tlsSocket = -1;
+
+	/* Set only if client certificates are requested. The certificate is verified by the first request of the
+	 * connection, clientCertificate is nullptr if the client has not sent a valid one. */
+	ClientCertificateCache* clientCertificateCache = nullptr;
+	bool clientCertificateVerified = false;
+	std::shared_ptr<const ClientCertificate> clientCertificate;
+
+	/* set only if files are read ahead */
+	FileReadAhead* fileReadAhead = nullptr;
+
+	/* true if the daemon has been started with suspend/resume */
+	bool suspendable = false;
+	/* set only if the daemon has been started with suspend/resume */
+	StreamNotifierRegistry* streamNotifierRegistry = nullptr;
+
+	/* buffer of small request bodies, it keeps its capacity for the next request of the connection */
+	std::string bodyBuffer;
+
+	/* set when the response to upgrade the connection has been queued */
+	std::unique_ptr<WebSocket::Upgrade> webSocketUpgrade;
+
+	/* Runtime limits of the socket. key identifies the client address for the per IP connection limit and
+	 * connectionTimeout is the timeout that has been set for this connection. */
+	bool limited = false;
+	std::string limitKey;
+	unsigned int connectionTimeout = 0;
+
+	/* Introspection of the socket. Only if tracked is true, the connection is part of the intrusive list
+	 * of the socket and the counters are updated. prev, next and the TLS strings are guarded by the
+	 * mutex of that list, the other values are written by the thread that handles the connection. */
+	bool tracked = false;
+	ConnectionContext* prev = nullptr;
+	ConnectionContext* next = nullptr;
+	MHD_Connection* mhdConnection = nullptr;
+	std::chrono::steady_clock::time_point startTime;
+	std::string tlsProtocol;
+	std::string tlsCipher;
+	std::atomic<int> state{static_cast<int>(State::waiting)};
+	/* time_since_epoch() of steady_clock in nanoseconds when the state has been set */
+	std::atomic<std::int64_t> stateTime{0};
+	std::atomic<std::uint64_t> requests{0};
+	std::atomic<std::uint64_t> bodyBytesReceived{0};
+
+	void setState(State aState) noexcept {
+		if(tracked) {
+			state.store(static_cast<int>(aState), std::memory_order_relaxed);
+			stateTime.store(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+		}
+	}
+
+	void addBodyBytesReceived(std::uint64_t size) noexcept {
+		if(tracked) {
+			bodyBytesReceived.fetch_add(size, std::memory_order_relaxed);
+		}
+	}
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_CONNECTIONCONTEXT_H_ */
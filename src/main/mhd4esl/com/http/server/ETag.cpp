@@ -0,0 +1,199 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/ETag.h>
+
+#include <cstring>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+const std::uint64_t prime1 = 11400714785074694791ULL;
+const std::uint64_t prime2 = 14029467366897019727ULL;
+const std::uint64_t prime3 = 1609587929392839161ULL;
+const std::uint64_t prime4 = 9650029242287828579ULL;
+const std::uint64_t prime5 = 2870177450012600261ULL;
+
+inline std::uint64_t rotl(std::uint64_t value, unsigned int bits) noexcept {
+	return (value << bits) | (value >> (64 - bits));
+}
+
+// little endian loads, compilers turn them into a single load on little endian machines
+inline std::uint64_t read64(const unsigned char* ptr) noexcept {
+	return static_cast<std::uint64_t>(ptr[0])
+			| static_cast<std::uint64_t>(ptr[1]) << 8
+			| static_cast<std::uint64_t>(ptr[2]) << 16
+			| static_cast<std::uint64_t>(ptr[3]) << 24
+			| static_cast<std::uint64_t>(ptr[4]) << 32
+			| static_cast<std::uint64_t>(ptr[5]) << 40
+			| static_cast<std::uint64_t>(ptr[6]) << 48
+			| static_cast<std::uint64_t>(ptr[7]) << 56;
+}
+
+inline std::uint64_t read32(const unsigned char* ptr) noexcept {
+	return static_cast<std::uint64_t>(ptr[0])
+			| static_cast<std::uint64_t>(ptr[1]) << 8
+			| static_cast<std::uint64_t>(ptr[2]) << 16
+			| static_cast<std::uint64_t>(ptr[3]) << 24;
+}
+
+inline std::uint64_t round(std::uint64_t acc, std::uint64_t input) noexcept {
+	acc += input * prime2;
+	acc = rotl(acc, 31);
+	return acc * prime1;
+}
+
+inline std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t value) noexcept {
+	acc ^= round(0, value);
+	return acc * prime1 + prime4;
+}
+
+/* opaque tag of an entity tag without the weak indicator, nullptr if it is not a quoted string */
+const char* parseOpaqueTag(const char* begin, const char* end, std::size_t& size) noexcept {
+	if(end - begin >= 2 && begin[0] == 'W' && begin[1] == '/') {
+		begin += 2;
+	}
+	if(end - begin < 2 || begin[0] != '"' || end[-1] != '"') {
+		return nullptr;
+	}
+	size = static_cast<std::size_t>(end - begin);
+	return begin;
+}
+}
+
+std::string ETag::create(const void* data, std::size_t size) {
+	static const char digits[] = "0123456789abcdef";
+
+	std::uint64_t hash = xxh64(data, size);
+	std::string etag(18, '"');
+	for(std::size_t i = 16; i > 0; --i) {
+		etag[i] = digits[hash & 0x0f];
+		hash >>= 4;
+	}
+	return etag;
+}
+
+bool ETag::matches(const char* ifNoneMatch, const std::string& etag) noexcept {
+	if(ifNoneMatch == nullptr) {
+		return false;
+	}
+
+	std::size_t etagSize = 0;
+	const char* etagTag = parseOpaqueTag(etag.data(), etag.data() + etag.size(), etagSize);
+	if(etagTag == nullptr) {
+		return false;
+	}
+
+	// comma separated list of entity tags or "*"
+	const char* ptr = ifNoneMatch;
+	while(*ptr != 0) {
+		while(*ptr == ' ' || *ptr == '\t' || *ptr == ',') {
+			++ptr;
+		}
+		const char* begin = ptr;
+		bool quoted = false;
+		while(*ptr != 0 && (quoted || *ptr != ',')) {
+			if(*ptr == '"') {
+				quoted = !quoted;
+			}
+			++ptr;
+		}
+		const char* end = ptr;
+		while(end > begin && (end[-1] == ' ' || end[-1] == '\t')) {
+			--end;
+		}
+
+		if(end - begin == 1 && *begin == '*') {
+			return true;
+		}
+
+		std::size_t size = 0;
+		const char* tag = parseOpaqueTag(begin, end, size);
+		if(tag && size == etagSize && std::memcmp(tag, etagTag, size) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::uint64_t ETag::xxh64(const void* data, std::size_t size, std::uint64_t seed) noexcept {
+	const unsigned char* ptr = static_cast<const unsigned char*>(data);
+	const unsigned char* const end = ptr + size;
+	std::uint64_t hash;
+
+	if(size >= 32) {
+		// four independent lanes, so the loop is not limited by the latency of the multiplications
+		std::uint64_t v1 = seed + prime1 + prime2;
+		std::uint64_t v2 = seed + prime2;
+		std::uint64_t v3 = seed;
+		std::uint64_t v4 = seed - prime1;
+
+		const unsigned char* const limit = end - 32;
+		do {
+			v1 = round(v1, read64(ptr));
+			v2 = round(v2, read64(ptr + 8));
+			v3 = round(v3, read64(ptr + 16));
+			v4 = round(v4, read64(ptr + 24));
+			ptr += 32;
+		} while(ptr <= limit);
+
+		hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+		hash = mergeRound(hash, v1);
+		hash = mergeRound(hash, v2);
+		hash = mergeRound(hash, v3);
+		hash = mergeRound(hash, v4);
+	}
+	else {
+		hash = seed + prime5;
+	}
+
+	hash += static_cast<std::uint64_t>(size);
+
+	for(; end - ptr >= 8; ptr += 8) {
+		hash ^= round(0, read64(ptr));
+		hash = rotl(hash, 27) * prime1 + prime4;
+	}
+	if(end - ptr >= 4) {
+		hash ^= read32(ptr) * prime1;
+		hash = rotl(hash, 23) * prime2 + prime3;
+		ptr += 4;
+	}
+	for(; ptr < end; ++ptr) {
+		hash ^= *ptr * prime5;
+		hash = rotl(hash, 11) * prime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	hash *= prime3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
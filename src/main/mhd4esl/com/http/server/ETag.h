@@ -0,0 +1,52 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_ETAG_H_
+#define MHD4ESL_COM_HTTP_SERVER_ETAG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Entity tags of generated responses. They are not cryptographic, they only have to change if the body changes. */
+class ETag {
+public:
+	ETag() = delete;
+
+	/* strong entity tag of the XXH64 hash of the body, e.g. "\"a1b2c3d4e5f60718\"" */
+	static std::string create(const void* data, std::size_t size);
+
+	/* true if the value of header "If-None-Match" matches the entity tag by the weak comparison of RFC 9110 */
+	static bool matches(const char* ifNoneMatch, const std::string& etag) noexcept;
+
+	static std::uint64_t xxh64(const void* data, std::size_t size, std::uint64_t seed = 0) noexcept;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_ETAG_H_ */
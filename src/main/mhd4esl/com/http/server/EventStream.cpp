@@ -0,0 +1,258 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/EventStream.h>
+#include <mhd4esl/com/http/server/EventStreamRegistry.h>
+
+#include <microhttpd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+const std::string heartbeatComment(":\n\n");
+
+/* field values end at the first line break */
+void appendField(std::string& str, const char* name, const std::string& value) {
+	str += name;
+	str += ": ";
+	str.append(value, 0, value.find_first_of("\r\n"));
+	str += '\n';
+}
+}
+
+EventStream::EventStream(MHD_Connection& aMhdConnection, EventStreamRegistry& aRegistry, const esl::com::http::server::MHDEventStream::Settings& aSettings)
+: mhdConnection(&aMhdConnection),
+  registry(aRegistry),
+  settings(aSettings),
+  lastActivity(std::chrono::steady_clock::now())
+{
+	if(settings.retryMs > 0) {
+		Event event;
+		event.data = "retry: " + std::to_string(settings.retryMs) + "\n\n";
+		queuedSize = event.data.size();
+		events.push_back(std::move(event));
+	}
+}
+
+bool EventStream::push(const std::string& data, const std::string& type, const std::string& id) {
+	Event event;
+	event.type = type.substr(0, type.find_first_of("\r\n"));
+	event.data.reserve(data.size() + type.size() + id.size() + 32);
+
+	if(!id.empty()) {
+		appendField(event.data, "id", id);
+	}
+	if(!event.type.empty()) {
+		appendField(event.data, "event", event.type);
+	}
+
+	// every line of data becomes a field
+	std::string::size_type pos = 0;
+	do {
+		std::string::size_type end = data.find('\n', pos);
+		std::string::size_type lineEnd = (end == std::string::npos) ? data.size() : end;
+		if(lineEnd > pos && data[lineEnd - 1] == '\r') {
+			--lineEnd;
+		}
+
+		event.data += "data: ";
+		event.data.append(data, pos, lineEnd - pos);
+		event.data += '\n';
+
+		pos = (end == std::string::npos) ? std::string::npos : end + 1;
+	} while(pos != std::string::npos);
+	event.data += '\n';
+
+	MHD_Connection* resumeConnection = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(closed) {
+			return false;
+		}
+
+		if(settings.coalesce && !event.type.empty()) {
+			// the first event cannot be replaced if it has been sent partially
+			auto iter = events.begin();
+			if(eventOffset > 0 && iter != events.end()) {
+				++iter;
+			}
+			for(; iter != events.end(); ++iter) {
+				if(iter->type == event.type) {
+					queuedSize = queuedSize - iter->data.size() + event.data.size();
+					iter->data = std::move(event.data);
+					return true;
+				}
+			}
+		}
+
+		if(queuedSize > 0 && queuedSize + event.data.size() > settings.maxQueueSize) {
+			return false;
+		}
+
+		queuedSize += event.data.size();
+		events.push_back(std::move(event));
+		resumeConnection = wakeUp();
+	}
+
+	if(resumeConnection) {
+		MHD_resume_connection(resumeConnection);
+	}
+
+	return true;
+}
+
+void EventStream::close() {
+	MHD_Connection* resumeConnection = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(closed) {
+			return;
+		}
+		closed = true;
+		resumeConnection = wakeUp();
+	}
+
+	if(resumeConnection) {
+		MHD_resume_connection(resumeConnection);
+	}
+}
+
+bool EventStream::isClosed() const noexcept {
+	std::lock_guard<std::mutex> lock(mutex);
+	return closed;
+}
+
+void EventStream::heartbeat(std::chrono::steady_clock::time_point now) noexcept {
+	MHD_Connection* resumeConnection = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(closed || settings.heartbeatSeconds == 0 || !events.empty()
+				|| now < lastActivity + std::chrono::seconds(settings.heartbeatSeconds)) {
+			return;
+		}
+
+		try {
+			Event event;
+			event.data = heartbeatComment;
+			queuedSize += event.data.size();
+			events.push_back(std::move(event));
+		}
+		catch(...) {
+			return;
+		}
+		lastActivity = now;
+		resumeConnection = wakeUp();
+	}
+
+	if(resumeConnection) {
+		MHD_resume_connection(resumeConnection);
+	}
+}
+
+ssize_t EventStream::contentReaderCallback(void* cls, uint64_t, char* buffer, size_t bufferSize) {
+	std::shared_ptr<EventStream>& eventStream = *static_cast<std::shared_ptr<EventStream>*>(cls);
+	return eventStream->read(buffer, bufferSize);
+}
+
+void EventStream::contentReaderFreeCallback(void* cls) {
+	std::shared_ptr<EventStream>* eventStream = static_cast<std::shared_ptr<EventStream>*>(cls);
+	(*eventStream)->detach();
+	delete eventStream;
+}
+
+ssize_t EventStream::read(char* buffer, std::size_t bufferSize) noexcept {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(true) {
+		// all waiting events are sent at once, as far as they fit into the buffer
+		if(!events.empty()) {
+			std::size_t size = 0;
+
+			while(!events.empty() && size < bufferSize) {
+				const std::string& data = events.front().data;
+				const std::size_t count = std::min(bufferSize - size, data.size() - eventOffset);
+
+				std::memcpy(buffer + size, data.data() + eventOffset, count);
+				size += count;
+				eventOffset += count;
+
+				if(eventOffset == data.size()) {
+					queuedSize -= data.size();
+					eventOffset = 0;
+					events.pop_front();
+				}
+			}
+
+			lastActivity = std::chrono::steady_clock::now();
+			return static_cast<ssize_t>(size);
+		}
+
+		if(closed) {
+			return MHD_CONTENT_READER_END_OF_STREAM;
+		}
+
+		if(registry.isSuspendable()) {
+			// MHD calls this method again after the connection has been resumed
+			suspended = true;
+			MHD_suspend_connection(mhdConnection);
+			return 0;
+		}
+
+		condVar.wait(lock);
+	}
+}
+
+void EventStream::detach() noexcept {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		closed = true;
+		mhdConnection = nullptr;
+		events.clear();
+		queuedSize = 0;
+		eventOffset = 0;
+	}
+
+	registry.remove(*this);
+}
+
+MHD_Connection* EventStream::wakeUp() noexcept {
+	condVar.notify_one();
+
+	if(!suspended) {
+		return nullptr;
+	}
+	suspended = false;
+	return mhdConnection;
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
@@ -0,0 +1,94 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_EVENTSTREAM_H_
+#define MHD4ESL_COM_HTTP_SERVER_EVENTSTREAM_H_
+
+#include <esl/com/http/server/MHDEventStream.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <sys/types.h>
+
+struct MHD_Connection;
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+class EventStreamRegistry;
+
+/* Body of a response with content type "text/event-stream". If no event is waiting, the content reader
+ * suspends the connection and a push resumes it. Without suspend/resume the content reader waits instead. */
+class EventStream : public esl::com::http::server::MHDEventStream::Sink {
+public:
+	EventStream(MHD_Connection& mhdConnection, EventStreamRegistry& registry, const esl::com::http::server::MHDEventStream::Settings& settings);
+
+	bool push(const std::string& data, const std::string& event, const std::string& id) override;
+	void close() override;
+	bool isClosed() const noexcept override;
+
+	/* called periodically by the registry */
+	void heartbeat(std::chrono::steady_clock::time_point now) noexcept;
+
+	static ssize_t contentReaderCallback(void* cls, uint64_t bytesTransmitted, char* buffer, size_t bufferSize);
+	static void contentReaderFreeCallback(void* cls);
+
+private:
+	struct Event {
+		std::string type;
+		std::string data;
+	};
+
+	ssize_t read(char* buffer, std::size_t bufferSize) noexcept;
+	void detach() noexcept;
+
+	/* requires a lock of mutex. Returns the connection if it has to be resumed. */
+	MHD_Connection* wakeUp() noexcept;
+
+	MHD_Connection* mhdConnection;
+	EventStreamRegistry& registry;
+	const esl::com::http::server::MHDEventStream::Settings settings;
+
+	mutable std::mutex mutex;
+	std::condition_variable condVar;
+	std::deque<Event> events;
+	std::size_t queuedSize = 0;
+	/* bytes of the first event that have been sent already */
+	std::size_t eventOffset = 0;
+	bool suspended = false;
+	bool closed = false;
+	std::chrono::steady_clock::time_point lastActivity;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_EVENTSTREAM_H_ */
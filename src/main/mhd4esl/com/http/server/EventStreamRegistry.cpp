@@ -0,0 +1,125 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/EventStreamRegistry.h>
+#include <mhd4esl/com/http/server/EventStream.h>
+
+#include <chrono>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+EventStreamRegistry::EventStreamRegistry(bool aSuspendable)
+: suspendable(aSuspendable)
+{ }
+
+EventStreamRegistry::~EventStreamRegistry() {
+	stop();
+}
+
+bool EventStreamRegistry::isSuspendable() const noexcept {
+	return suspendable;
+}
+
+void EventStreamRegistry::add(const std::shared_ptr<EventStream>& eventStream) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(!stopped) {
+			eventStreams[eventStream.get()] = eventStream;
+
+			// heartbeats are sent by a thread that is started for the first event stream
+			if(!thread.joinable()) {
+				thread = std::thread(&EventStreamRegistry::run, this);
+			}
+			return;
+		}
+	}
+
+	eventStream->close();
+}
+
+void EventStreamRegistry::remove(EventStream& eventStream) noexcept {
+	std::shared_ptr<EventStream> removedEventStream;
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto iter = eventStreams.find(&eventStream);
+	if(iter != eventStreams.end()) {
+		// the event stream is released after the lock
+		removedEventStream = std::move(iter->second);
+		eventStreams.erase(iter);
+	}
+}
+
+void EventStreamRegistry::stop() noexcept {
+	std::unordered_map<EventStream*, std::shared_ptr<EventStream>> stoppedEventStreams;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(stopped) {
+			return;
+		}
+		stopped = true;
+		stoppedEventStreams = eventStreams;
+	}
+	condVar.notify_all();
+
+	if(thread.joinable()) {
+		thread.join();
+	}
+
+	// suspended connections are resumed, so they can be closed by MHD_stop_daemon
+	for(auto& entry : stoppedEventStreams) {
+		entry.second->close();
+	}
+}
+
+void EventStreamRegistry::run() noexcept {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(!condVar.wait_for(lock, std::chrono::seconds(1), [this] { return stopped; })) {
+		std::vector<std::shared_ptr<EventStream>> heartbeatEventStreams;
+		try {
+			heartbeatEventStreams.reserve(eventStreams.size());
+			for(auto& entry : eventStreams) {
+				heartbeatEventStreams.push_back(entry.second);
+			}
+		}
+		catch(...) {
+			continue;
+		}
+
+		lock.unlock();
+		const auto now = std::chrono::steady_clock::now();
+		for(auto& eventStream : heartbeatEventStreams) {
+			eventStream->heartbeat(now);
+		}
+		heartbeatEventStreams.clear();
+		lock.lock();
+	}
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
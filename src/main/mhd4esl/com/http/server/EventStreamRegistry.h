@@ -0,0 +1,70 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_EVENTSTREAMREGISTRY_H_
+#define MHD4ESL_COM_HTTP_SERVER_EVENTSTREAMREGISTRY_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+class EventStream;
+
+/* Event streams of a socket. A single thread sends heartbeats for all of them and
+ * all streams are closed before the daemon is stopped. */
+class EventStreamRegistry {
+public:
+	/* suspendable has to be true if the daemon supports suspending connections */
+	EventStreamRegistry(bool suspendable);
+	~EventStreamRegistry();
+
+	bool isSuspendable() const noexcept;
+
+	void add(const std::shared_ptr<EventStream>& eventStream);
+	void remove(EventStream& eventStream) noexcept;
+
+	/* closes all event streams */
+	void stop() noexcept;
+
+private:
+	void run() noexcept;
+
+	const bool suspendable;
+
+	std::mutex mutex;
+	std::condition_variable condVar;
+	bool stopped = false;
+	std::thread thread;
+	std::unordered_map<EventStream*, std::shared_ptr<EventStream>> eventStreams;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_EVENTSTREAMREGISTRY_H_ */
@@ -0,0 +1,182 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/Executor.h>
+
+#include <esl/Logger.h>
+#include <esl/system/Stacktrace.h>
+
+#include <exception>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+esl::Logger logger("mhd4esl::com::http::server::Executor");
+thread_local bool workerThread = false;
+}
+
+Executor::Executor(std::size_t numThreads) {
+	for(std::size_t i = 0; i < numThreads; ++i) {
+		workers.emplace_back(new Worker);
+	}
+	for(std::size_t i = 0; i < numThreads; ++i) {
+		threads.emplace_back(&Executor::run, this, i);
+	}
+}
+
+Executor::~Executor() {
+	stop();
+}
+
+void Executor::submit(std::function<void()> task) {
+	bool runInline = false;
+	{
+		std::lock_guard<std::mutex> lock(waitMutex);
+		if(stopped || workers.empty()) {
+			runInline = true;
+		}
+		else {
+			++pendingTasks;
+		}
+	}
+
+	if(runInline) {
+		task();
+		return;
+	}
+
+	Worker& worker = *workers[nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+
+	// a worker checks the queues while holding waitMutex, so locking it makes sure the notification is not lost
+	{
+		std::lock_guard<std::mutex> lock(waitMutex);
+	}
+	waitCondVar.notify_one();
+}
+
+void Executor::stop() {
+	{
+		std::lock_guard<std::mutex> lock(waitMutex);
+		stopped = true;
+	}
+	waitCondVar.notify_all();
+
+	for(auto& thread : threads) {
+		if(thread.joinable()) {
+			thread.join();
+		}
+	}
+}
+
+std::size_t Executor::getThreadCount() const noexcept {
+	return threads.size();
+}
+
+std::size_t Executor::getPendingTaskCount() const noexcept {
+	return pendingTasks.load(std::memory_order_relaxed);
+}
+
+bool Executor::isWorkerThread() noexcept {
+	return workerThread;
+}
+
+void Executor::run(std::size_t index) {
+	std::function<void()> task;
+	workerThread = true;
+
+	while(true) {
+		if(pop(index, task)) {
+			pendingTasks.fetch_sub(1);
+
+			try {
+				task();
+			}
+			catch (const std::exception& e) {
+				logger.error << "std::exception::what(): " << e.what() << std::endl;
+
+				const esl::system::Stacktrace* stacktrace = esl::system::Stacktrace::get(e);
+				if(stacktrace) {
+					logger.error << "Stacktrace:\n";
+					stacktrace->dump(logger.error);
+				}
+			}
+			catch (...) {
+				logger.error << "unknown exception" << std::endl;
+			}
+			task = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(waitMutex);
+		waitCondVar.wait(lock, [this] {
+			// waiting for published tasks instead of pendingTasks, which is incremented before the task is queued
+			return stopped || hasTasks();
+		});
+		if(stopped && pendingTasks.load() == 0) {
+			break;
+		}
+	}
+}
+
+bool Executor::pop(std::size_t index, std::function<void()>& task) {
+	for(std::size_t i = 0; i < workers.size(); ++i) {
+		Worker& worker = *workers[(index + i) % workers.size()];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+
+		if(worker.tasks.empty()) {
+			continue;
+		}
+
+		// take own tasks from the front and steal tasks of other workers from the back
+		if(i == 0) {
+			task = std::move(worker.tasks.front());
+			worker.tasks.pop_front();
+		}
+		else {
+			task = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+		}
+		return true;
+	}
+
+	return false;
+}
+
+bool Executor::hasTasks() {
+	for(auto& worker : workers) {
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		if(!worker->tasks.empty()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
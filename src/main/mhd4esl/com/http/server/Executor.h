@@ -0,0 +1,83 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_EXECUTOR_H_
+#define MHD4ESL_COM_HTTP_SERVER_EXECUTOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Work stealing thread pool. Every worker has its own queue, idle workers take tasks from the queues of other workers. */
+class Executor {
+public:
+	Executor(std::size_t numThreads);
+	~Executor();
+
+	/* If the executor is stopped already, the task is executed by the calling thread. */
+	void submit(std::function<void()> task);
+
+	/* executes all submitted tasks and joins the threads */
+	void stop();
+
+	std::size_t getThreadCount() const noexcept;
+	std::size_t getPendingTaskCount() const noexcept;
+
+	/* returns true if the calling thread is a worker thread of any executor */
+	static bool isWorkerThread() noexcept;
+
+private:
+	struct Worker {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	void run(std::size_t index);
+	bool pop(std::size_t index, std::function<void()>& task);
+	bool hasTasks();
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+	std::atomic<std::size_t> nextWorker{0};
+
+	std::mutex waitMutex;
+	std::condition_variable waitCondVar;
+	/* counts tasks from submit until they are taken from a queue, so stop() does not miss tasks being published */
+	std::atomic<std::size_t> pendingTasks{0};
+	bool stopped = false;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_EXECUTOR_H_ */
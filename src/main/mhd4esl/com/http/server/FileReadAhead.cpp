@@ -0,0 +1,349 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/FileReadAhead.h>
+#include <mhd4esl/com/http/server/Executor.h>
+
+#include <esl/Logger.h>
+#include <esl/system/Stacktrace.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define MHD4ESL_IO_URING
+#endif
+#endif
+
+#ifdef MHD4ESL_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+esl::Logger logger("mhd4esl::com::http::server::FileReadAhead");
+
+ssize_t readFile(int fd, void* buffer, std::size_t size, std::uint64_t offset) noexcept {
+	while(true) {
+		ssize_t rv = pread(fd, buffer, size, static_cast<off_t>(offset));
+		if(rv >= 0) {
+			return rv;
+		}
+		if(errno != EINTR) {
+			return -errno;
+		}
+	}
+}
+} /* anonymous namespace */
+
+#ifdef MHD4ESL_IO_URING
+/* io_uring by raw system calls, so there is no dependency to liburing. Reads are submitted by the threads
+ * of MHD and completed by a separate thread. */
+class FileReadAhead::IoUring {
+public:
+	/* throws an exception if the kernel does not support io_uring or if it is not permitted */
+	IoUring(FileReadAhead& readAhead, unsigned int entries);
+	~IoUring();
+
+	/* returns false if the submission queue is full */
+	bool submit(Read& read, int fd, void* buffer, std::size_t size, std::uint64_t offset) noexcept;
+
+private:
+	bool submit(std::uint8_t opcode, int fd, const void* address, std::uint32_t length, std::uint64_t offset, std::uint64_t userData) noexcept;
+	void run() noexcept;
+	void unmap() noexcept;
+
+	FileReadAhead& readAhead;
+	int ringFd = -1;
+	unsigned int sqEntries = 0;
+
+	void* sqRing = MAP_FAILED;
+	std::size_t sqRingSize = 0;
+	void* cqRing = MAP_FAILED;
+	std::size_t cqRingSize = 0;
+	void* sqesMapping = MAP_FAILED;
+	std::size_t sqesSize = 0;
+
+	unsigned int* sqHead = nullptr;
+	unsigned int* sqTail = nullptr;
+	unsigned int* sqMask = nullptr;
+	unsigned int* sqArray = nullptr;
+	io_uring_sqe* sqes = nullptr;
+
+	unsigned int* cqHead = nullptr;
+	unsigned int* cqTail = nullptr;
+	unsigned int* cqMask = nullptr;
+	io_uring_cqe* cqes = nullptr;
+
+	std::mutex submitMutex;
+	std::thread thread;
+};
+
+FileReadAhead::IoUring::IoUring(FileReadAhead& aReadAhead, unsigned int entries)
+: readAhead(aReadAhead)
+{
+	io_uring_params params;
+	std::memset(&params, 0, sizeof(params));
+
+	ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+	if(ringFd < 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error("io_uring_setup failed: " + std::string(std::strerror(errno))));
+	}
+
+	// without NODROP the kernel drops completions if the completion queue is full, so reads would never complete
+#ifdef IORING_FEAT_NODROP
+	const bool noDrop = (params.features & IORING_FEAT_NODROP) != 0;
+#else
+	const bool noDrop = false;
+#endif
+	if(!noDrop) {
+		close(ringFd);
+		throw esl::system::Stacktrace::add(std::runtime_error("io_uring does not support IORING_FEAT_NODROP"));
+	}
+	sqEntries = params.sq_entries;
+
+	sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	const bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if(singleMapping) {
+		sqRingSize = std::max(sqRingSize, cqRingSize);
+		cqRingSize = sqRingSize;
+	}
+
+	sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+	if(sqRing != MAP_FAILED) {
+		cqRing = singleMapping ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+	}
+	if(cqRing != MAP_FAILED) {
+		sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		sqesMapping = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+	}
+	if(sqesMapping == MAP_FAILED) {
+		int error = errno;
+		unmap();
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot map io_uring: " + std::string(std::strerror(error))));
+	}
+
+	char* sq = static_cast<char*>(sqRing);
+	sqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+	sqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+	sqMask = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+	sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+	sqes = static_cast<io_uring_sqe*>(sqesMapping);
+
+	char* cq = static_cast<char*>(cqRing);
+	cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+	cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+	cqMask = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+	cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+	try {
+		thread = std::thread(&IoUring::run, this);
+	}
+	catch(...) {
+		unmap();
+		throw;
+	}
+}
+
+FileReadAhead::IoUring::~IoUring() {
+	// a NOP without user data stops the completion thread
+	while(!submit(IORING_OP_NOP, -1, nullptr, 0, 0, 0)) {
+		std::this_thread::yield();
+	}
+	thread.join();
+	unmap();
+}
+
+bool FileReadAhead::IoUring::submit(Read& read, int fd, void* buffer, std::size_t size, std::uint64_t offset) noexcept {
+	read.iov.iov_base = buffer;
+	read.iov.iov_len = size;
+	return submit(IORING_OP_READV, fd, &read.iov, 1, offset, reinterpret_cast<std::uint64_t>(&read));
+}
+
+bool FileReadAhead::IoUring::submit(std::uint8_t opcode, int fd, const void* address, std::uint32_t length, std::uint64_t offset, std::uint64_t userData) noexcept {
+	std::lock_guard<std::mutex> lock(submitMutex);
+
+	// the tail is written by this process only, the head by the kernel only
+	unsigned int tail = *sqTail;
+	if(tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+		return false;
+	}
+
+	unsigned int index = tail & *sqMask;
+	io_uring_sqe& sqe = sqes[index];
+	std::memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = opcode;
+	sqe.fd = fd;
+	sqe.addr = reinterpret_cast<std::uint64_t>(address);
+	sqe.len = length;
+	sqe.off = offset;
+	sqe.user_data = userData;
+	sqArray[index] = index;
+	__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+	// if this fails, the entry is submitted by the next call of io_uring_enter
+	while(syscall(__NR_io_uring_enter, ringFd, 1, 0, 0, nullptr, 0) < 0 && errno == EINTR) {
+	}
+	return true;
+}
+
+void FileReadAhead::IoUring::run() noexcept {
+	bool stopped = false;
+
+	while(!stopped) {
+		// submits entries that could not be submitted by their thread as well
+		if(syscall(__NR_io_uring_enter, ringFd, sqEntries, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0
+				&& errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+			logger.error << "io_uring_enter failed: " << std::strerror(errno) << "\n";
+			break;
+		}
+
+		unsigned int head = *cqHead;
+		unsigned int tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+		for(; head != tail; ++head) {
+			const io_uring_cqe& cqe = cqes[head & *cqMask];
+			if(cqe.user_data == 0) {
+				stopped = true;
+			}
+			else {
+				readAhead.completeRead(*reinterpret_cast<Read*>(cqe.user_data), cqe.res);
+			}
+		}
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+	}
+}
+
+void FileReadAhead::IoUring::unmap() noexcept {
+	if(sqesMapping != MAP_FAILED) {
+		munmap(sqesMapping, sqesSize);
+	}
+	if(cqRing != MAP_FAILED && cqRing != sqRing) {
+		munmap(cqRing, cqRingSize);
+	}
+	if(sqRing != MAP_FAILED) {
+		munmap(sqRing, sqRingSize);
+	}
+	close(ringFd);
+}
+#else
+class FileReadAhead::IoUring {
+public:
+	bool submit(Read&, int, void*, std::size_t, std::uint64_t) noexcept {
+		return false;
+	}
+};
+#endif
+
+FileReadAhead::FileReadAhead(std::size_t numThreads) {
+#ifdef MHD4ESL_IO_URING
+	try {
+		ioUring.reset(new IoUring(*this, 256));
+		return;
+	}
+	catch(const std::exception& e) {
+		logger.warn << "Files are read by threads, because io_uring is not available: " << e.what() << "\n";
+	}
+#endif
+	executor.reset(new Executor(numThreads));
+}
+
+FileReadAhead::~FileReadAhead() {
+	stop();
+}
+
+void FileReadAhead::read(Read& read, int fd, void* buffer, std::size_t size, std::uint64_t offset) noexcept {
+	bool isStopped;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		isStopped = stopped;
+		if(!isStopped) {
+			++pendingReads;
+		}
+	}
+
+	if(isStopped) {
+		read.completed(readFile(fd, buffer, size, offset));
+		return;
+	}
+
+	if(ioUring) {
+		if(ioUring->submit(read, fd, buffer, size, offset)) {
+			return;
+		}
+	}
+	else {
+		try {
+			executor->submit([this, &read, fd, buffer, size, offset]() {
+				completeRead(read, readFile(fd, buffer, size, offset));
+			});
+			return;
+		}
+		catch(...) {
+		}
+	}
+
+	// the queue is full
+	completeRead(read, readFile(fd, buffer, size, offset));
+}
+
+void FileReadAhead::stop() noexcept {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopped = true;
+		condVar.wait(lock, [this] {
+			return pendingReads == 0;
+		});
+	}
+
+	ioUring.reset();
+	if(executor) {
+		executor->stop();
+	}
+}
+
+bool FileReadAhead::usesIoUring() const noexcept {
+	return ioUring != nullptr;
+}
+
+void FileReadAhead::completeRead(Read& read, ssize_t result) noexcept {
+	read.completed(result);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	--pendingReads;
+	condVar.notify_all();
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
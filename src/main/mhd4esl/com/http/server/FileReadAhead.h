@@ -0,0 +1,87 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_FILEREADAHEAD_H_
+#define MHD4ESL_COM_HTTP_SERVER_FILEREADAHEAD_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+class Executor;
+
+/* Reads files asynchronously, so a cold page cache does not block the threads of MHD. It uses io_uring
+ * if the kernel supports it and falls back to a thread pool otherwise. */
+class FileReadAhead {
+public:
+	/* A read that must be alive until completed() has been called. */
+	class Read {
+	public:
+		virtual ~Read() = default;
+
+		/* called with the number of bytes read or -errno by a thread of the read ahead */
+		virtual void completed(ssize_t result) noexcept = 0;
+
+	private:
+		friend class FileReadAhead;
+		struct iovec iov;
+	};
+
+	FileReadAhead(std::size_t numThreads);
+	~FileReadAhead();
+
+	void read(Read& read, int fd, void* buffer, std::size_t size, std::uint64_t offset) noexcept;
+
+	/* Reads submitted afterwards are done by the calling thread. Returns when all submitted reads are completed. */
+	void stop() noexcept;
+
+	bool usesIoUring() const noexcept;
+
+private:
+	class IoUring;
+
+	void completeRead(Read& read, ssize_t result) noexcept;
+
+	std::unique_ptr<IoUring> ioUring;
+	std::unique_ptr<Executor> executor;
+
+	std::mutex mutex;
+	std::condition_variable condVar;
+	std::size_t pendingReads = 0;
+	bool stopped = false;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_FILEREADAHEAD_H_ */
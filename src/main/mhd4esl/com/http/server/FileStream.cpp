@@ -0,0 +1,196 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/FileStream.h>
+#include <mhd4esl/com/http/server/Metrics.h>
+
+#include <esl/Logger.h>
+
+#include <microhttpd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include <unistd.h>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+esl::Logger logger("mhd4esl::com::http::server::FileStream");
+}
+
+const std::size_t FileStream::blockSize;
+
+FileStream::FileStream(FileReadAhead& aReadAhead, int aFd, std::uint64_t aFileSize, MHD_Connection& mhdConnection, StreamNotifierRegistry* streamNotifierRegistry)
+: readAhead(aReadAhead),
+  fd(aFd),
+  fileSize(aFileSize),
+  notifier(mhdConnection, streamNotifierRegistry)
+{
+	try {
+		current.data.reset(new char[blockSize]);
+		next.data.reset(new char[blockSize]);
+	}
+	catch(...) {
+		close(fd);
+		throw;
+	}
+
+	std::uint64_t offset;
+	std::size_t size;
+	bool submit;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		submit = prepareRead(offset, size);
+	}
+	if(submit) {
+		readAhead.read(*this, fd, next.data.get(), size, offset);
+	}
+}
+
+FileStream::~FileStream() {
+	close(fd);
+}
+
+void FileStream::completed(ssize_t result) noexcept {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		nextReading = false;
+		if(result <= 0) {
+			// a file that has become shorter is an error as well
+			logger.warn << "Reading file failed: " << (result < 0 ? std::strerror(static_cast<int>(-result)) : "unexpected end of file") << "\n";
+			failed = true;
+		}
+		else {
+			next.size = static_cast<std::size_t>(result);
+			next.pos = 0;
+			readOffset += next.size;
+			nextReady = true;
+		}
+	}
+
+	// does nothing if MHD has destroyed the response already
+	notifier.notify();
+
+	bool remove;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		--pendingReads;
+		remove = detached && pendingReads == 0;
+	}
+
+	if(remove) {
+		delete this;
+	}
+}
+
+ssize_t FileStream::contentReaderCallback(void* cls, uint64_t bytesTransmitted, char* buffer, size_t bufferSize) {
+	FileStream* fileStream = static_cast<FileStream*>(cls);
+	if(fileStream == nullptr) {
+		return MHD_CONTENT_READER_END_OF_STREAM;
+	}
+	return fileStream->read(buffer, bufferSize);
+}
+
+void FileStream::contentReaderFreeCallback(void* cls) {
+	FileStream* fileStream = static_cast<FileStream*>(cls);
+	if(fileStream == nullptr) {
+		return;
+	}
+
+	fileStream->notifier.detach();
+
+	bool remove;
+	{
+		std::lock_guard<std::mutex> lock(fileStream->mutex);
+		fileStream->detached = true;
+		remove = fileStream->pendingReads == 0;
+	}
+
+	if(remove) {
+		delete fileStream;
+	}
+}
+
+ssize_t FileStream::read(char* buffer, std::size_t bufferSize) noexcept {
+	std::uint64_t offset;
+	std::size_t size;
+	bool submit = false;
+	std::size_t rv = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(failed) {
+			return MHD_CONTENT_READER_END_WITH_ERROR;
+		}
+
+		if(current.pos == current.size) {
+			if(!nextReady) {
+				if(!nextReading) {
+					return MHD_CONTENT_READER_END_OF_STREAM;
+				}
+			}
+			else {
+				std::swap(current, next);
+				nextReady = false;
+				submit = prepareRead(offset, size);
+			}
+		}
+
+		rv = std::min(bufferSize, current.size - current.pos);
+		std::memcpy(buffer, current.data.get() + current.pos, rv);
+		current.pos += rv;
+	}
+
+	if(submit) {
+		readAhead.read(*this, fd, next.data.get(), size, offset);
+	}
+
+	if(rv == 0) {
+		Metrics::get().fileReadAheadWaits.fetch_add(1, std::memory_order_relaxed);
+		// MHD calls the content reader again after the read has been completed
+		notifier.wait();
+	}
+
+	return static_cast<ssize_t>(rv);
+}
+
+bool FileStream::prepareRead(std::uint64_t& offset, std::size_t& size) noexcept {
+	if(readOffset >= fileSize) {
+		return false;
+	}
+
+	offset = readOffset;
+	size = static_cast<std::size_t>(std::min<std::uint64_t>(blockSize, fileSize - readOffset));
+	nextReading = true;
+	++pendingReads;
+	return true;
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
@@ -0,0 +1,94 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_FILESTREAM_H_
+#define MHD4ESL_COM_HTTP_SERVER_FILESTREAM_H_
+
+#include <mhd4esl/com/http/server/FileReadAhead.h>
+#include <mhd4esl/com/http/server/StreamNotifier.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <sys/types.h>
+
+struct MHD_Connection;
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Body of a file response whose next block is read by FileReadAhead while the current block is sent.
+ * If the content reader has to wait for a read, the connection is suspended until the read is completed. */
+class FileStream : public FileReadAhead::Read {
+public:
+	static const std::size_t blockSize = 64 * 1024;
+
+	/* takes the ownership of fd and starts reading the first block */
+	FileStream(FileReadAhead& readAhead, int fd, std::uint64_t fileSize, MHD_Connection& mhdConnection, StreamNotifierRegistry* streamNotifierRegistry);
+
+	void completed(ssize_t result) noexcept override;
+
+	static ssize_t contentReaderCallback(void* cls, uint64_t bytesTransmitted, char* buffer, size_t bufferSize);
+	/* the stream is deleted when its read in progress is completed */
+	static void contentReaderFreeCallback(void* cls);
+
+private:
+	struct Block {
+		std::unique_ptr<char[]> data;
+		std::size_t size = 0;
+		std::size_t pos = 0;
+	};
+
+	~FileStream();
+
+	ssize_t read(char* buffer, std::size_t bufferSize) noexcept;
+
+	/* requires a lock of mutex. Returns false if the file has been read completely. */
+	bool prepareRead(std::uint64_t& offset, std::size_t& size) noexcept;
+
+	FileReadAhead& readAhead;
+	const int fd;
+	const std::uint64_t fileSize;
+	StreamNotifier notifier;
+
+	std::mutex mutex;
+	Block current;
+	/* block that is read or ready to be sent next */
+	Block next;
+	bool nextReading = false;
+	bool nextReady = false;
+	/* reads whose completion has not returned yet, the stream must not be deleted before */
+	std::size_t pendingReads = 0;
+	/* file offset of the block after next */
+	std::uint64_t readOffset = 0;
+	bool failed = false;
+	bool detached = false;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_FILESTREAM_H_ */
@@ -0,0 +1,52 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/Headers.h>
+
+#include <cctype>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+bool Headers::equals(const std::string& name, const char* key) noexcept {
+	std::size_t i = 0;
+	for(; i < name.size() && key[i] != 0; ++i) {
+		if(std::tolower(static_cast<unsigned char>(name[i])) != std::tolower(static_cast<unsigned char>(key[i]))) {
+			return false;
+		}
+	}
+	return i == name.size() && key[i] == 0;
+}
+
+const std::string* Headers::find(const esl::com::http::server::Response& response, const char* key) noexcept {
+	for(const auto& header : response.getHeaders()) {
+		if(equals(header.first, key)) {
+			return &header.second;
+		}
+	}
+	return nullptr;
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
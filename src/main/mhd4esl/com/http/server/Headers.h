@@ -0,0 +1,50 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_HEADERS_H_
+#define MHD4ESL_COM_HTTP_SERVER_HEADERS_H_
+
+#include <esl/com/http/server/Response.h>
+
+#include <string>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Helpers for header fields of responses. Field names are case insensitive. */
+class Headers {
+public:
+	Headers() = delete;
+
+	/* true if the field name equals key, ignoring case */
+	static bool equals(const std::string& name, const char* key) noexcept;
+
+	/* returns the value of the first header field key of the response or nullptr */
+	static const std::string* find(const esl::com::http::server::Response& response, const char* key) noexcept;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_HEADERS_H_ */
@@ -0,0 +1,96 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_METRICS_H_
+#define MHD4ESL_COM_HTTP_SERVER_METRICS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Process wide counters. They are updated with relaxed atomics only, so they
+ * can be used on every hot path instead of log messages. */
+class Metrics {
+public:
+	static Metrics& get() noexcept;
+
+	std::atomic<std::uint64_t> tlsCertificateRequests{0};
+	std::atomic<std::uint64_t> tlsCertificateNotFound{0};
+	std::atomic<std::uint64_t> tlsCertificateReloads{0};
+	std::atomic<std::uint64_t> tlsCertificateReloadFailures{0};
+	/* handshakes with an OCSP response to staple */
+	std::atomic<std::uint64_t> tlsOcspStapled{0};
+	std::atomic<std::uint64_t> tlsOcspRefreshes{0};
+	std::atomic<std::uint64_t> tlsOcspRefreshFailures{0};
+	/* client certificates verified against the trusted CAs or found in the cache of verified certificates */
+	std::atomic<std::uint64_t> tlsClientVerifications{0};
+	std::atomic<std::uint64_t> tlsClientCacheHits{0};
+	/* requests rejected because the client has not sent a valid certificate */
+	std::atomic<std::uint64_t> tlsClientRejected{0};
+
+	std::atomic<std::uint64_t> responseCacheHits{0};
+	std::atomic<std::uint64_t> responseCacheMisses{0};
+	std::atomic<std::uint64_t> responseCacheCoalesced{0};
+	/* responses replaced by status 304, because their generated or given ETag matched "If-None-Match" */
+	std::atomic<std::uint64_t> responsesNotModified{0};
+
+	/* exception::StatusCode thrown by request handlers, indexed by status code */
+	static const std::size_t maxStatusCode = 600;
+	std::atomic<std::uint64_t> statusCodeExceptions[maxStatusCode] = {};
+	/* exceptions answered with a pre-built response */
+	std::atomic<std::uint64_t> statusCodeResponsesShared{0};
+
+	/* streamed bodies of esl::io::Output */
+	std::atomic<std::uint64_t> streamsCompleted{0};
+	std::atomic<std::uint64_t> streamsFailed{0};
+	/* connections suspended because the reader of a notifiable stream had no data */
+	std::atomic<std::uint64_t> streamSuspends{0};
+	/* calls of the content reader of a file response that had to wait for the read ahead */
+	std::atomic<std::uint64_t> fileReadAheadWaits{0};
+
+	/* requests answered before their body has been read or while it was read */
+	std::atomic<std::uint64_t> requestsRejectedBodySize{0};
+	std::atomic<std::uint64_t> requestsRejectedHeaders{0};
+	std::atomic<std::uint64_t> requestsRejectedExpectation{0};
+
+	/* connections rejected by the runtime limits of a socket */
+	std::atomic<std::uint64_t> connectionsRejectedLimit{0};
+	std::atomic<std::uint64_t> connectionsRejectedPerIpLimit{0};
+
+	/* traces written by the trace file exporter, dropped because its queue was full or lost by write errors */
+	std::atomic<std::uint64_t> tracesExported{0};
+	std::atomic<std::uint64_t> tracesDropped{0};
+	std::atomic<std::uint64_t> tracesFailed{0};
+
+private:
+	Metrics() = default;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_METRICS_H_ */
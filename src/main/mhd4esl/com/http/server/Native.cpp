@@ -0,0 +1,62 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/Native.h>
+#include <mhd4esl/com/http/server/Connection.h>
+#include <mhd4esl/com/http/server/Request.h>
+#include <mhd4esl/com/http/server/RequestContext.h>
+
+#include <esl/system/Stacktrace.h>
+
+#include <stdexcept>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+Connection& getNative(esl::com::http::server::Connection& connection) {
+	Connection* nativeConnection = dynamic_cast<Connection*>(&connection);
+	if(nativeConnection == nullptr) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Connection is not a connection of MHDSocket"));
+	}
+	return *nativeConnection;
+}
+
+const Request& getNative(const esl::com::http::server::Request& request) {
+	const Request* nativeRequest = dynamic_cast<const Request*>(&request);
+	if(nativeRequest == nullptr) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Request is not a request of MHDSocket"));
+	}
+	return *nativeRequest;
+}
+
+RequestContext& getNative(esl::com::http::server::RequestContext& requestContext) {
+	RequestContext* nativeRequestContext = dynamic_cast<RequestContext*>(&requestContext);
+	if(nativeRequestContext == nullptr) {
+		throw esl::system::Stacktrace::add(std::runtime_error("RequestContext is not a request context of MHDSocket"));
+	}
+	return *nativeRequestContext;
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
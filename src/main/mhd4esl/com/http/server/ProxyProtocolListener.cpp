@@ -0,0 +1,426 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/ProxyProtocolListener.h>
+#include <mhd4esl/com/http/server/Request.h>
+#include <mhd4esl/Logging.h>
+
+#include <esl/Logger.h>
+#include <esl/system/Stacktrace.h>
+#include <esl/utility/String.h>
+
+#include <microhttpd.h>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+esl::Logger logger("mhd4esl::com::http::server::ProxyProtocolListener");
+
+const unsigned char v2Signature[12] = { 0x0D, 0x0A, 0x0D, 0x0A, 0x00, 0x0D, 0x0A, 0x51, 0x55, 0x49, 0x54, 0x0A };
+const std::size_t v1MaxSize = 107;
+const std::size_t v2MaxSize = 16 + 2048;
+/* the shortest header of version 1 is "PROXY UNKNOWN\r\n", so this part can be read without looking at it */
+const std::size_t minSize = 8;
+}
+
+ProxyProtocolListener::ProxyProtocolListener(std::uint16_t aPort, const TrustedProxies* aTrustedProxies, unsigned int aHeaderTimeoutSeconds)
+: port(aPort),
+  trustedProxies(aTrustedProxies),
+  headerTimeoutSeconds(aHeaderTimeoutSeconds)
+{ }
+
+ProxyProtocolListener::~ProxyProtocolListener() {
+	stop();
+}
+
+#ifdef _WIN32
+
+void ProxyProtocolListener::start(MHD_Daemon&) {
+	throw esl::system::Stacktrace::add(std::runtime_error("PROXY protocol is not supported on this platform"));
+}
+
+void ProxyProtocolListener::stop() noexcept {
+}
+
+ProxyProtocolListener::Result ProxyProtocolListener::parse(const unsigned char*, std::size_t, std::size_t&, sockaddr_storage&, socklen_t&) noexcept {
+	return Result::invalid;
+}
+
+void ProxyProtocolListener::run() noexcept {
+}
+
+void ProxyProtocolListener::acceptConnections() noexcept {
+}
+
+bool ProxyProtocolListener::readHeader(Pending&) noexcept {
+	return true;
+}
+
+#else
+
+void ProxyProtocolListener::start(MHD_Daemon& aDaemon) {
+	daemon = &aDaemon;
+
+	listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if(listenSocket < 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot create socket for PROXY protocol listener"));
+	}
+
+	int reuse = 1;
+	setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+
+	if(bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+			|| ::listen(listenSocket, SOMAXCONN) != 0
+			|| fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL, 0) | O_NONBLOCK) != 0
+			|| pipe(wakeupPipe) != 0) {
+		stop();
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot listen on port " + std::to_string(port) + " for PROXY protocol"));
+	}
+
+	thread = std::thread(&ProxyProtocolListener::run, this);
+}
+
+void ProxyProtocolListener::stop() noexcept {
+	if(thread.joinable()) {
+		char c = 0;
+		if(write(wakeupPipe[1], &c, 1) != 1) {
+			MHD4ESL_LOG(logger, warn) << "Cannot wake up PROXY protocol listener\n";
+		}
+		thread.join();
+	}
+
+	for(int& fd : { std::ref(listenSocket), std::ref(wakeupPipe[0]), std::ref(wakeupPipe[1]) }) {
+		if(fd >= 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+}
+
+ProxyProtocolListener::Result ProxyProtocolListener::parse(const unsigned char* data, std::size_t size, std::size_t& headerSize, sockaddr_storage& clientAddress, socklen_t& clientAddressSize) noexcept {
+	clientAddressSize = 0;
+	std::memset(&clientAddress, 0, sizeof(clientAddress));
+
+	if(size == 0) {
+		return Result::incomplete;
+	}
+
+	if(data[0] == v2Signature[0]) {
+		if(std::memcmp(data, v2Signature, std::min(size, sizeof(v2Signature))) != 0) {
+			return Result::invalid;
+		}
+		if(size < 16) {
+			return Result::incomplete;
+		}
+		if((data[12] & 0xF0) != 0x20) {
+			return Result::invalid;
+		}
+
+		const std::size_t length = (static_cast<std::size_t>(data[14]) << 8) | data[15];
+		headerSize = 16 + length;
+		if(size < headerSize) {
+			return Result::incomplete;
+		}
+
+		switch(data[12] & 0x0F) {
+		case 0x00:
+			// LOCAL command, e.g. health checks of the proxy itself
+			return Result::complete;
+		case 0x01:
+			break;
+		default:
+			return Result::invalid;
+		}
+
+		if(data[13] == 0x11 && length >= 12) {
+			sockaddr_in& address = reinterpret_cast<sockaddr_in&>(clientAddress);
+			address.sin_family = AF_INET;
+			std::memcpy(&address.sin_addr, data + 16, 4);
+			std::memcpy(&address.sin_port, data + 24, 2);
+			clientAddressSize = sizeof(sockaddr_in);
+		}
+		else if(data[13] == 0x21 && length >= 36) {
+			sockaddr_in6& address = reinterpret_cast<sockaddr_in6&>(clientAddress);
+			address.sin6_family = AF_INET6;
+			std::memcpy(&address.sin6_addr, data + 16, 16);
+			std::memcpy(&address.sin6_port, data + 48, 2);
+			clientAddressSize = sizeof(sockaddr_in6);
+		}
+
+		return Result::complete;
+	}
+
+	static const char v1Signature[] = "PROXY ";
+	if(std::memcmp(data, v1Signature, std::min(size, sizeof(v1Signature) - 1)) != 0) {
+		return Result::invalid;
+	}
+
+	const char* line = reinterpret_cast<const char*>(data);
+	const std::size_t searchSize = std::min(size, v1MaxSize);
+	std::size_t lineSize = 0;
+	while(lineSize + 1 < searchSize && !(line[lineSize] == '\r' && line[lineSize + 1] == '\n')) {
+		++lineSize;
+	}
+	if(lineSize + 1 >= searchSize) {
+		return size >= v1MaxSize ? Result::invalid : Result::incomplete;
+	}
+	headerSize = lineSize + 2;
+
+	// PROXY <protocol> <source address> <destination address> <source port> <destination port>
+	std::vector<std::string> tokens = esl::utility::String::split(std::string(line, lineSize), ' ');
+
+	if(tokens.size() >= 2 && tokens[1] == "UNKNOWN") {
+		return Result::complete;
+	}
+	if(tokens.size() != 6) {
+		return Result::invalid;
+	}
+
+	char* end = nullptr;
+	unsigned long sourcePort = std::strtoul(tokens[4].c_str(), &end, 10);
+	if(end == tokens[4].c_str() || *end != 0 || sourcePort > 0xFFFF) {
+		return Result::invalid;
+	}
+
+	if(tokens[1] == "TCP4") {
+		sockaddr_in& address = reinterpret_cast<sockaddr_in&>(clientAddress);
+		if(inet_pton(AF_INET, tokens[2].c_str(), &address.sin_addr) != 1) {
+			return Result::invalid;
+		}
+		address.sin_family = AF_INET;
+		address.sin_port = htons(static_cast<std::uint16_t>(sourcePort));
+		clientAddressSize = sizeof(sockaddr_in);
+	}
+	else if(tokens[1] == "TCP6") {
+		sockaddr_in6& address = reinterpret_cast<sockaddr_in6&>(clientAddress);
+		if(inet_pton(AF_INET6, tokens[2].c_str(), &address.sin6_addr) != 1) {
+			return Result::invalid;
+		}
+		address.sin6_family = AF_INET6;
+		address.sin6_port = htons(static_cast<std::uint16_t>(sourcePort));
+		clientAddressSize = sizeof(sockaddr_in6);
+	}
+	else {
+		return Result::invalid;
+	}
+
+	return Result::complete;
+}
+
+void ProxyProtocolListener::run() noexcept {
+	std::vector<pollfd> pollFds;
+
+	while(true) {
+		pollFds.clear();
+		pollFds.push_back(pollfd{ wakeupPipe[0], POLLIN, 0 });
+		pollFds.push_back(pollfd{ listenSocket, POLLIN, 0 });
+
+		auto now = std::chrono::steady_clock::now();
+		int timeoutMs = -1;
+		for(const auto& pending : pendings) {
+			pollFds.push_back(pollfd{ pending.socket, POLLIN, 0 });
+
+			long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(pending.deadline - now).count();
+			ms = std::max(0LL, ms);
+			if(timeoutMs < 0 || ms < timeoutMs) {
+				timeoutMs = static_cast<int>(ms);
+			}
+		}
+
+		if(poll(pollFds.data(), pollFds.size(), timeoutMs) < 0 && errno != EINTR) {
+			logger.error << "poll failed for PROXY protocol listener: " << std::strerror(errno) << "\n";
+			break;
+		}
+		if(pollFds[0].revents != 0) {
+			break;
+		}
+
+		// check connections that have been pending before accepting new connections
+		now = std::chrono::steady_clock::now();
+		std::vector<Pending> stillPending;
+		for(std::size_t i = 0; i < pendings.size(); ++i) {
+			if(pollFds[i + 2].revents != 0) {
+				if(!readHeader(pendings[i])) {
+					stillPending.push_back(std::move(pendings[i]));
+				}
+			}
+			else if(now >= pendings[i].deadline) {
+				MHD4ESL_LOG(logger, debug) << "Timeout while waiting for PROXY protocol header\n";
+				close(pendings[i].socket);
+			}
+			else {
+				stillPending.push_back(std::move(pendings[i]));
+			}
+		}
+		pendings.swap(stillPending);
+
+		if(pollFds[1].revents != 0) {
+			acceptConnections();
+		}
+	}
+
+	for(auto& pending : pendings) {
+		close(pending.socket);
+	}
+	pendings.clear();
+}
+
+void ProxyProtocolListener::acceptConnections() noexcept {
+	while(true) {
+		Pending pending;
+		pending.peerAddressSize = sizeof(pending.peerAddress);
+
+		pending.socket = ::accept(listenSocket, reinterpret_cast<sockaddr*>(&pending.peerAddress), &pending.peerAddressSize);
+		if(pending.socket < 0) {
+			return;
+		}
+
+		if(trustedProxies && !trustedProxies->isTrusted(Request::toAddress(reinterpret_cast<sockaddr*>(&pending.peerAddress)))) {
+			MHD4ESL_LOG(logger, debug) << "Reject connection of untrusted proxy\n";
+			close(pending.socket);
+			continue;
+		}
+
+		if(fcntl(pending.socket, F_SETFL, fcntl(pending.socket, F_GETFL, 0) | O_NONBLOCK) != 0) {
+			close(pending.socket);
+			continue;
+		}
+
+		pending.deadline = std::chrono::steady_clock::now() + std::chrono::seconds(headerTimeoutSeconds);
+		if(!readHeader(pending)) {
+			try {
+				pendings.push_back(pending);
+			}
+			catch(...) {
+				close(pending.socket);
+			}
+		}
+	}
+}
+
+bool ProxyProtocolListener::readHeader(Pending& pending) noexcept {
+	unsigned char buffer[v2MaxSize];
+	std::size_t headerSize = 0;
+	sockaddr_storage clientAddress;
+	socklen_t clientAddressSize = 0;
+
+	while(true) {
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(pending.header.data());
+		Result result = parse(data, pending.header.size(), headerSize, clientAddress, clientAddressSize);
+		if(result == Result::complete) {
+			break;
+		}
+
+		// determine how many bytes belong to the header for sure, nothing is read if the header is invalid
+		std::size_t readSize = 0;
+		if(result == Result::incomplete) {
+			if(pending.header.size() < minSize) {
+				readSize = minSize - pending.header.size();
+			}
+			else if(data[0] == v2Signature[0]) {
+				if(pending.header.size() < 16) {
+					readSize = 16 - pending.header.size();
+				}
+				else if(headerSize <= v2MaxSize) {
+					readSize = headerSize - pending.header.size();
+				}
+			}
+			else {
+				// version 1 has no length, so it ends with the first line feed of the data that is available
+				ssize_t size = recv(pending.socket, buffer, v1MaxSize - pending.header.size(), MSG_PEEK);
+				if(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+					return false;
+				}
+				if(size <= 0) {
+					close(pending.socket);
+					return true;
+				}
+
+				const void* lineFeed = std::memchr(buffer, '\n', static_cast<std::size_t>(size));
+				readSize = lineFeed ? static_cast<std::size_t>(static_cast<const unsigned char*>(lineFeed) - buffer) + 1 : static_cast<std::size_t>(size);
+			}
+		}
+
+		if(readSize == 0) {
+			MHD4ESL_LOG(logger, debug) << "Invalid PROXY protocol header\n";
+			close(pending.socket);
+			return true;
+		}
+
+		ssize_t size = recv(pending.socket, buffer, readSize, 0);
+		if(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			return false;
+		}
+		if(size <= 0) {
+			close(pending.socket);
+			return true;
+		}
+
+		try {
+			pending.header.append(reinterpret_cast<const char*>(buffer), static_cast<std::size_t>(size));
+		}
+		catch(...) {
+			close(pending.socket);
+			return true;
+		}
+	}
+
+	const sockaddr* address = clientAddressSize > 0 ? reinterpret_cast<const sockaddr*>(&clientAddress) : reinterpret_cast<const sockaddr*>(&pending.peerAddress);
+	socklen_t addressSize = clientAddressSize > 0 ? clientAddressSize : pending.peerAddressSize;
+
+	// MHD closes the socket if it cannot add the connection
+	if(MHD_add_connection(daemon, pending.socket, address, addressSize) != MHD_YES) {
+		MHD4ESL_LOG(logger, warn) << "MHD rejected connection\n";
+	}
+
+	return true;
+}
+
+#endif
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
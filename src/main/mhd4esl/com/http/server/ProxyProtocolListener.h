@@ -0,0 +1,98 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_PROXYPROTOCOLLISTENER_H_
+#define MHD4ESL_COM_HTTP_SERVER_PROXYPROTOCOLLISTENER_H_
+
+#include <mhd4esl/com/http/server/TrustedProxies.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
+
+struct MHD_Daemon;
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Accepts TCP connections in front of MHD, reads the PROXY protocol header (version 1 or 2)
+ * and hands the connection over to MHD with the client address from this header.
+ * So MHD's per-IP connection limit and Request::getRemoteAddress refer to the real client. */
+class ProxyProtocolListener {
+public:
+	/* if trustedProxies is not nullptr, headers are accepted only from these peers */
+	ProxyProtocolListener(std::uint16_t port, const TrustedProxies* trustedProxies, unsigned int headerTimeoutSeconds);
+	~ProxyProtocolListener();
+
+	void start(MHD_Daemon& daemon);
+	void stop() noexcept;
+
+	enum class Result {
+		complete,
+		incomplete,
+		invalid
+	};
+
+	/* Parses a header from the given data. On success headerSize bytes belong to the header
+	 * and clientAddress contains the address of the client, if the header provides one. */
+	static Result parse(const unsigned char* data, std::size_t size, std::size_t& headerSize, sockaddr_storage& clientAddress, socklen_t& clientAddressSize) noexcept;
+
+private:
+	struct Pending {
+		int socket;
+		sockaddr_storage peerAddress;
+		socklen_t peerAddressSize;
+		std::chrono::steady_clock::time_point deadline;
+		/* bytes of the header that have been read so far */
+		std::string header;
+	};
+
+	void run() noexcept;
+	void acceptConnections() noexcept;
+	/* Reads the header without reading any byte behind it, so the request stays in the socket for MHD.
+	 * Returns true if the connection is not pending anymore. */
+	bool readHeader(Pending& pending) noexcept;
+
+	const std::uint16_t port;
+	const TrustedProxies* trustedProxies;
+	const unsigned int headerTimeoutSeconds;
+
+	MHD_Daemon* daemon = nullptr;
+	int listenSocket = -1;
+	int wakeupPipe[2] = { -1, -1 };
+	std::vector<Pending> pendings;
+	std::thread thread;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_PROXYPROTOCOLLISTENER_H_ */
@@ -17,6 +17,9 @@
  */
 
 #include <mhd4esl/com/http/server/Request.h>
+#include <mhd4esl/com/http/server/ClientCertificateCache.h>
+#include <mhd4esl/com/http/server/ConnectionContext.h>
+#include <mhd4esl/com/http/server/TrustedProxies.h>
 
 #include <esl/utility/String.h>
 
@@ -32,8 +35,11 @@
 #include <arpa/inet.h>
 #endif
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
+#include <random>
 
 namespace mhd4esl {
 inline namespace v1_6 {
@@ -41,42 +47,80 @@ namespace com {
 namespace http {
 namespace server {
 
+namespace {
+const char hexDigits[] = "0123456789abcdef";
+
+/* lowercase hex only. isZero is set to true if all digits are zero, that is an invalid ID. */
+bool parseHex(const char* str, std::size_t size, std::string* result, bool& isZero) noexcept {
+	isZero = true;
+	for(std::size_t i = 0; i < size; ++i) {
+		if(!((str[i] >= '0' && str[i] <= '9') || (str[i] >= 'a' && str[i] <= 'f'))) {
+			return false;
+		}
+		if(str[i] != '0') {
+			isZero = false;
+		}
+	}
+	if(result) {
+		result->assign(str, size);
+	}
+	return true;
+}
+}
+
 Request::Request(MHD_Connection& aMhdConnection, const char* aHttpVersion, const char* aMethod, const char* aUrl, bool aIsHttps, uint16_t aHostPort)
 : mhdConnection(aMhdConnection),
   isHttps(aIsHttps),
   httpVersion(aHttpVersion),
   hostPort(aHostPort),
+  methodName(aMethod),
   method(aMethod),
   url(aUrl)
 {
 	MHD_get_connection_values(&mhdConnection, MHD_HEADER_KIND, readHeaders, this);
 
+	std::memset(&remoteSockAddr, 0, sizeof(remoteSockAddr));
 #ifndef _WIN32
 	const MHD_ConnectionInfo* connectionInfo = MHD_get_connection_info(&mhdConnection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
 
-	if(connectionInfo != nullptr) {
-		char strBuffer[INET6_ADDRSTRLEN];
-
+	if(connectionInfo != nullptr && connectionInfo->client_addr != nullptr) {
 		switch(connectionInfo->client_addr->sa_family) {
 		case AF_INET:
-			if(inet_ntop(connectionInfo->client_addr->sa_family,
-					&reinterpret_cast<sockaddr_in const*>(connectionInfo->client_addr)->sin_addr,
-					strBuffer, INET6_ADDRSTRLEN) != nullptr) {
-				remoteAddress = std::string(strBuffer);
-			}
+			std::memcpy(&remoteSockAddr, connectionInfo->client_addr, sizeof(sockaddr_in));
 			break;
 		case AF_INET6:
-			if(inet_ntop(connectionInfo->client_addr->sa_family,
-					&reinterpret_cast<sockaddr_in6 const*>(connectionInfo->client_addr)->sin6_addr,
-					strBuffer, INET6_ADDRSTRLEN) != nullptr) {
-				remoteAddress = std::string(strBuffer);
-			}
+			std::memcpy(&remoteSockAddr, connectionInfo->client_addr, sizeof(sockaddr_in6));
 			break;
 		}
-
-		remotePort = static_cast<uint16_t>(reinterpret_cast<sockaddr_in const*>(connectionInfo->client_addr)->sin_port);
 	}
 #endif
+
+	const MHD_ConnectionInfo* socketContextInfo = MHD_get_connection_info(&mhdConnection, MHD_CONNECTION_INFO_SOCKET_CONTEXT);
+	if(socketContextInfo != nullptr && socketContextInfo->socket_context != nullptr) {
+		ConnectionContext& connectionContext = *static_cast<ConnectionContext*>(socketContextInfo->socket_context);
+		if(connectionContext.trustedProxies) {
+			resolveForwardedAddress(connectionContext);
+		}
+
+		// the handshake is completed when the first request has been received
+		if(connectionContext.clientCertificateCache && !connectionContext.clientCertificateVerified) {
+			connectionContext.clientCertificateVerified = true;
+			const MHD_ConnectionInfo* sessionInfo = MHD_get_connection_info(&mhdConnection, MHD_CONNECTION_INFO_GNUTLS_SESSION);
+			if(sessionInfo && sessionInfo->tls_session) {
+				connectionContext.clientCertificate = connectionContext.clientCertificateCache->verify(static_cast<gnutls_session_t>(sessionInfo->tls_session));
+			}
+		}
+		clientCertificate = connectionContext.clientCertificate;
+	}
+
+	const char* traceParentHeader = findHeader("traceparent");
+	if(traceParentHeader) {
+		hasTraceParent = parseTraceParent(traceParentHeader, traceParent);
+	}
+}
+
+const std::shared_ptr<const ClientCertificate>& Request::getClientCertificate() const noexcept {
+	return clientCertificate;
 }
 
 bool Request::isHTTPS() const noexcept {
@@ -107,6 +151,90 @@ const esl::utility::HttpMethod& Request::getMethod() const noexcept {
 	return method;
 }
 
+const std::string& Request::getMethodName() const noexcept {
+	return methodName;
+}
+
+const char* Request::findHeader(const char* key) const noexcept {
+	return MHD_lookup_connection_value(&mhdConnection, MHD_HEADER_KIND, key);
+}
+
+const Request::TraceParent* Request::getTraceParent() const noexcept {
+	return hasTraceParent ? &traceParent : nullptr;
+}
+
+bool Request::parseTraceParent(const char* value, TraceParent& traceParent) {
+	// version "-" trace-id "-" parent-id "-" trace-flags, e.g. "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"
+	const std::size_t size = std::strlen(value);
+	bool isZero;
+
+	if(size < 55 || !parseHex(value, 2, nullptr, isZero) || std::strncmp(value, "ff", 2) == 0
+			|| value[2] != '-' || value[35] != '-' || value[52] != '-') {
+		return false;
+	}
+
+	// later versions might append fields
+	if(size > 55 && (std::strncmp(value, "00", 2) == 0 || value[55] != '-')) {
+		return false;
+	}
+
+	std::string flags;
+	if(!parseHex(value + 3, 32, &traceParent.traceId, isZero) || isZero
+			|| !parseHex(value + 36, 16, &traceParent.parentSpanId, isZero) || isZero
+			|| !parseHex(value + 53, 2, &flags, isZero)) {
+		return false;
+	}
+	traceParent.traceFlags = static_cast<std::uint8_t>(std::strtoul(flags.c_str(), nullptr, 16));
+
+	return true;
+}
+
+std::string Request::createTraceId(std::size_t bytes) {
+	static thread_local std::mt19937_64 generator(std::random_device{}());
+
+	std::string rv;
+	rv.reserve(bytes * 2);
+	while(rv.size() < bytes * 2) {
+		std::uint64_t random = generator();
+		for(int i = 0; i < 16 && rv.size() < bytes * 2; ++i, random >>= 4) {
+			rv += hexDigits[random & 0x0f];
+		}
+	}
+	return rv;
+}
+
+bool Request::getContentLength(std::uint64_t& contentLength) const noexcept {
+	const char* value = findHeader(MHD_HTTP_HEADER_CONTENT_LENGTH);
+	if(value == nullptr || *value < '0' || *value > '9') {
+		return false;
+	}
+
+	char* end = nullptr;
+	errno = 0;
+	unsigned long long rv = std::strtoull(value, &end, 10);
+	if(errno != 0 || *end != 0) {
+		return false;
+	}
+	contentLength = static_cast<std::uint64_t>(rv);
+	return true;
+}
+
+std::string Request::getNormalizedArguments() const {
+	std::vector<std::pair<std::string, std::string>> allArguments;
+	MHD_get_connection_values(&mhdConnection, MHD_GET_ARGUMENT_KIND, readArguments, &allArguments);
+	std::sort(allArguments.begin(), allArguments.end());
+
+	std::string rv;
+	for(const auto& argument : allArguments) {
+		// unit separator cannot be part of an unescaped argument of a valid URL
+		rv += argument.first;
+		rv += '\x1f';
+		rv += argument.second;
+		rv += '\x1e';
+	}
+	return rv;
+}
+
 const std::map<std::string, std::string>& Request::getHeaders() const noexcept {
 	return headers;
 }
@@ -135,11 +263,121 @@ const std::string& Request::getArgument(const std::string& key) const {
 }
 
 const std::string& Request::getRemoteAddress() const noexcept {
+	if(remoteAddressFormatted) {
+		return remoteAddress;
+	}
+	remoteAddressFormatted = true;
+
+	try {
+		remoteAddress = toString(getRemoteAddressBinary());
+	}
+	catch(...) {
+	}
+
 	return remoteAddress;
 }
 
 uint16_t Request::getRemotePort() const noexcept {
-	return remotePort;
+	// port of a forwarded client is unknown
+	if(hasForwardedAddress) {
+		return 0;
+	}
+
+	return toPort(reinterpret_cast<const sockaddr*>(&remoteSockAddr));
+}
+
+esl::com::http::server::MHDRequest::Address Request::getRemoteAddressBinary() const noexcept {
+	if(hasForwardedAddress) {
+		return forwardedAddress;
+	}
+	return toAddress(reinterpret_cast<const sockaddr*>(&remoteSockAddr));
+}
+
+std::string Request::toString(const esl::com::http::server::MHDRequest::Address& address) {
+#ifndef _WIN32
+	char strBuffer[INET6_ADDRSTRLEN];
+
+	switch(address.family) {
+	case esl::com::http::server::MHDRequest::Address::Family::ipv4:
+		if(inet_ntop(AF_INET, address.bytes, strBuffer, INET6_ADDRSTRLEN) != nullptr) {
+			return std::string(strBuffer);
+		}
+		break;
+	case esl::com::http::server::MHDRequest::Address::Family::ipv6:
+		if(inet_ntop(AF_INET6, address.bytes, strBuffer, INET6_ADDRSTRLEN) != nullptr) {
+			return std::string(strBuffer);
+		}
+		break;
+	default:
+		break;
+	}
+#endif
+
+	return "";
+}
+
+uint16_t Request::toPort(const sockaddr* sockAddr) noexcept {
+	switch(sockAddr->sa_family) {
+	case AF_INET:
+		return ntohs(reinterpret_cast<const sockaddr_in*>(sockAddr)->sin_port);
+	case AF_INET6:
+		return ntohs(reinterpret_cast<const sockaddr_in6*>(sockAddr)->sin6_port);
+	default:
+		break;
+	}
+	return 0;
+}
+
+esl::com::http::server::MHDRequest::Address Request::toAddress(const sockaddr* sockAddr) noexcept {
+	esl::com::http::server::MHDRequest::Address address;
+
+	switch(sockAddr->sa_family) {
+	case AF_INET:
+		address.family = esl::com::http::server::MHDRequest::Address::Family::ipv4;
+		std::memcpy(address.bytes, &reinterpret_cast<const sockaddr_in*>(sockAddr)->sin_addr, 4);
+		break;
+	case AF_INET6:
+		TrustedProxies::setIPv6Address(reinterpret_cast<const unsigned char*>(&reinterpret_cast<const sockaddr_in6*>(sockAddr)->sin6_addr), address);
+		break;
+	default:
+		break;
+	}
+
+	return address;
+}
+
+void Request::resolveForwardedAddress(ConnectionContext& connectionContext) {
+	const char* forwarded = MHD_lookup_connection_value(&mhdConnection, MHD_HEADER_KIND, "Forwarded");
+	const char* forwardedFor = forwarded ? nullptr : MHD_lookup_connection_value(&mhdConnection, MHD_HEADER_KIND, "X-Forwarded-For");
+	const char* header = forwarded ? forwarded : forwardedFor;
+
+	if(header == nullptr) {
+		return;
+	}
+
+	// proxies usually forward all requests of one client on the same connection, so the result is reused
+	if(!connectionContext.hasForwardedAddress
+			|| connectionContext.isForwardedRfc7239 != (forwarded != nullptr)
+			|| connectionContext.forwardedHeader != header) {
+		esl::com::http::server::MHDRequest::Address address;
+		if(!connectionContext.trustedProxies->resolve(forwarded, forwardedFor, address)) {
+			return;
+		}
+
+		connectionContext.hasForwardedAddress = true;
+		connectionContext.isForwardedRfc7239 = (forwarded != nullptr);
+		connectionContext.forwardedHeader = header;
+		connectionContext.forwardedAddress = address;
+	}
+
+	hasForwardedAddress = true;
+	forwardedAddress = connectionContext.forwardedAddress;
+}
+
+MHD_Result Request::readArguments(void* argumentsPtr, MHD_ValueKind, const char* key, const char* value) {
+	std::vector<std::pair<std::string, std::string>>& arguments = *static_cast<std::vector<std::pair<std::string, std::string>>*>(argumentsPtr);
+	arguments.emplace_back(key ? key : "", value ? value : "");
+	return MHD_YES;
 }
 
 MHD_Result Request::readHeaders(void* requestPtr, MHD_ValueKind, const char* key, const char* valuePtr) {
@@ -19,17 +19,26 @@
 #ifndef MHD4ESL_COM_HTTP_SERVER_REQUEST_H_
 #define MHD4ESL_COM_HTTP_SERVER_REQUEST_H_
 
+#include <esl/com/http/server/MHDRequest.h>
 #include <esl/com/http/server/Request.h>
 #include <esl/utility/MIME.h>
 #include <esl/utility/HttpMethod.h>
 
 #include <string>
 #include <map>
+#include <utility>
+#include <vector>
 #include <memory>
 #include <cstdint>
 
 #include <microhttpd.h>
 
+#ifdef _WIN32
+#include <Winsock2.h>
+#else
+#include <sys/socket.h>
+#endif
+
 struct MHD_Connection;
 
 namespace mhd4esl {
@@ -38,6 +47,9 @@ namespace com {
 namespace http {
 namespace server {
 
+struct ClientCertificate;
+struct ConnectionContext;
+
 class Request : public esl::com::http::server::Request {
 public:
 	Request(MHD_Connection& mhdConnection, const char* httpVersion, const char* method, const char* url, bool isHttps, uint16_t hostPort);
@@ -55,14 +67,52 @@ public:
 
 	const std::string& getPath() const noexcept override;
 	const esl::utility::HttpMethod& getMethod() const noexcept override;
+	const std::string& getMethodName() const noexcept;
 	const std::map<std::string, std::string>& getHeaders() const noexcept override;
 	const esl::utility::MIME& getContentType() const noexcept override;
 	bool hasArgument(const std::string& key) const noexcept override;
 	const std::string& getArgument(const std::string& key) const override;
 
+	esl::com::http::server::MHDRequest::Address getRemoteAddressBinary() const noexcept;
+	static esl::com::http::server::MHDRequest::Address toAddress(const sockaddr* sockAddr) noexcept;
+	/* numeric representation of the address, empty if the family is unknown */
+	static std::string toString(const esl::com::http::server::MHDRequest::Address& address);
+	/* port of an AF_INET or AF_INET6 address, 0 otherwise */
+	static uint16_t toPort(const sockaddr* sockAddr) noexcept;
+
+	/* case insensitive lookup of a request header, nullptr if the header does not exist */
+	const char* findHeader(const char* key) const noexcept;
+
+	/* false if the request has no valid header "Content-Length" */
+	bool getContentLength(std::uint64_t& contentLength) const noexcept;
+
+	/* all query arguments sorted by key and value */
+	std::string getNormalizedArguments() const;
+
+	/* W3C trace context of the "traceparent" header, IDs are lowercase hex strings */
+	struct TraceParent {
+		std::string traceId;
+		std::string parentSpanId;
+		std::uint8_t traceFlags = 0;
+	};
+
+	/* nullptr if the request has no valid "traceparent" header */
+	const TraceParent* getTraceParent() const noexcept;
+
+	static bool parseTraceParent(const char* value, TraceParent& traceParent);
+
+	/* nullptr if the client has not sent a valid certificate or if client certificates are not requested */
+	const std::shared_ptr<const ClientCertificate>& getClientCertificate() const noexcept;
+
+	/* random ID of the given number of bytes as lowercase hex string */
+	static std::string createTraceId(std::size_t bytes);
+
 
 private:
 	static MHD_Result readHeaders(void* requestPtr, MHD_ValueKind kind, const char* key, const char* value);
+	void resolveForwardedAddress(ConnectionContext& connectionContext);
+
+	static MHD_Result readArguments(void* argumentsPtr, MHD_ValueKind kind, const char* key, const char* value);
 
 	MHD_Connection& mhdConnection;
 
@@ -73,9 +123,16 @@ private:
 	const uint16_t hostPort;
 	std::string hostAddress;
 
-	std::string remoteAddress;
-	uint16_t remotePort = 0;
+	/* remote address is formatted on first access only */
+	sockaddr_storage remoteSockAddr;
+	mutable std::string remoteAddress;
+	mutable bool remoteAddressFormatted = false;
 
+	/* client address given by a trusted proxy */
+	bool hasForwardedAddress = false;
+	esl::com::http::server::MHDRequest::Address forwardedAddress;
+
+	const std::string methodName;
 	const esl::utility::HttpMethod method;
 	const std::string url;
 
@@ -87,6 +144,11 @@ private:
 	// std::string contentEncodingHeader;
 
 	mutable std::map<std::string, std::string> arguments;
+
+	bool hasTraceParent = false;
+	TraceParent traceParent;
+
+	std::shared_ptr<const ClientCertificate> clientCertificate;
 };
 
 } /* namespace server */
@@ -19,6 +19,8 @@
 #include <mhd4esl/com/http/server/RequestContext.h>
 #include <mhd4esl/com/http/server/Socket.h>
 
+#include <esl/com/http/server/exception/StatusCode.h>
+
 namespace mhd4esl {
 inline namespace v1_6 {
 namespace com {
@@ -29,7 +31,17 @@ RequestContext::RequestContext(MHD_Connection& mhdConnection, const char* versio
 : esl::com::http::server::RequestContext(),
   connection(mhdConnection),
   request(mhdConnection, version, method, url, isHTTPS, port)
-{ }
+{
+	timeline.headersReceived = std::chrono::steady_clock::now();
+
+	const Request::TraceParent* traceParent = request.getTraceParent();
+	if(traceParent) {
+		const char* traceState = request.findHeader("tracestate");
+		traceContextPtr.reset(new esl::com::http::server::MHDTraceContext(
+				traceParent->traceId, traceParent->parentSpanId, Request::createTraceId(8), traceParent->traceFlags, traceState ? traceState : ""));
+		traceContext = traceContextPtr.get();
+	}
+}
 
 esl::com::http::server::Connection& RequestContext::getConnection() const {
 	return connection;
@@ -43,12 +55,30 @@ const std::string& RequestContext::getPath() const {
 	return request.getPath();
 }
 
+void RequestContext::setMaxBodySize(std::uint64_t aMaxBodySize) {
+	std::uint64_t contentLength;
+	if(aMaxBodySize > 0 && request.getContentLength(contentLength) && contentLength > aMaxBodySize) {
+		throw esl::com::http::server::exception::StatusCode(413);
+	}
+	maxBodySize = aMaxBodySize;
+}
+
 esl::object::Context& RequestContext::getObjectContext() {
-	return context;
+	return getContext();
 }
 
 const esl::object::Context& RequestContext::getObjectContext() const {
-	return context;
+	return getContext();
+}
+
+common4esl::object::Context& RequestContext::getContext() const {
+	if(!context) {
+		context.reset(new common4esl::object::Context);
+		if(traceContextPtr) {
+			context->addObject(esl::com::http::server::MHDTraceContext::id, std::move(traceContextPtr));
+		}
+	}
+	return *context;
 }
 
 } /* namespace server */
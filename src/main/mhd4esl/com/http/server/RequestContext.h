@@ -20,20 +20,26 @@
 #define MHD4ESL_COM_HTTP_SERVER_REQUESTCONTEXT_H_
 
 #include <mhd4esl/com/http/server/Connection.h>
+#include <mhd4esl/com/http/server/ConnectionContext.h>
 #include <mhd4esl/com/http/server/Request.h>
+#include <mhd4esl/com/http/server/Router.h>
 
 #include <common4esl/object/Context.h>
 
 #include <esl/com/http/server/RequestContext.h>
 #include <esl/com/http/server/Connection.h>
+#include <esl/com/http/server/MHDTraceContext.h>
 #include <esl/com/http/server/Request.h>
 #include <esl/io/Input.h>
 //#include <esl/object/Object.h>
 #include <esl/object/Context.h>
 
+#include <chrono>
 #include <string>
 #include <memory>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
 
 struct MHD_Connection;
 
@@ -45,6 +51,8 @@ namespace server {
 
 class RequestContext : public esl::com::http::server::RequestContext {
 	friend class Socket;
+	friend class ResponseCache;
+	friend class Router;
 public:
 	RequestContext(MHD_Connection& mhdConnection, const char* version, const char* method, const char* url, bool isHTTPS, uint16_t port);
 
@@ -54,11 +62,56 @@ public:
 	esl::object::Context& getObjectContext() override;
 	const esl::object::Context& getObjectContext() const override;
 
+	/* 0 means unlimited. Throws exception::StatusCode(413) if the content length exceeds it. */
+	void setMaxBodySize(std::uint64_t maxBodySize);
+
 private:
+	common4esl::object::Context& getContext() const;
+
+	void setConnectionState(ConnectionContext::State state) noexcept {
+		if(connectionContext) {
+			connectionContext->setState(state);
+		}
+	}
+
+	/* monotonic timestamps, time_point() if the point has not been reached */
+	struct Timeline {
+		std::chrono::steady_clock::time_point headersReceived;
+		std::chrono::steady_clock::time_point acceptReturned;
+		std::chrono::steady_clock::time_point uploadCompleted;
+		std::chrono::steady_clock::time_point responseQueued;
+		std::chrono::steady_clock::time_point requestCompleted;
+	};
+
 	mutable Connection connection;
 	Request request;
 	esl::io::Input input;
-	common4esl::object::Context context;
+	/* created by the first call of getObjectContext(), most requests do not need it */
+	mutable std::unique_ptr<common4esl::object::Context> context;
+	Router::Parameters routeParameters;
+
+	Timeline timeline;
+	/* set only if the connection is tracked for introspection */
+	ConnectionContext* connectionContext = nullptr;
+	/* nullptr if the request has no valid "traceparent" header. It is moved into the object context when that is created. */
+	const esl::com::http::server::MHDTraceContext* traceContext = nullptr;
+	mutable std::unique_ptr<esl::com::http::server::MHDTraceContext> traceContextPtr;
+
+	std::uint64_t maxBodySize = 0;
+	/* body bytes consumed by the input so far */
+	std::uint64_t bodySize = 0;
+	/* body buffer of the connection if the body is collected before it is written, its bytes up to
+	 * smallBodyPos have been consumed by the writer */
+	std::string* smallBody = nullptr;
+	std::size_t smallBodyPos = 0;
+	/* a response has been queued before the request handler has been called */
+	bool rejected = false;
+
+	/* state of calls that are dispatched to the executor of the socket */
+	bool acceptFailed = false;
+	bool writeCompleted = false;
+	std::size_t writeResult = 0;
+	std::exception_ptr writeException;
 };
 
 } /* namespace server */
@@ -0,0 +1,402 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/ResponseCache.h>
+#include <mhd4esl/com/http/server/ETag.h>
+#include <mhd4esl/com/http/server/Executor.h>
+#include <mhd4esl/com/http/server/Headers.h>
+#include <mhd4esl/com/http/server/Metrics.h>
+#include <mhd4esl/com/http/server/RequestContext.h>
+
+#include <microhttpd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+
+/* calls function for every comma separated, trimmed element of value */
+void forEachElement(const std::string& value, const std::function<void(const std::string&)>& function) {
+	std::string::size_type begin = 0;
+	while(begin < value.size()) {
+		std::string::size_type end = value.find(',', begin);
+		if(end == std::string::npos) {
+			end = value.size();
+		}
+
+		std::string::size_type first = begin;
+		std::string::size_type last = end;
+		while(first < last && std::isspace(static_cast<unsigned char>(value[first]))) {
+			++first;
+		}
+		while(last > first && std::isspace(static_cast<unsigned char>(value[last-1]))) {
+			--last;
+		}
+		if(first < last) {
+			function(value.substr(first, last - first));
+		}
+
+		begin = end + 1;
+	}
+}
+
+/* returns 0 if the response must not be cached. Responses to requests with authorization are cached only if
+ * they allow it explicitly by 'public', 's-maxage' or 'must-revalidate' (RFC 9111, section 3.5). */
+long getMaxAge(const esl::com::http::server::Response& response, bool authorized) {
+	const std::string* cacheControl = Headers::find(response, "Cache-Control");
+	if(cacheControl == nullptr || Headers::find(response, "Set-Cookie") != nullptr) {
+		return 0;
+	}
+
+	bool noStore = false;
+	bool sharedAllowed = false;
+	long maxAge = 0;
+	long sharedMaxAge = -1;
+
+	forEachElement(*cacheControl, [&](const std::string& directive) {
+		std::string::size_type pos = directive.find('=');
+		std::string name = directive.substr(0, pos);
+		for(auto& c : name) {
+			c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		}
+
+		if(name == "no-store" || name == "no-cache" || name == "private") {
+			noStore = true;
+		}
+		else if(name == "public" || name == "must-revalidate") {
+			sharedAllowed = true;
+		}
+		else if(pos != std::string::npos && (name == "max-age" || name == "s-maxage")) {
+			std::string value = directive.substr(pos + 1);
+			if(!value.empty() && value.front() == '"' && value.back() == '"' && value.size() >= 2) {
+				value = value.substr(1, value.size() - 2);
+			}
+			long seconds = std::strtol(value.c_str(), nullptr, 10);
+			if(name == "max-age") {
+				maxAge = seconds;
+			}
+			else {
+				sharedMaxAge = seconds;
+			}
+		}
+	});
+
+	if(noStore || (authorized && !sharedAllowed && sharedMaxAge < 0)) {
+		return 0;
+	}
+	return sharedMaxAge >= 0 ? sharedMaxAge : maxAge;
+}
+
+bool isCacheableStatusCode(unsigned short statusCode) noexcept {
+	switch(statusCode) {
+	case 200:
+	case 203:
+	case 204:
+	case 300:
+	case 301:
+	case 404:
+	case 405:
+	case 410:
+	case 414:
+	case 501:
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
+} /* anonymous namespace */
+
+ResponseCache::ResponseCache(const esl::com::http::server::MHDResponseCache::Settings& aSettings, const esl::com::http::server::RequestHandler& aRequestHandler)
+: settings(aSettings),
+  requestHandler(aRequestHandler),
+  maxEntriesPerShard(std::max<std::size_t>(1, aSettings.maxEntries / std::max<std::size_t>(1, aSettings.shards))),
+  maxSizePerShard(std::max<std::size_t>(1, aSettings.maxSize / std::max<std::size_t>(1, aSettings.shards)))
+{
+	for(std::size_t i = 0; i < std::max<std::size_t>(1, settings.shards); ++i) {
+		shards.emplace_back(new Shard);
+	}
+}
+
+esl::io::Input ResponseCache::accept(esl::com::http::server::RequestContext& requestContext) const {
+	RequestContext* nativeRequestContext = dynamic_cast<RequestContext*>(&requestContext);
+	if(nativeRequestContext == nullptr) {
+		return requestHandler.accept(requestContext);
+	}
+
+	const std::string& methodName = nativeRequestContext->request.getMethodName();
+	const bool isHead = (methodName == MHD_HTTP_METHOD_HEAD);
+	if(!isHead && methodName != MHD_HTTP_METHOD_GET) {
+		return requestHandler.accept(requestContext);
+	}
+
+	// responses to requests with authorization must not be served to other users, but they might be stored
+	const bool authorized = nativeRequestContext->request.findHeader(MHD_HTTP_HEADER_AUTHORIZATION) != nullptr;
+	if(authorized && isHead) {
+		return requestHandler.accept(requestContext);
+	}
+
+	Connection& connection = nativeRequestContext->connection;
+	const std::string key = createKey(nativeRequestContext->request);
+	Shard& shard = getShard(key);
+	std::shared_ptr<Pending> pending;
+
+	if(!authorized) {
+		std::unique_lock<std::mutex> lock(shard.mutex);
+
+		auto iter = shard.entryByKey.find(key);
+		if(iter != shard.entryByKey.end()) {
+			if(iter->second->second->expiresAt > std::chrono::steady_clock::now()) {
+				shard.entries.splice(shard.entries.begin(), shard.entries, iter->second);
+				std::shared_ptr<const Entry> entry = iter->second->second;
+				lock.unlock();
+
+				Metrics::get().responseCacheHits.fetch_add(1, std::memory_order_relaxed);
+				send(connection, *entry);
+				return esl::io::Input();
+			}
+			erase(shard, iter->second);
+		}
+		Metrics::get().responseCacheMisses.fetch_add(1, std::memory_order_relaxed);
+
+		// HEAD requests are served from cached GET responses, but they don't fill the cache
+		if(isHead) {
+			lock.unlock();
+			return requestHandler.accept(requestContext);
+		}
+
+		auto pendingIter = shard.pendingByKey.find(key);
+		if(pendingIter != shard.pendingByKey.end()) {
+			// Waiting would block threads of MHD that serve other connections as well,
+			// so only handler threads wait for the pending response.
+			if(!Executor::isWorkerThread()) {
+				lock.unlock();
+				return requestHandler.accept(requestContext);
+			}
+
+			std::shared_ptr<Pending> otherPending = pendingIter->second;
+			otherPending->condVar.wait(lock, [&otherPending] {
+				return otherPending->done;
+			});
+
+			std::shared_ptr<const Entry> entry = otherPending->entry;
+			lock.unlock();
+
+			if(entry) {
+				Metrics::get().responseCacheCoalesced.fetch_add(1, std::memory_order_relaxed);
+				send(connection, *entry);
+				return esl::io::Input();
+			}
+
+			// response has not been cacheable, so every request has to be handled on it's own
+			return requestHandler.accept(requestContext);
+		}
+
+		pending = std::make_shared<Pending>();
+		shard.pendingByKey[key] = pending;
+	}
+
+	Connection::Capture capture;
+	capture.maxSize = settings.maxEntrySize;
+	esl::io::Input input;
+	std::shared_ptr<const Entry> entry;
+
+	try {
+		connection.startCapture(capture);
+		input = requestHandler.accept(requestContext);
+		connection.stopCapture();
+
+		if(!input && !capture.bypassed && capture.response) {
+			entry = createEntry(capture, authorized, connection.hasAutoETag());
+		}
+	}
+	catch(...) {
+		connection.stopCapture();
+		complete(shard, key, pending, nullptr);
+		throw;
+	}
+
+	complete(shard, key, pending, entry);
+
+	if(entry) {
+		send(connection, *entry);
+	}
+	else if(capture.response) {
+		connection.sendCaptured(*capture.response, std::move(capture.body));
+	}
+
+	return input;
+}
+
+void ResponseCache::clear() {
+	for(auto& shard : shards) {
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		shard->entryByKey.clear();
+		shard->entries.clear();
+		shard->size = 0;
+	}
+}
+
+std::string ResponseCache::createKey(const Request& request) const {
+	// the socket might serve several hosts by HTTP and HTTPS
+	std::string key = request.isHTTPS() ? "https\n" : "http\n";
+	const char* host = request.findHeader(MHD_HTTP_HEADER_HOST);
+	if(host) {
+		key += host;
+	}
+	key += '\n';
+	key += request.getPath();
+	key += '\n';
+	key += request.getNormalizedArguments();
+
+	for(const auto& varyHeader : settings.varyHeaders) {
+		key += '\n';
+		const char* value = request.findHeader(varyHeader.c_str());
+		if(value) {
+			key += value;
+		}
+		else {
+			key += '\x1f';
+		}
+	}
+
+	return key;
+}
+
+ResponseCache::Shard& ResponseCache::getShard(const std::string& key) const noexcept {
+	return *shards[std::hash<std::string>()(key) % shards.size()];
+}
+
+std::shared_ptr<const ResponseCache::Entry> ResponseCache::createEntry(const Connection::Capture& capture, bool authorized, bool autoETag) const {
+	const esl::com::http::server::Response& response = *capture.response;
+	if(!isCacheableStatusCode(response.getStatusCode())) {
+		return nullptr;
+	}
+
+	const std::string* vary = Headers::find(response, "Vary");
+	if(vary && !isVaryAccepted(*vary)) {
+		return nullptr;
+	}
+
+	long maxAge = getMaxAge(response, authorized);
+	if(maxAge <= 0) {
+		return nullptr;
+	}
+
+	std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+	entry->response.reset(new esl::com::http::server::Response(response));
+	MHD_Response* mhdResponse = MHD_create_response_from_buffer(capture.body->size(), const_cast<char*>(capture.body->data()), MHD_RESPMEM_MUST_COPY);
+	if(mhdResponse == nullptr) {
+		return nullptr;
+	}
+	entry->mhdResponse = std::shared_ptr<MHD_Response>(mhdResponse, MHD_destroy_response);
+	Connection::addHeaders(response, mhdResponse);
+
+	// the ETag is created once for all connections that are served by the entry
+	const std::string* etag = Headers::find(response, MHD_HTTP_HEADER_ETAG);
+	if(etag) {
+		entry->etag = *etag;
+	}
+	else if(autoETag && response.getStatusCode() == MHD_HTTP_OK) {
+		entry->etag = ETag::create(capture.body->data(), capture.body->size());
+		MHD_add_response_header(mhdResponse, MHD_HTTP_HEADER_ETAG, entry->etag.c_str());
+	}
+
+	entry->expiresAt = std::chrono::steady_clock::now() + std::chrono::seconds(maxAge);
+	entry->size = capture.body->size();
+	for(const auto& header : response.getHeaders()) {
+		entry->size += header.first.size() + header.second.size();
+	}
+
+	return entry;
+}
+
+bool ResponseCache::isVaryAccepted(const std::string& vary) const noexcept {
+	bool accepted = true;
+
+	forEachElement(vary, [this, &accepted](const std::string& name) {
+		bool found = false;
+		for(const auto& varyHeader : settings.varyHeaders) {
+			if(Headers::equals(varyHeader, name.c_str())) {
+				found = true;
+				break;
+			}
+		}
+		accepted &= found;
+	});
+
+	return accepted;
+}
+
+void ResponseCache::complete(Shard& shard, const std::string& key, const std::shared_ptr<Pending>& pending, std::shared_ptr<const Entry> entry) const noexcept {
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		if(pending) {
+			shard.pendingByKey.erase(key);
+			pending->done = true;
+			pending->entry = entry;
+		}
+
+		if(entry && entry->size <= maxSizePerShard) {
+			auto iter = shard.entryByKey.find(key);
+			if(iter != shard.entryByKey.end()) {
+				erase(shard, iter->second);
+			}
+
+			while(!shard.entries.empty() && (shard.entries.size() >= maxEntriesPerShard || shard.size + entry->size > maxSizePerShard)) {
+				erase(shard, std::prev(shard.entries.end()));
+			}
+
+			shard.entries.emplace_front(key, entry);
+			shard.entryByKey[key] = shard.entries.begin();
+			shard.size += entry->size;
+		}
+	}
+
+	if(pending) {
+		pending->condVar.notify_all();
+	}
+}
+
+void ResponseCache::send(Connection& connection, const Entry& entry) noexcept {
+	// the response is shared by all connections serving the entry, so neither the body nor the headers are copied
+	connection.sendShared(*entry.response, entry.mhdResponse, entry.etag);
+}
+
+void ResponseCache::erase(Shard& shard, Entries::iterator iter) noexcept {
+	shard.size -= iter->second->size;
+	shard.entryByKey.erase(iter->first);
+	shard.entries.erase(iter);
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
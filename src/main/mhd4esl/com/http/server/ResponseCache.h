@@ -0,0 +1,108 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_RESPONSECACHE_H_
+#define MHD4ESL_COM_HTTP_SERVER_RESPONSECACHE_H_
+
+#include <mhd4esl/com/http/server/Connection.h>
+#include <mhd4esl/com/http/server/Request.h>
+
+#include <esl/com/http/server/MHDResponseCache.h>
+#include <esl/com/http/server/RequestContext.h>
+#include <esl/com/http/server/RequestHandler.h>
+#include <esl/com/http/server/Response.h>
+#include <esl/io/Input.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+class ResponseCache : public esl::com::http::server::RequestHandler {
+public:
+	ResponseCache(const esl::com::http::server::MHDResponseCache::Settings& settings, const esl::com::http::server::RequestHandler& requestHandler);
+
+	esl::io::Input accept(esl::com::http::server::RequestContext& requestContext) const override;
+
+	void clear();
+
+private:
+	struct Entry {
+		std::unique_ptr<const esl::com::http::server::Response> response;
+		/* queued on every connection that is served by this entry */
+		std::shared_ptr<MHD_Response> mhdResponse;
+		/* ETag of the response or the one created for it by auto ETags, empty if it has none */
+		std::string etag;
+		std::chrono::steady_clock::time_point expiresAt;
+		std::size_t size = 0;
+	};
+
+	struct Pending {
+		bool done = false;
+		std::shared_ptr<const Entry> entry;
+		std::condition_variable condVar;
+	};
+
+	using Entries = std::list<std::pair<std::string, std::shared_ptr<const Entry>>>;
+
+	struct Shard {
+		std::mutex mutex;
+		/* most recently used entry first */
+		Entries entries;
+		std::unordered_map<std::string, Entries::iterator> entryByKey;
+		std::unordered_map<std::string, std::shared_ptr<Pending>> pendingByKey;
+		std::size_t size = 0;
+	};
+
+	/* scheme, host, path, sorted arguments and the values of the vary headers of the settings */
+	std::string createKey(const Request& request) const;
+	Shard& getShard(const std::string& key) const noexcept;
+	/* creates an ETag for responses without one if autoETag is true */
+	std::shared_ptr<const Entry> createEntry(const Connection::Capture& capture, bool authorized, bool autoETag) const;
+	bool isVaryAccepted(const std::string& vary) const noexcept;
+	void complete(Shard& shard, const std::string& key, const std::shared_ptr<Pending>& pending, std::shared_ptr<const Entry> entry) const noexcept;
+
+	static void send(Connection& connection, const Entry& entry) noexcept;
+	static void erase(Shard& shard, Entries::iterator iter) noexcept;
+
+	const esl::com::http::server::MHDResponseCache::Settings settings;
+	const esl::com::http::server::RequestHandler& requestHandler;
+	std::vector<std::unique_ptr<Shard>> shards;
+	const std::size_t maxEntriesPerShard;
+	const std::size_t maxSizePerShard;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_RESPONSECACHE_H_ */
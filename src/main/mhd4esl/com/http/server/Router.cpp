@@ -0,0 +1,393 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/Router.h>
+#include <mhd4esl/com/http/server/RequestContext.h>
+
+#include <esl/com/http/server/Response.h>
+#include <esl/io/output/String.h>
+#include <esl/system/Stacktrace.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+bool Router::Node::hasEndpoints() const noexcept {
+	for(const auto& endpoint : endpoints) {
+		if(endpoint) {
+			return true;
+		}
+	}
+	return !otherEndpoints.empty();
+}
+
+Router::Router() = default;
+
+Router::~Router() = default;
+
+void Router::add(const std::string& method, const std::string& pattern, const esl::com::http::server::RequestHandler& requestHandler) {
+	if(built) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot add route \"" + pattern + "\" because router has been built already"));
+	}
+	if(pattern.empty() || pattern.at(0) != '/') {
+		throw esl::system::Stacktrace::add(std::runtime_error("Invalid route \"" + pattern + "\", it has to start with '/'"));
+	}
+
+	std::unique_ptr<Endpoint> endpoint(new Endpoint);
+	endpoint->requestHandler = &requestHandler;
+
+	Node* node = &root;
+	std::string::size_type staticBegin = 0;
+	std::string::size_type pos = 0;
+
+	while(pos < pattern.size()) {
+		bool isCatchAll = false;
+		std::string name;
+		std::string::size_type next;
+
+		if(pattern.at(pos) == '{') {
+			std::string::size_type close = pattern.find('}', pos);
+			if(close == std::string::npos) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Invalid route \"" + pattern + "\", missing '}'"));
+			}
+			name = pattern.substr(pos + 1, close - pos - 1);
+			if(name.size() > 3 && name.compare(name.size() - 3, 3, "...") == 0) {
+				name.resize(name.size() - 3);
+				isCatchAll = true;
+			}
+			next = close + 1;
+		}
+		else if(pattern.at(pos) == '*' && pos + 1 == pattern.size()) {
+			name = "*";
+			isCatchAll = true;
+			next = pos + 1;
+		}
+		else {
+			++pos;
+			continue;
+		}
+
+		if(name.empty() || pattern.at(pos - 1) != '/' || (next < pattern.size() && pattern.at(next) != '/')) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Invalid route \"" + pattern + "\", parameters have to be complete path segments"));
+		}
+		if(isCatchAll && next != pattern.size()) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Invalid route \"" + pattern + "\", \"" + name + "...\" has to be the last segment"));
+		}
+		if(endpoint->parameterNames.size() >= Parameters::maxSize) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Invalid route \"" + pattern + "\", too many parameters"));
+		}
+
+		node = &insertStatic(*node, pattern.data() + staticBegin, pos - staticBegin);
+		std::unique_ptr<Node>& child = isCatchAll ? node->catchAllChild : node->parameterChild;
+		if(!child) {
+			child.reset(new Node);
+		}
+		node = child.get();
+		endpoint->parameterNames.push_back(name);
+
+		pos = next;
+		staticBegin = next;
+	}
+	node = &insertStatic(*node, pattern.data() + staticBegin, pattern.size() - staticBegin);
+
+	Method methodType = toMethod(method.data(), method.size());
+	if(methodType == methodOther) {
+		for(const auto& otherEndpoint : node->otherEndpoints) {
+			if(otherEndpoint.first == method) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Route \"" + method + " " + pattern + "\" is defined already"));
+			}
+		}
+		node->otherEndpoints.emplace_back(method, std::move(endpoint));
+	}
+	else {
+		if(node->endpoints[methodType]) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Route \"" + method + " " + pattern + "\" is defined already"));
+		}
+		node->endpoints[methodType] = std::move(endpoint);
+	}
+}
+
+void Router::build() {
+	built = true;
+}
+
+esl::io::Input Router::accept(esl::com::http::server::RequestContext& requestContext) const {
+	if(!built) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Router has not been built"));
+	}
+
+	RequestContext* nativeRequestContext = dynamic_cast<RequestContext*>(&requestContext);
+	Parameters localParameters;
+	Parameters& parameters = nativeRequestContext ? nativeRequestContext->routeParameters : localParameters;
+
+	const std::string& path = requestContext.getPath();
+	const std::string& methodName = nativeRequestContext ? nativeRequestContext->request.getMethodName() : requestContext.getRequest().getMethod().toString();
+	const esl::com::http::server::RequestHandler* requestHandler = find(methodName, path, parameters);
+
+	if(requestHandler == nullptr) {
+		std::string allowedMethods = getAllowedMethods(path);
+		if(allowedMethods.empty()) {
+			return esl::io::Input();
+		}
+
+		// RFC 9110 15.5.6: status 405 has to list the methods of the target resource
+		esl::com::http::server::Response response(405, esl::utility::MIME::Type::textPlain);
+		response.addHeader("Allow", allowedMethods);
+		requestContext.getConnection().send(response, esl::io::output::String::create("405 Method Not Allowed\n"));
+		return esl::io::Input();
+	}
+
+	return requestHandler->accept(requestContext);
+}
+
+const esl::com::http::server::RequestHandler* Router::find(const std::string& methodName, const std::string& path, Parameters& parameters) const noexcept {
+	parameters.names = nullptr;
+	parameters.size = 0;
+
+	const Endpoint* endpoint = lookup(root, path.data(), path.data(), path.data() + path.size(), toMethod(methodName.data(), methodName.size()), methodName.c_str(), parameters);
+	if(endpoint == nullptr) {
+		return nullptr;
+	}
+
+	parameters.names = &endpoint->parameterNames;
+	return endpoint->requestHandler;
+}
+
+std::string Router::getAllowedMethods(const std::string& path) const {
+	std::string allowedMethods;
+	collectMethods(root, path.data(), path.data() + path.size(), allowedMethods);
+	return allowedMethods;
+}
+
+const Router::Parameters* Router::getParameters(const esl::com::http::server::RequestContext& requestContext) noexcept {
+	const RequestContext* nativeRequestContext = dynamic_cast<const RequestContext*>(&requestContext);
+	if(nativeRequestContext == nullptr || nativeRequestContext->routeParameters.names == nullptr) {
+		return nullptr;
+	}
+	return &nativeRequestContext->routeParameters;
+}
+
+Router::Method Router::toMethod(const char* method, std::size_t size) noexcept {
+	switch(size) {
+	case 1:
+		return method[0] == '*' ? methodAny : methodOther;
+	case 3:
+		if(std::memcmp(method, "GET", 3) == 0) {
+			return methodGet;
+		}
+		if(std::memcmp(method, "PUT", 3) == 0) {
+			return methodPut;
+		}
+		break;
+	case 4:
+		if(std::memcmp(method, "POST", 4) == 0) {
+			return methodPost;
+		}
+		if(std::memcmp(method, "HEAD", 4) == 0) {
+			return methodHead;
+		}
+		break;
+	case 5:
+		if(std::memcmp(method, "PATCH", 5) == 0) {
+			return methodPatch;
+		}
+		break;
+	case 6:
+		if(std::memcmp(method, "DELETE", 6) == 0) {
+			return methodDelete;
+		}
+		break;
+	case 7:
+		if(std::memcmp(method, "OPTIONS", 7) == 0) {
+			return methodOptions;
+		}
+		break;
+	default:
+		break;
+	}
+	return methodOther;
+}
+
+Router::Node& Router::insertStatic(Node& node, const char* str, std::size_t size) {
+	if(size == 0) {
+		return node;
+	}
+
+	std::string::size_type pos = node.indices.find(str[0]);
+	if(pos == std::string::npos) {
+		std::unique_ptr<Node> child(new Node);
+		child->label.assign(str, size);
+		node.indices.push_back(str[0]);
+		node.children.push_back(std::move(child));
+		return *node.children.back();
+	}
+
+	const std::string& label = node.children[pos]->label;
+	std::size_t commonSize = 0;
+	while(commonSize < label.size() && commonSize < size && label[commonSize] == str[commonSize]) {
+		++commonSize;
+	}
+
+	if(commonSize < label.size()) {
+		// split the edge at the first differing character
+		std::unique_ptr<Node> split(new Node);
+		split->label = label.substr(0, commonSize);
+		node.children[pos]->label.erase(0, commonSize);
+		split->indices.push_back(node.children[pos]->label[0]);
+		split->children.push_back(std::move(node.children[pos]));
+		node.children[pos] = std::move(split);
+	}
+
+	return insertStatic(*node.children[pos], str + commonSize, size - commonSize);
+}
+
+const Router::Endpoint* Router::lookup(const Node& node, const char* begin, const char* current, const char* end, Method method, const char* methodName, Parameters& parameters) noexcept {
+	const std::size_t labelSize = node.label.size();
+	if(static_cast<std::size_t>(end - current) < labelSize || std::memcmp(current, node.label.data(), labelSize) != 0) {
+		return nullptr;
+	}
+	current += labelSize;
+
+	if(current == end) {
+		const Endpoint* endpoint = findEndpoint(node, method, methodName);
+		if(endpoint) {
+			return endpoint;
+		}
+	}
+	else {
+		// static children are preferred to parameters
+		const void* index = node.indices.empty() ? nullptr : std::memchr(node.indices.data(), *current, node.indices.size());
+		if(index != nullptr) {
+			const std::size_t pos = static_cast<std::size_t>(static_cast<const char*>(index) - node.indices.data());
+			const Endpoint* endpoint = lookup(*node.children[pos], begin, current, end, method, methodName, parameters);
+			if(endpoint) {
+				return endpoint;
+			}
+		}
+
+		if(node.parameterChild && *current != '/' && parameters.size < Parameters::maxSize) {
+			const void* slash = std::memchr(current, '/', static_cast<std::size_t>(end - current));
+			const char* segmentEnd = slash ? static_cast<const char*>(slash) : end;
+
+			parameters.slots[parameters.size] = std::make_pair(static_cast<std::size_t>(current - begin), static_cast<std::size_t>(segmentEnd - current));
+			++parameters.size;
+			const Endpoint* endpoint = lookup(*node.parameterChild, begin, segmentEnd, end, method, methodName, parameters);
+			if(endpoint) {
+				return endpoint;
+			}
+			--parameters.size;
+		}
+	}
+
+	if(node.catchAllChild && parameters.size < Parameters::maxSize) {
+		const Endpoint* endpoint = findEndpoint(*node.catchAllChild, method, methodName);
+		if(endpoint) {
+			parameters.slots[parameters.size] = std::make_pair(static_cast<std::size_t>(current - begin), static_cast<std::size_t>(end - current));
+			++parameters.size;
+			return endpoint;
+		}
+	}
+
+	return nullptr;
+}
+
+void Router::collectMethods(const Node& node, const char* current, const char* end, std::string& allowedMethods) {
+	const std::size_t labelSize = node.label.size();
+	if(static_cast<std::size_t>(end - current) < labelSize || std::memcmp(current, node.label.data(), labelSize) != 0) {
+		return;
+	}
+	current += labelSize;
+
+	if(current == end) {
+		addMethods(node, allowedMethods);
+	}
+	else {
+		const void* index = node.indices.empty() ? nullptr : std::memchr(node.indices.data(), *current, node.indices.size());
+		if(index != nullptr) {
+			const std::size_t pos = static_cast<std::size_t>(static_cast<const char*>(index) - node.indices.data());
+			collectMethods(*node.children[pos], current, end, allowedMethods);
+		}
+
+		if(node.parameterChild && *current != '/') {
+			const void* slash = std::memchr(current, '/', static_cast<std::size_t>(end - current));
+			collectMethods(*node.parameterChild, slash ? static_cast<const char*>(slash) : end, end, allowedMethods);
+		}
+	}
+
+	if(node.catchAllChild) {
+		addMethods(*node.catchAllChild, allowedMethods);
+	}
+}
+
+void Router::addMethods(const Node& node, std::string& allowedMethods) {
+	// same order as enum Method, a GET route answers HEAD requests as well
+	static const char* const methodNames[] = { "GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS" };
+
+	auto add = [&allowedMethods](const std::string& methodName) {
+		std::string::size_type pos = 0;
+		while(pos < allowedMethods.size()) {
+			std::string::size_type next = allowedMethods.find(", ", pos);
+			if(allowedMethods.compare(pos, (next == std::string::npos ? allowedMethods.size() : next) - pos, methodName) == 0) {
+				return;
+			}
+			pos = next == std::string::npos ? allowedMethods.size() : next + 2;
+		}
+		if(!allowedMethods.empty()) {
+			allowedMethods += ", ";
+		}
+		allowedMethods += methodName;
+	};
+
+	for(std::size_t method = 0; method < methodAny; ++method) {
+		if(node.endpoints[method] || (method == methodHead && node.endpoints[methodGet])) {
+			add(methodNames[method]);
+		}
+	}
+	for(const auto& otherEndpoint : node.otherEndpoints) {
+		add(otherEndpoint.first);
+	}
+}
+
+const Router::Endpoint* Router::findEndpoint(const Node& node, Method method, const char* methodName) noexcept {
+	if(method == methodOther) {
+		for(const auto& otherEndpoint : node.otherEndpoints) {
+			if(otherEndpoint.first == methodName) {
+				return otherEndpoint.second.get();
+			}
+		}
+	}
+	else if(node.endpoints[method]) {
+		return node.endpoints[method].get();
+	}
+	else if(method == methodHead && node.endpoints[methodGet]) {
+		return node.endpoints[methodGet].get();
+	}
+
+	return node.endpoints[methodAny].get();
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
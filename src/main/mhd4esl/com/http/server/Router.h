@@ -0,0 +1,121 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_ROUTER_H_
+#define MHD4ESL_COM_HTTP_SERVER_ROUTER_H_
+
+#include <esl/com/http/server/RequestContext.h>
+#include <esl/com/http/server/RequestHandler.h>
+#include <esl/io/Input.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+class Router : public esl::com::http::server::RequestHandler {
+public:
+	/* Captured path parameters of the matching route. Slots are preallocated,
+	 * so matching a request does not allocate memory. */
+	struct Parameters {
+		enum : std::size_t { maxSize = 16 };
+
+		const std::vector<std::string>* names = nullptr;
+		std::size_t size = 0;
+		std::pair<std::size_t, std::size_t> slots[maxSize]; // offset and length within the path
+	};
+
+	Router();
+	~Router();
+
+	/* Pattern segments are static text, "{name}" for a single segment or "{name...}" resp. "*"
+	 * as last segment to match the rest of the path. Method "*" matches any method. */
+	void add(const std::string& method, const std::string& pattern, const esl::com::http::server::RequestHandler& requestHandler);
+	void build();
+
+	esl::io::Input accept(esl::com::http::server::RequestContext& requestContext) const override;
+
+	/* Returns the request handler of the first route that matches method and path or nullptr.
+	 * parameters are set to the parameters of the route. */
+	const esl::com::http::server::RequestHandler* find(const std::string& method, const std::string& path, Parameters& parameters) const noexcept;
+
+	/* Returns the methods of all routes that match the path as value of header "Allow", empty if there is none */
+	std::string getAllowedMethods(const std::string& path) const;
+
+	static const Parameters* getParameters(const esl::com::http::server::RequestContext& requestContext) noexcept;
+
+private:
+	struct Endpoint {
+		const esl::com::http::server::RequestHandler* requestHandler = nullptr;
+		std::vector<std::string> parameterNames;
+	};
+
+	enum Method : std::size_t {
+		methodGet = 0,
+		methodHead,
+		methodPost,
+		methodPut,
+		methodDelete,
+		methodPatch,
+		methodOptions,
+		methodAny,
+		methodOther
+	};
+
+	struct Node {
+		std::string label;
+		/* first character of every static child, same order as children */
+		std::string indices;
+		std::vector<std::unique_ptr<Node>> children;
+		std::unique_ptr<Node> parameterChild;
+		std::unique_ptr<Node> catchAllChild;
+
+		std::unique_ptr<Endpoint> endpoints[methodOther];
+		std::vector<std::pair<std::string, std::unique_ptr<Endpoint>>> otherEndpoints;
+
+		bool hasEndpoints() const noexcept;
+	};
+
+	static Method toMethod(const char* method, std::size_t size) noexcept;
+	static Node& insertStatic(Node& node, const char* str, std::size_t size);
+	/* Returns the endpoint of the first route that matches path and method. Routes that match the path only
+	 * do not stop the search, so a parameter or catch-all route of the method is found behind them. */
+	static const Endpoint* lookup(const Node& node, const char* begin, const char* current, const char* end, Method method, const char* methodName, Parameters& parameters) noexcept;
+	static const Endpoint* findEndpoint(const Node& node, Method method, const char* methodName) noexcept;
+	/* adds the methods of all routes that match the path to allowedMethods as value of header "Allow" */
+	static void collectMethods(const Node& node, const char* current, const char* end, std::string& allowedMethods);
+	static void addMethods(const Node& node, std::string& allowedMethods);
+
+	Node root;
+	bool built = false;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_ROUTER_H_ */
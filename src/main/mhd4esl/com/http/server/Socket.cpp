@@ -18,17 +18,28 @@
 
 #include <mhd4esl/com/http/server/Socket.h>
 #include <mhd4esl/com/http/server/RequestContext.h>
+#include <mhd4esl/com/http/server/CertificateStore.h>
+#include <mhd4esl/com/http/server/ClientCertificateCache.h>
 #include <mhd4esl/com/http/server/Connection.h>
-
-#include <gtx4esl/crypto/Entries.h>
-#include <gtx4esl/crypto/Entry.h>
+#include <mhd4esl/com/http/server/ConnectionContext.h>
+#include <mhd4esl/com/http/server/EventStreamRegistry.h>
+#include <mhd4esl/com/http/server/Executor.h>
+#include <mhd4esl/com/http/server/FileReadAhead.h>
+#include <mhd4esl/com/http/server/Metrics.h>
+#include <mhd4esl/com/http/server/ProxyProtocolListener.h>
+#include <mhd4esl/com/http/server/Request.h>
+#include <mhd4esl/com/http/server/StatusCodeResponses.h>
+#include <mhd4esl/com/http/server/StreamNotifierRegistry.h>
+#include <mhd4esl/com/http/server/TraceExporter.h>
+#include <mhd4esl/com/http/server/TrustedProxies.h>
+#include <mhd4esl/com/http/server/WebSocketReactor.h>
+#include <mhd4esl/Logging.h>
 
 #include <esl/com/http/server/exception/StatusCode.h>
 #include <esl/com/http/server/Response.h>
 #include <esl/io/output/String.h>
 #include <esl/io/Writer.h>
 #include <esl/Logger.h>
-#include <esl/plugin/Registry.h>
 #include <esl/system/Stacktrace.h>
 #include <esl/utility/String.h>
 
@@ -36,12 +47,18 @@
 #include <gnutls/gnutls.h>
 #include <gnutls/abstract.h>
 
+#include <cctype>
 #include <fstream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <new>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace mhd4esl {
 inline namespace v1_6 {
@@ -73,44 +90,59 @@ const std::string PAGE_500(
 		"</body>\n"
 		"</html>\n");
 
-void mhdRequestCompletedHandler(void* cls,
-        MHD_Connection* mhdConnection,
-        void** connectionSpecificDataPtr,
-        enum MHD_RequestTerminationCode toe) noexcept
-{
-	RequestContext** requestContext = reinterpret_cast<RequestContext**>(connectionSpecificDataPtr);
+/* MHD sets the socket of the connection as transport of the TLS session and the callbacks of the
+ * handshake get nothing but the session, so they find the context of the connection by its socket. */
+std::mutex tlsConnectionContextsMutex;
+std::unordered_map<int, ConnectionContext*> tlsConnectionContexts;
 
-    if(*requestContext == nullptr) {
-        logger.error << "Request completed, but there is no RequestContext to delete\n";
-        return;
-    }
+bool addTlsConnectionContext(ConnectionContext& connectionContext, MHD_Connection* mhdConnection) noexcept {
+	const MHD_ConnectionInfo* socketInfo = MHD_get_connection_info(mhdConnection, MHD_CONNECTION_INFO_CONNECTION_FD);
+	if(socketInfo == nullptr) {
+		return false;
+	}
 
-    delete *requestContext;
-    *requestContext = nullptr;
+	try {
+		std::lock_guard<std::mutex> lock(tlsConnectionContextsMutex);
+		// a socket that is still registered belongs to a closed connection whose close notification is pending
+		tlsConnectionContexts[static_cast<int>(socketInfo->connect_fd)] = &connectionContext;
+	}
+	catch(...) {
+		return false;
+	}
+	connectionContext.tlsSocket = static_cast<int>(socketInfo->connect_fd);
+	return true;
 }
 
-bool hasMatchingHostname(const std::string& hostname, const std::string& hostnamePattern) {
-	logger.debug << "Check if hostname = \"" << hostname << "\" matches to hostnamePatter = \"" << hostnamePattern << "\".\n";
-
-	if(hostnamePattern.empty()) {
-		return true;
+void removeTlsConnectionContext(ConnectionContext& connectionContext) noexcept {
+	std::lock_guard<std::mutex> lock(tlsConnectionContextsMutex);
+	auto iter = tlsConnectionContexts.find(connectionContext.tlsSocket);
+	if(iter != tlsConnectionContexts.end() && iter->second == &connectionContext) {
+		tlsConnectionContexts.erase(iter);
 	}
-	else if(hostnamePattern.at(0) == '*') {
-		std::string::size_type patternSize = hostnamePattern.size()-1;
+}
 
-		return (hostname.size() >= patternSize && hostname.substr(hostname.size() - patternSize) == hostnamePattern.substr(1));
-	}
+ConnectionContext* getConnectionContext(gnutls_session_t session) noexcept {
+	// the context stays valid until the connection is closed, which cannot happen during its handshake
+	std::lock_guard<std::mutex> lock(tlsConnectionContextsMutex);
+	auto iter = tlsConnectionContexts.find(gnutls_transport_get_int(session));
+	return iter == tlsConnectionContexts.end() ? nullptr : iter->second;
+}
 
-	return hostname == hostnamePattern;
+int mhdClientHelloHook(gnutls_session_t session, unsigned int, unsigned int, unsigned int, const gnutls_datum_t* message) {
+	ConnectionContext* connectionContext = getConnectionContext(session);
+	if(connectionContext && message) {
+		CertificateStore::parseClientHello(*message, connectionContext->clientPkAlgorithms);
+	}
+	return 0;
 }
 
-int mhdSniCallback(gnutls_session_t session,
-		const gnutls_datum_t* req_ca_dn, int nreqs,
-		const gnutls_pk_algorithm_t* pk_algos, int pk_algos_length,
-		gnutls_pcert_st** pcert, unsigned int *pcertLength, gnutls_privkey_t * pkey)
+int mhdSniCallback(gnutls_session_t session, const gnutls_cert_retr_st* info,
+		gnutls_pcert_st** pcert, unsigned int* pcertLength,
+		gnutls_ocsp_data_st** ocsp, unsigned int* ocspLength,
+		gnutls_privkey_t* pkey, unsigned int* flags)
 {
 	std::string hostname;
-	logger.info << "Certificate requested.\n";
+	Metrics::get().tlsCertificateRequests.fetch_add(1, std::memory_order_relaxed);
 
 	{
 		char name[256];
@@ -119,60 +151,60 @@ int mhdSniCallback(gnutls_session_t session,
 
 		switch(gnutls_server_name_get(session, name, &nameLength, &type, 0)) {
 		case GNUTLS_E_SHORT_MEMORY_BUFFER:
-			logger.warn << "Length to retrieve SNI server name is too big. " << nameLength << " bytes are required.\n";
+			MHD4ESL_LOG(logger, warn) << "Length to retrieve SNI server name is too big. " << nameLength << " bytes are required.\n";
 			return -1;
 		case GNUTLS_E_REQUESTED_DATA_NOT_AVAILABLE:
-			logger.warn << "Cannot get SNI server name at index 0.\n";
+			MHD4ESL_LOG(logger, warn) << "Cannot get SNI server name at index 0.\n";
 			return -1;
 		case GNUTLS_E_SUCCESS:
 			hostname = name;
 			break;
 		default:
-			logger.warn << "Failed to get SNI server name.\n";
+			MHD4ESL_LOG(logger, warn) << "Failed to get SNI server name.\n";
 			return -1;
 		}
 	}
 
-	logger.trace << "Search certificate for hostname \"" << hostname << "\".\n";
-	const std::string* foundHostname = nullptr;
-
-	gtx4esl::crypto::Entries* keyStoreEntriesPtr = esl::plugin::Registry::get().findObject<gtx4esl::crypto::Entries>();
+	ConnectionContext* connectionContext = getConnectionContext(session);
+	if(connectionContext == nullptr || connectionContext->certificateStore == nullptr) {
+		logger.error << "No certificate store available for TLS handshake\n";
+		return -1;
+	}
 
-	if(keyStoreEntriesPtr) {
-		for(auto& entry : keyStoreEntriesPtr->entryByHostname) {
-			logger.trace << "Check certificate for hostname \"" << entry.first << "\".\n";
-			if(!hasMatchingHostname(hostname, entry.first)) {
-				logger.trace << "Certificate for hostname \"" << entry.first << "\" does not match\n";
-				continue;
-			}
+	// GnuTLS passes accepted public key algorithms to the callback of clients only
+	const bool hasPkAlgorithms = info && info->pk_algos_length > 0;
+	const gnutls_pk_algorithm_t* pkAlgorithms = hasPkAlgorithms ? info->pk_algos : connectionContext->clientPkAlgorithms.algorithms;
+	const unsigned int pkAlgorithmCount = hasPkAlgorithms ? info->pk_algos_length : connectionContext->clientPkAlgorithms.count;
 
-			if(!entry.first.empty() && entry.first.at(0) != '*') {
-				logger.trace << "Certificate for hostname \"" << entry.first << "\" is a perfect match\n";
-				foundHostname = &entry.first;
-				*pkey = entry.second.key;
-				*pcertLength = 1;
-				*pcert = &entry.second.pcrt;
-				return 0;
-			}
-			else if(foundHostname != nullptr && entry.first.size() < foundHostname->size()) {
-				logger.trace << "Skip certificate for hostname \"" << entry.first << "\" because better match has been found already.\n";
-				continue;
-			}
+	MHD4ESL_LOG(logger, trace) << "Search certificate for hostname \"" << hostname << "\".\n";
+	const CertificateStore& certificateStore = *connectionContext->certificateStore;
+	const CertificateStore::Certificate* certificate = certificateStore.find(hostname, pkAlgorithms, pkAlgorithmCount);
 
-			logger.trace << "Use certificate for hostname \"" << entry.first << "\"\n";
-			foundHostname = &entry.first;
-			*pkey = entry.second.key;
-			*pcertLength = 1;
-			*pcert = &entry.second.pcrt;
-		}
+	if(certificate == nullptr) {
+		Metrics::get().tlsCertificateNotFound.fetch_add(1, std::memory_order_relaxed);
+		MHD4ESL_LOG(logger, warn) << "No certificate found for hostname=\"" << hostname << "\"\n";
+		return -1;
 	}
 
-	if(foundHostname == nullptr) {
-		logger.warn << "No certificate found for hostname=\"" << hostname << "\"\n";
-		return -1;
+	// certificates are kept for the grace period of the store after they have been replaced
+	*pkey = certificate->key;
+	*pcertLength = static_cast<unsigned int>(certificate->chain.size());
+	*pcert = const_cast<gnutls_pcert_st*>(certificate->chain.data());
+	*flags = 0;
+
+	// OCSP responses are kept for the grace period of the store after they have been replaced as well
+	const CertificateStore::OcspResponse* ocspResponse = certificateStore.getOcspResponse(*certificate);
+	if(ocspResponse) {
+		Metrics::get().tlsOcspStapled.fetch_add(1, std::memory_order_relaxed);
+		*ocsp = const_cast<gnutls_ocsp_data_st*>(&ocspResponse->data);
+		*ocspLength = 1;
+	}
+	else {
+		*ocsp = nullptr;
+		*ocspLength = 0;
 	}
 
-	logger.trace << "Certificate found for hostname \"" << *foundHostname << "\".\n";
+	MHD4ESL_LOG(logger, trace) << "Certificate found for hostname \"" << certificate->hostname << "\".\n";
 	return 0;
 }
 
@@ -181,18 +213,55 @@ int mhdSniCallback(gnutls_session_t session,
 
 Socket::Socket(const esl::com::http::server::MHDSocket::Settings& aSettings)
 : settings(aSettings)
-{ }
+{
+	if(settings.https) {
+		// replaced certificates are kept as long as a handshake might take
+		certificateStore.reset(new CertificateStore(settings.certificates, settings.ocspProvider, settings.connectionTimeout));
+
+		tlsPriorities = getTlsPriorities(settings.tlsPriorities, settings.tlsEcdheAead);
+		if(!tlsPriorities.empty()) {
+			// MHD does not tell why it cannot start
+			gnutls_priority_t priorityCache;
+			const char* errorPos = nullptr;
+			int rc = gnutls_priority_init(&priorityCache, tlsPriorities.c_str(), &errorPos);
+			if(rc < 0) {
+				throw esl::system::Stacktrace::add(std::runtime_error("Invalid TLS priorities \"" + tlsPriorities + "\" at \"" + (errorPos ? errorPos : "") + "\": " + gnutls_strerror(rc)));
+			}
+			gnutls_priority_deinit(priorityCache);
+		}
+
+		if(settings.tlsClientAuth) {
+			clientCertificateCache.reset(new ClientCertificateCache(settings.tlsClientCacheSize, std::chrono::seconds(settings.tlsClientCacheTtl)));
+		}
+	}
+
+	statusCodeResponses.reset(new StatusCodeResponses(settings.skipStatusCodeMessages));
+
+	if(!settings.traceFile.empty()) {
+		traceExporter.reset(new TraceExporter(settings.traceFile, 65536));
+	}
+
+	if(!settings.trustedProxies.empty()) {
+		trustedProxies.reset(new TrustedProxies(settings.trustedProxies));
+	}
+
+	connectionLimit = settings.connectionLimit;
+	perIpConnectionLimit = settings.perIpConnectionLimit;
+	connectionTimeout = settings.connectionTimeout;
+}
 
 Socket::~Socket() {
 	if (daemonPtr != nullptr) {
 		logger.debug << "Stopping HTTP socket at port " << settings.port << std::endl;
-		MHD_Daemon* d = static_cast<MHD_Daemon*>(daemonPtr);
-		MHD_stop_daemon (d);
+		stopDaemon();
 		daemonPtr = nullptr;
 	}
 }
 
 void Socket::listen(const esl::com::http::server::RequestHandler& requestHandler) {
+	if(settings.externalLoop) {
+		throw esl::system::Stacktrace::add(std::runtime_error("HTTP socket (port=" + std::to_string(settings.port) + ") uses an external loop, it cannot listen blocking."));
+	}
 	listen(requestHandler, nullptr);
 	wait(0);
 }
@@ -204,54 +273,173 @@ void Socket::listen(const esl::com::http::server::RequestHandler& aRequestHandle
 
 	requestHandler = &aRequestHandler;
 
+	if(!settings.loggingLevel.empty() && !Logging::setLevel(Logging::toLevel(settings.loggingLevel), this)) {
+		throw esl::system::Stacktrace::add(std::runtime_error("HTTP socket (port=" + std::to_string(settings.port) + "): logging level has been set by another socket already."));
+	}
+
 	unsigned int flags = 0;
+	unsigned int threadPoolSize = 0;
+
+	if(settings.externalLoop) {
+#ifdef __linux__
+		// connections are polled by MHD_run of the application thread
+		flags |= MHD_USE_EPOLL;
+#else
+		Logging::releaseLevel(this);
+		throw esl::system::Stacktrace::add(std::runtime_error("HTTP socket (port=" + std::to_string(settings.port) + "): external loop is only available on Linux."));
+#endif
+	}
+	else {
+		if(settings.numThreads == 0) {
+			flags |= MHD_USE_THREAD_PER_CONNECTION;
+		}
+		else {
+			threadPoolSize = settings.numThreads;
+		}
+
+		flags |= MHD_USE_SELECT_INTERNALLY;
+		// flags |= MHD_USE_POLL_INTERNALLY;
+	}
 
-	if(settings.numThreads == 0) {
-		flags |= MHD_USE_THREAD_PER_CONNECTION;
+	// suspend/resume is not available for thread per connection
+	suspendable = settings.externalLoop || settings.numThreads > 0;
+	if(suspendable) {
+		flags |= MHD_USE_SUSPEND_RESUME;
+		if(settings.handlerThreads > 0) {
+			executor.reset(new Executor(settings.handlerThreads));
+		}
+	}
+	eventStreamRegistry.reset(new EventStreamRegistry(suspendable));
+	if(suspendable) {
+		streamNotifierRegistry.reset(new StreamNotifierRegistry);
 	}
 
-	flags |= MHD_USE_SELECT_INTERNALLY;
-	// flags |= MHD_USE_POLL_INTERNALLY;
+	// without TLS MHD sends files with sendfile
+	if(settings.https && settings.fileReadAhead) {
+		fileReadAhead.reset(new FileReadAhead(settings.fileReadAheadThreads));
+	}
 
-	// flags |= MHD_USE_SUSPEND_RESUME;
+	// connections can be upgraded to WebSockets
+	flags |= MHD_ALLOW_UPGRADE;
+	webSocketReactor.reset(new WebSocketReactor);
+
+	// connections are accepted by ProxyProtocolListener and added by MHD_add_connection
+	if(settings.proxyProtocol) {
+		flags |= MHD_USE_NO_LISTEN_SOCKET | MHD_USE_ITC;
+	}
 
 #ifdef MHD4ESL_LOGGING_LEVEL_DEBUG
     flags |= MHD_USE_DEBUG;
 #endif
 
+	// with runtime limits MHD only enforces the hard connection limit
+	MHD_AcceptPolicyCallback acceptPolicy = nullptr;
+	unsigned int mhdConnectionLimit = settings.connectionLimit;
+	unsigned int mhdPerIpConnectionLimit = settings.perIpConnectionLimit;
+	if(settings.runtimeLimits) {
+		acceptPolicy = &mhdAcceptPolicy;
+		if(settings.maxConnectionLimit > 0) {
+			mhdConnectionLimit = settings.maxConnectionLimit;
+		}
+		mhdPerIpConnectionLimit = 0;
+	}
+
 	if(settings.https) {
+		try {
+			certificateStore->reload();
+
+			if(clientCertificateCache) {
+				std::ifstream file(settings.tlsClientCa, std::ios::in | std::ios::binary);
+				if(!file) {
+					throw esl::system::Stacktrace::add(std::runtime_error("Cannot open file \"" + settings.tlsClientCa + "\""));
+				}
+				std::ostringstream content;
+				content << file.rdbuf();
+				clientCa = content.str();
+			}
+		}
+		catch(...) {
+			executor.reset();
+			fileReadAhead.reset();
+			webSocketReactor.reset();
+			eventStreamRegistry.reset();
+			streamNotifierRegistry.reset();
+			Logging::releaseLevel(this);
+			throw;
+		}
+		certificateStore->startWatcher(settings.certificateReloadInterval, settings.ocspRefreshInterval);
+
+		// optional TLS options
+		std::vector<MHD_OptionItem> tlsOptions;
+		if(!tlsPriorities.empty()) {
+			tlsOptions.push_back(MHD_OptionItem{MHD_OPTION_HTTPS_PRIORITIES, 0, const_cast<char*>(tlsPriorities.c_str())});
+		}
+		if(clientCertificateCache) {
+			// MHD requests a client certificate if there are trusted CAs, the handshake succeeds without one
+			tlsOptions.push_back(MHD_OptionItem{MHD_OPTION_HTTPS_MEM_TRUST, 0, const_cast<char*>(clientCa.c_str())});
+		}
+		tlsOptions.push_back(MHD_OptionItem{MHD_OPTION_END, 0, nullptr});
+
 		std::lock_guard<std::mutex> lock(waitNotifyMutex);
 
 	    flags |= MHD_USE_SSL;
-		daemonPtr = MHD_start_daemon(flags, settings.port, 0, 0, mhdAcceptHandler, this,
-				MHD_OPTION_NOTIFY_COMPLETED, &mhdRequestCompletedHandler, nullptr,
-				MHD_OPTION_HTTPS_CERT_CALLBACK, &mhdSniCallback,
+		daemonPtr = MHD_start_daemon(flags, settings.port, acceptPolicy, this, mhdAcceptHandler, this,
+				MHD_OPTION_NOTIFY_COMPLETED, &mhdRequestCompletedHandler, this,
+				MHD_OPTION_NOTIFY_CONNECTION, &mhdConnectionNotifyHandler, this,
+				MHD_OPTION_HTTPS_CERT_CALLBACK2, &mhdSniCallback,
+				MHD_OPTION_ARRAY, tlsOptions.data(),
 
-				MHD_OPTION_PER_IP_CONNECTION_LIMIT, (unsigned int) settings.perIpConnectionLimit,
+				MHD_OPTION_PER_IP_CONNECTION_LIMIT, mhdPerIpConnectionLimit,
 				MHD_OPTION_CONNECTION_TIMEOUT, (unsigned int) settings.connectionTimeout,
-				MHD_OPTION_THREAD_POOL_SIZE, (unsigned int) settings.numThreads,
-				MHD_OPTION_CONNECTION_LIMIT, (unsigned int) settings.connectionLimit,
+				MHD_OPTION_THREAD_POOL_SIZE, threadPoolSize,
+				MHD_OPTION_CONNECTION_LIMIT, mhdConnectionLimit,
+				MHD_OPTION_CONNECTION_MEMORY_LIMIT, (size_t) settings.connectionMemoryLimit,
 				MHD_OPTION_END);
 	}
 	else {
 		std::lock_guard<std::mutex> lock(waitNotifyMutex);
 
-		daemonPtr = MHD_start_daemon(flags, settings.port, 0, 0, mhdAcceptHandler, this,
-				MHD_OPTION_NOTIFY_COMPLETED, &mhdRequestCompletedHandler, nullptr,
+		daemonPtr = MHD_start_daemon(flags, settings.port, acceptPolicy, this, mhdAcceptHandler, this,
+				MHD_OPTION_NOTIFY_COMPLETED, &mhdRequestCompletedHandler, this,
+				MHD_OPTION_NOTIFY_CONNECTION, &mhdConnectionNotifyHandler, this,
 
-				MHD_OPTION_PER_IP_CONNECTION_LIMIT, (unsigned int) settings.perIpConnectionLimit,
+				MHD_OPTION_PER_IP_CONNECTION_LIMIT, mhdPerIpConnectionLimit,
 				MHD_OPTION_CONNECTION_TIMEOUT, (unsigned int) settings.connectionTimeout,
-				MHD_OPTION_THREAD_POOL_SIZE, (unsigned int) settings.numThreads,
-				MHD_OPTION_CONNECTION_LIMIT, (unsigned int) settings.connectionLimit,
+				MHD_OPTION_THREAD_POOL_SIZE, threadPoolSize,
+				MHD_OPTION_CONNECTION_LIMIT, mhdConnectionLimit,
+				MHD_OPTION_CONNECTION_MEMORY_LIMIT, (size_t) settings.connectionMemoryLimit,
 				MHD_OPTION_END);
 	}
 
 	waitCondVar.notify_all();
 
 	if(daemonPtr == nullptr) {
+		executor.reset();
+		fileReadAhead.reset();
+		webSocketReactor.reset();
+		eventStreamRegistry.reset();
+		streamNotifierRegistry.reset();
+		Logging::releaseLevel(this);
 		throw esl::system::Stacktrace::add(std::runtime_error("Couldn't start HTTP socket at port " + std::to_string(settings.port) + ". Maybe there is already a socket listening on this port."));
 	}
 
+	if(settings.proxyProtocol) {
+		try {
+			proxyProtocolListener.reset(new ProxyProtocolListener(settings.port, trustedProxies.get(), settings.proxyProtocolTimeout));
+			proxyProtocolListener->start(*static_cast<MHD_Daemon*>(daemonPtr));
+		}
+		catch(...) {
+			proxyProtocolListener.reset();
+			stopDaemon();
+			{
+				std::lock_guard<std::mutex> lock(waitNotifyMutex);
+				daemonPtr = nullptr;
+			}
+			waitCondVar.notify_all();
+			throw;
+		}
+	}
+
 	onReleasedHandler = aOnReleasedHandler;
 	logger.debug << "HTTP socket started at port " << settings.port << std::endl;
 }
@@ -263,7 +451,7 @@ void Socket::release() {
 	}
 
 	logger.debug << "Releasing HTTP socket at port " << settings.port << " ..." << std::endl;
-	MHD_stop_daemon(static_cast<MHD_Daemon *>(daemonPtr));
+	stopDaemon();
 	{
 		std::lock_guard<std::mutex> lock(waitNotifyMutex);
 		daemonPtr = nullptr;
@@ -275,6 +463,88 @@ void Socket::release() {
 	waitCondVar.notify_all();
 }
 
+void Socket::reloadCertificates() {
+	if(!certificateStore) {
+		throw esl::system::Stacktrace::add(std::runtime_error("HTTP socket (port=" + std::to_string(settings.port) + ") does not use TLS."));
+	}
+	certificateStore->reload();
+}
+
+int Socket::getEventFd() const {
+	const MHD_DaemonInfo* daemonInfo = MHD_get_daemon_info(static_cast<MHD_Daemon*>(getExternalLoopDaemon()), MHD_DAEMON_INFO_EPOLL_FD);
+	if(daemonInfo == nullptr) {
+		throw esl::system::Stacktrace::add(std::runtime_error("HTTP socket (port=" + std::to_string(settings.port) + ") has no epoll file descriptor."));
+	}
+	return daemonInfo->epoll_fd;
+}
+
+void Socket::run() {
+	if(MHD_run(static_cast<MHD_Daemon*>(getExternalLoopDaemon())) != MHD_YES) {
+		throw esl::system::Stacktrace::add(std::runtime_error("HTTP socket (port=" + std::to_string(settings.port) + ") failed to process its events."));
+	}
+}
+
+long Socket::getTimeout() const {
+	MHD_UNSIGNED_LONG_LONG timeout = 0;
+	if(MHD_get_timeout(static_cast<MHD_Daemon*>(getExternalLoopDaemon()), &timeout) != MHD_YES) {
+		return -1;
+	}
+	if(timeout > static_cast<MHD_UNSIGNED_LONG_LONG>(std::numeric_limits<long>::max())) {
+		return std::numeric_limits<long>::max();
+	}
+	return static_cast<long>(timeout);
+}
+
+void* Socket::getExternalLoopDaemon() const {
+	if(!settings.externalLoop) {
+		throw esl::system::Stacktrace::add(std::runtime_error("HTTP socket (port=" + std::to_string(settings.port) + ") does not use an external loop."));
+	}
+	if(daemonPtr == nullptr) {
+		throw esl::system::Stacktrace::add(std::runtime_error("HTTP socket (port=" + std::to_string(settings.port) + ") is not listening."));
+	}
+	return daemonPtr;
+}
+
+esl::com::http::server::MHDSocket::Limits Socket::getLimits() const {
+	esl::com::http::server::MHDSocket::Limits limits;
+	limits.connectionLimit = connectionLimit.load();
+	limits.perIpConnectionLimit = perIpConnectionLimit.load();
+	limits.connectionTimeout = connectionTimeout.load();
+	return limits;
+}
+
+void Socket::setLimits(const esl::com::http::server::MHDSocket::Limits& limits) {
+	if(!settings.runtimeLimits) {
+		throw esl::system::Stacktrace::add(std::runtime_error("HTTP socket (port=" + std::to_string(settings.port) + ") does not use runtime limits."));
+	}
+
+	unsigned int hardConnectionLimit = settings.maxConnectionLimit > 0 ? settings.maxConnectionLimit : settings.connectionLimit;
+	if(limits.connectionLimit > hardConnectionLimit) {
+		throw esl::system::Stacktrace::add(std::runtime_error("HTTP socket (port=" + std::to_string(settings.port) + "): connection limit "
+				+ std::to_string(limits.connectionLimit) + " exceeds the maximum connection limit " + std::to_string(hardConnectionLimit) + "."));
+	}
+
+	connectionLimit = limits.connectionLimit;
+	perIpConnectionLimit = limits.perIpConnectionLimit;
+	connectionTimeout = limits.connectionTimeout;
+	if(certificateStore) {
+		certificateStore->setConnectionTimeout(limits.connectionTimeout);
+	}
+	logger.info << "Limits of HTTP socket at port " << settings.port << " changed: connection limit " << limits.connectionLimit
+			<< ", per IP connection limit " << limits.perIpConnectionLimit << ", connection timeout " << limits.connectionTimeout << "\n";
+}
+
+std::string Socket::getTlsPriorities(const std::string& tlsPriorities, bool tlsEcdheAead) {
+	if(!tlsEcdheAead) {
+		return tlsPriorities;
+	}
+
+	return (tlsPriorities.empty() ? std::string("NORMAL") : tlsPriorities)
+			+ ":-KX-ALL:+ECDHE-ECDSA:+ECDHE-RSA"
+			":-GROUP-ALL:+GROUP-X25519:+GROUP-SECP256R1:+GROUP-SECP384R1"
+			":-CIPHER-ALL:+AES-128-GCM:+AES-256-GCM:+CHACHA20-POLY1305";
+}
+
 bool Socket::wait(std::uint32_t ms) {
 	std::unique_lock<std::mutex> waitNotifyLock(waitNotifyMutex);
 
@@ -291,6 +561,59 @@ bool Socket::wait(std::uint32_t ms) {
 	}
 }
 
+void Socket::mhdRequestCompletedHandler(void* cls,
+        MHD_Connection* mhdConnection,
+        void** connectionSpecificDataPtr,
+        enum MHD_RequestTerminationCode toe) noexcept
+{
+	RequestContext** requestContext = reinterpret_cast<RequestContext**>(connectionSpecificDataPtr);
+
+    if(*requestContext == nullptr) {
+        logger.error << "Request completed, but there is no RequestContext to delete\n";
+        return;
+    }
+
+    ConnectionContext* connectionContext = (*requestContext)->connectionContext;
+    if(connectionContext && connectionContext->state.load(std::memory_order_relaxed) != static_cast<int>(ConnectionContext::State::upgraded)) {
+    	connectionContext->setState(ConnectionContext::State::waiting);
+    }
+
+    Socket* socket = static_cast<Socket*>(cls);
+    if(socket && (socket->settings.traceExporter || socket->traceExporter)) {
+    	(*requestContext)->timeline.requestCompleted = std::chrono::steady_clock::now();
+    	socket->exportTrace(**requestContext, toe == MHD_REQUEST_TERMINATED_COMPLETED_OK);
+    }
+
+    delete *requestContext;
+    *requestContext = nullptr;
+}
+
+MHD_Result Socket::mhdAcceptPolicy(void* cls, const sockaddr* address, socklen_t) noexcept {
+	Socket* socket = static_cast<Socket*>(cls);
+
+	// connections are counted when MHD has created them, so a burst of accepts might exceed the limit a little
+	unsigned int limit = socket->connectionLimit.load(std::memory_order_relaxed);
+	if(limit > 0 && socket->connectionCount.load(std::memory_order_relaxed) >= limit) {
+		Metrics::get().connectionsRejectedLimit.fetch_add(1, std::memory_order_relaxed);
+		return MHD_NO;
+	}
+
+	limit = socket->perIpConnectionLimit.load(std::memory_order_relaxed);
+	if(limit > 0 && address) {
+		esl::com::http::server::MHDRequest::Address clientAddress = Request::toAddress(address);
+		std::string key(reinterpret_cast<const char*>(clientAddress.bytes), clientAddress.getSize());
+
+		std::lock_guard<std::mutex> lock(socket->ipConnectionsMutex);
+		auto iter = socket->ipConnections.find(key);
+		if(iter != socket->ipConnections.end() && iter->second >= limit) {
+			Metrics::get().connectionsRejectedPerIpLimit.fetch_add(1, std::memory_order_relaxed);
+			return MHD_NO;
+		}
+	}
+
+	return MHD_YES;
+}
+
 MHD_Result Socket::mhdAcceptHandler(void* cls,
 		MHD_Connection* mhdConnection,
 		const char* url,
@@ -315,47 +638,513 @@ MHD_Result Socket::mhdAcceptHandler(void* cls,
 	if(*requestContext == nullptr) {
 		try {
 			*requestContext = new RequestContext(*mhdConnection, version, method, url, socket->usingTLS, socket->settings.port);
-			(*requestContext)->input = socket->requestHandler->accept(**requestContext);
-
-			if((*requestContext)->input && *uploadDataSize == 0) {
-				return MHD_YES;
-			}
-		}
-		catch(const esl::com::http::server::exception::StatusCode& e) {
-			esl::com::http::server::Response response(e.getStatusCode(), e.getMimeType());
-			(*requestContext)->getConnection().send(response, esl::io::output::String::create(e.what()));
-			return MHD_YES;
 		}
 		catch (const std::exception& e) {
 			logger.error << "std::exception::what(): " << e.what() << std::endl;
-
-			const esl::system::Stacktrace* stacktrace = esl::system::Stacktrace::get(e);
-			if(stacktrace) {
-				logger.error << "Stacktrace:\n";
-				stacktrace->dump(logger.error);
-			}
 			return MHD_NO;
 		}
 		catch (...) {
 			logger.error << "unknown exception" << std::endl;
 			return MHD_NO;
 		}
+
+		(*requestContext)->maxBodySize = socket->settings.maxBodySize;
+		if(socket->settings.autoETag) {
+			// a matching ETag is answered with status 304 for GET and HEAD only
+			const std::string& methodName = (*requestContext)->request.getMethodName();
+			if(methodName == MHD_HTTP_METHOD_GET || methodName == MHD_HTTP_METHOD_HEAD) {
+				(*requestContext)->connection.setAutoETag((*requestContext)->request.findHeader(MHD_HTTP_HEADER_IF_NONE_MATCH), socket->settings.autoETagStreamSize);
+			}
+		}
+		if(socket->settings.runtimeLimits) {
+			socket->updateConnectionTimeout(**requestContext);
+		}
+		if(socket->settings.introspection) {
+			socket->trackRequest(**requestContext);
+		}
+
+		unsigned short rejectStatusCode = socket->checkRequestLimits(**requestContext);
+		if(rejectStatusCode != 0) {
+			return socket->rejectRequest(**requestContext, rejectStatusCode) ? MHD_YES : MHD_NO;
+		}
+
+		if(socket->executor) {
+			socket->dispatchAccept(**requestContext);
+			return MHD_YES;
+		}
+
+		if(!socket->acceptRequest(**requestContext)) {
+			return MHD_NO;
+		}
+
+		if((*requestContext)->input && *uploadDataSize == 0) {
+			return MHD_YES;
+		}
+	}
+	else if((*requestContext)->rejected) {
+		// body data of a rejected request is discarded
+		*uploadDataSize = 0;
+		return MHD_YES;
+	}
+	else if((*requestContext)->acceptFailed) {
+		return MHD_NO;
 	}
 
 	socket->accessThreadInc();
-	bool rv = accept(**requestContext, uploadData, uploadDataSize);
+	bool rv = socket->accept(**requestContext, uploadData, uploadDataSize);
 	socket->accessThreadDec();
 	return rv ? MHD_YES : MHD_NO;
 }
 
+void Socket::mhdConnectionNotifyHandler(void* cls,
+		MHD_Connection* mhdConnection,
+		void** socketContext,
+		MHD_ConnectionNotificationCode toe) noexcept
+{
+	Socket* socket = static_cast<Socket*>(cls);
+
+	switch(toe) {
+	case MHD_CONNECTION_NOTIFY_STARTED: {
+		ConnectionContext* connectionContext = new (std::nothrow) ConnectionContext;
+		if(connectionContext == nullptr) {
+			return;
+		}
+
+		if(socket->trustedProxies) {
+			const MHD_ConnectionInfo* connectionInfo = MHD_get_connection_info(mhdConnection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+			if(connectionInfo && connectionInfo->client_addr
+					&& socket->trustedProxies->isTrusted(Request::toAddress(connectionInfo->client_addr))) {
+				connectionContext->trustedProxies = socket->trustedProxies.get();
+			}
+		}
+		connectionContext->webSocketReactor = socket->webSocketReactor.get();
+		connectionContext->eventStreamRegistry = socket->eventStreamRegistry.get();
+		connectionContext->streamNotifierRegistry = socket->streamNotifierRegistry.get();
+		connectionContext->certificateStore = socket->certificateStore.get();
+		if(socket->certificateStore && addTlsConnectionContext(*connectionContext, mhdConnection)) {
+			const MHD_ConnectionInfo* sessionInfo = MHD_get_connection_info(mhdConnection, MHD_CONNECTION_INFO_GNUTLS_SESSION);
+			if(sessionInfo && sessionInfo->tls_session) {
+				gnutls_handshake_set_hook_function(static_cast<gnutls_session_t>(sessionInfo->tls_session),
+						GNUTLS_HANDSHAKE_CLIENT_HELLO, GNUTLS_HOOK_PRE, mhdClientHelloHook);
+			}
+		}
+		connectionContext->clientCertificateCache = socket->clientCertificateCache.get();
+		connectionContext->fileReadAhead = socket->fileReadAhead.get();
+		connectionContext->suspendable = socket->suspendable;
+
+		if(socket->settings.runtimeLimits) {
+			socket->addLimitedConnection(*connectionContext, mhdConnection);
+		}
+
+		if(socket->settings.introspection) {
+			connectionContext->tracked = true;
+			connectionContext->mhdConnection = mhdConnection;
+			connectionContext->startTime = std::chrono::steady_clock::now();
+			connectionContext->setState(ConnectionContext::State::waiting);
+
+			std::lock_guard<std::mutex> lock(socket->connectionsMutex);
+			connectionContext->next = socket->connections;
+			if(socket->connections) {
+				socket->connections->prev = connectionContext;
+			}
+			socket->connections = connectionContext;
+		}
+
+		*socketContext = connectionContext;
+		break;
+	}
+	case MHD_CONNECTION_NOTIFY_CLOSED: {
+		ConnectionContext* connectionContext = static_cast<ConnectionContext*>(*socketContext);
+		if(connectionContext && connectionContext->tlsSocket >= 0) {
+			removeTlsConnectionContext(*connectionContext);
+		}
+		if(connectionContext && connectionContext->limited) {
+			socket->removeLimitedConnection(*connectionContext);
+		}
+		if(connectionContext && connectionContext->tracked) {
+			std::lock_guard<std::mutex> lock(socket->connectionsMutex);
+			if(connectionContext->prev) {
+				connectionContext->prev->next = connectionContext->next;
+			}
+			else {
+				socket->connections = connectionContext->next;
+			}
+			if(connectionContext->next) {
+				connectionContext->next->prev = connectionContext->prev;
+			}
+		}
+
+		delete connectionContext;
+		*socketContext = nullptr;
+		break;
+	}
+	}
+}
+
+void Socket::addLimitedConnection(ConnectionContext& connectionContext, MHD_Connection* mhdConnection) noexcept {
+	const MHD_ConnectionInfo* addressInfo = MHD_get_connection_info(mhdConnection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+	if(addressInfo && addressInfo->client_addr) {
+		esl::com::http::server::MHDRequest::Address clientAddress = Request::toAddress(addressInfo->client_addr);
+		try {
+			connectionContext.limitKey.assign(reinterpret_cast<const char*>(clientAddress.bytes), clientAddress.getSize());
+			std::lock_guard<std::mutex> lock(ipConnectionsMutex);
+			++ipConnections[connectionContext.limitKey];
+		}
+		catch(...) {
+			return;
+		}
+	}
+
+	connectionContext.limited = true;
+	connectionCount.fetch_add(1, std::memory_order_relaxed);
+
+	connectionContext.connectionTimeout = connectionTimeout.load(std::memory_order_relaxed);
+	if(connectionContext.connectionTimeout != settings.connectionTimeout) {
+		MHD_set_connection_option(mhdConnection, MHD_CONNECTION_OPTION_TIMEOUT, connectionContext.connectionTimeout);
+	}
+}
+
+void Socket::removeLimitedConnection(ConnectionContext& connectionContext) noexcept {
+	connectionCount.fetch_sub(1, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(ipConnectionsMutex);
+	auto iter = ipConnections.find(connectionContext.limitKey);
+	if(iter != ipConnections.end() && --iter->second == 0) {
+		ipConnections.erase(iter);
+	}
+}
+
+void Socket::updateConnectionTimeout(RequestContext& requestContext) noexcept {
+	unsigned int timeout = connectionTimeout.load(std::memory_order_relaxed);
+
+	const MHD_ConnectionInfo* socketContextInfo = MHD_get_connection_info(&requestContext.connection.mhdConnection, MHD_CONNECTION_INFO_SOCKET_CONTEXT);
+	ConnectionContext* connectionContext = socketContextInfo ? static_cast<ConnectionContext*>(socketContextInfo->socket_context) : nullptr;
+	if(connectionContext && connectionContext->limited && connectionContext->connectionTimeout != timeout) {
+		connectionContext->connectionTimeout = timeout;
+		MHD_set_connection_option(&requestContext.connection.mhdConnection, MHD_CONNECTION_OPTION_TIMEOUT, timeout);
+	}
+}
+
+void Socket::trackRequest(RequestContext& requestContext) noexcept {
+	const MHD_ConnectionInfo* socketContextInfo = MHD_get_connection_info(&requestContext.connection.mhdConnection, MHD_CONNECTION_INFO_SOCKET_CONTEXT);
+	ConnectionContext* connectionContext = socketContextInfo ? static_cast<ConnectionContext*>(socketContextInfo->socket_context) : nullptr;
+	if(connectionContext == nullptr || !connectionContext->tracked) {
+		return;
+	}
+
+	requestContext.connectionContext = connectionContext;
+	connectionContext->requests.fetch_add(1, std::memory_order_relaxed);
+	connectionContext->setState(ConnectionContext::State::handler);
+
+	// the handshake is completed when the first request has been received
+	if(settings.https && connectionContext->requests.load(std::memory_order_relaxed) == 1) {
+		const MHD_ConnectionInfo* sessionInfo = MHD_get_connection_info(&requestContext.connection.mhdConnection, MHD_CONNECTION_INFO_GNUTLS_SESSION);
+		if(sessionInfo && sessionInfo->tls_session) {
+			gnutls_session_t session = static_cast<gnutls_session_t>(sessionInfo->tls_session);
+			const char* protocol = gnutls_protocol_get_name(gnutls_protocol_get_version(session));
+			const char* cipher = gnutls_cipher_get_name(gnutls_cipher_get(session));
+
+			try {
+				std::lock_guard<std::mutex> lock(connectionsMutex);
+				connectionContext->tlsProtocol = protocol ? protocol : "";
+				connectionContext->tlsCipher = cipher ? cipher : "";
+			}
+			catch(...) {
+			}
+		}
+	}
+}
+
+esl::com::http::server::MHDSocket::Introspection Socket::getIntrospection() const {
+	esl::com::http::server::MHDSocket::Introspection introspection;
+
+	introspection.connectionLimit = settings.connectionLimit;
+	introspection.externalLoop = settings.externalLoop;
+	introspection.threadPerConnection = !settings.externalLoop && settings.numThreads == 0;
+	introspection.pollingThreads = settings.externalLoop ? 0 : settings.numThreads;
+	if(executor) {
+		introspection.handlerThreads = executor->getThreadCount();
+		introspection.pendingHandlerTasks = executor->getPendingTaskCount();
+	}
+	if(fileReadAhead) {
+		introspection.fileReadAhead = fileReadAhead->usesIoUring() ? "io_uring" : "threads";
+	}
+
+	std::lock_guard<std::mutex> lock(connectionsMutex);
+
+	if(daemonPtr == nullptr) {
+		return introspection;
+	}
+
+	const MHD_DaemonInfo* daemonInfo = MHD_get_daemon_info(static_cast<MHD_Daemon*>(daemonPtr), MHD_DAEMON_INFO_CURRENT_CONNECTIONS);
+	if(daemonInfo) {
+		introspection.currentConnections = daemonInfo->num_connections;
+	}
+
+	static const char* const stateNames[] = { "waiting", "handler", "uploading", "sending", "upgraded" };
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	// connections are removed from the list before they are destroyed, so they are valid while the list is locked
+	for(const ConnectionContext* connectionContext = connections; connectionContext; connectionContext = connectionContext->next) {
+		esl::com::http::server::MHDSocket::ConnectionInfo connectionInfo;
+
+		int state = connectionContext->state.load(std::memory_order_relaxed);
+		connectionInfo.state = (state >= 0 && state < 5) ? stateNames[state] : "";
+		connectionInfo.stateAge = now.time_since_epoch() - std::chrono::nanoseconds(connectionContext->stateTime.load(std::memory_order_relaxed));
+		connectionInfo.age = now - connectionContext->startTime;
+		connectionInfo.requests = connectionContext->requests.load(std::memory_order_relaxed);
+		connectionInfo.bodyBytesReceived = connectionContext->bodyBytesReceived.load(std::memory_order_relaxed);
+		connectionInfo.tlsProtocol = connectionContext->tlsProtocol;
+		connectionInfo.tlsCipher = connectionContext->tlsCipher;
+
+		const MHD_ConnectionInfo* addressInfo = MHD_get_connection_info(connectionContext->mhdConnection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+		if(addressInfo && addressInfo->client_addr) {
+			connectionInfo.remoteAddress = Request::toString(Request::toAddress(addressInfo->client_addr));
+			connectionInfo.remotePort = Request::toPort(addressInfo->client_addr);
+		}
+
+		introspection.connections.push_back(std::move(connectionInfo));
+	}
+
+	return introspection;
+}
+
+bool Socket::acceptRequest(RequestContext& requestContext) noexcept {
+	bool rv = acceptRequestHandler(requestContext);
+	requestContext.timeline.acceptReturned = std::chrono::steady_clock::now();
+	if(rv && requestContext.input && settings.smallBodySize > 0) {
+		collectSmallBody(requestContext);
+	}
+	return rv;
+}
+
+void Socket::collectSmallBody(RequestContext& requestContext) noexcept {
+	std::uint64_t contentLength;
+	if(!requestContext.request.getContentLength(contentLength) || contentLength == 0 || contentLength > settings.smallBodySize) {
+		return;
+	}
+
+	const MHD_ConnectionInfo* socketContextInfo = MHD_get_connection_info(&requestContext.connection.mhdConnection, MHD_CONNECTION_INFO_SOCKET_CONTEXT);
+	if(socketContextInfo == nullptr || socketContextInfo->socket_context == nullptr) {
+		return;
+	}
+
+	std::string& bodyBuffer = static_cast<ConnectionContext*>(socketContextInfo->socket_context)->bodyBuffer;
+	try {
+		bodyBuffer.clear();
+		bodyBuffer.reserve(static_cast<std::size_t>(contentLength));
+	}
+	catch(...) {
+		// the body is written as it arrives
+		return;
+	}
+	requestContext.smallBody = &bodyBuffer;
+	requestContext.smallBodyPos = 0;
+}
+
+bool Socket::acceptRequestHandler(RequestContext& requestContext) noexcept {
+	try {
+		requestContext.input = requestHandler->accept(requestContext);
+		return true;
+	}
+	catch(const esl::com::http::server::exception::StatusCode& e) {
+		if(e.getStatusCode() < Metrics::maxStatusCode) {
+			Metrics::get().statusCodeExceptions[e.getStatusCode()].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		const std::shared_ptr<MHD_Response>* mhdResponse = statusCodeResponses->find(e);
+		if(mhdResponse) {
+			Metrics::get().statusCodeResponsesShared.fetch_add(1, std::memory_order_relaxed);
+			return requestContext.connection.sendShared(e.getStatusCode(), *mhdResponse);
+		}
+
+		try {
+			esl::com::http::server::Response response(e.getStatusCode(), e.getMimeType());
+			requestContext.getConnection().send(response, esl::io::output::String::create(e.what()));
+			return true;
+		}
+		catch (...) {
+			logger.error << "unknown exception" << std::endl;
+		}
+	}
+	catch (const std::exception& e) {
+		logger.error << "std::exception::what(): " << e.what() << std::endl;
+
+		const esl::system::Stacktrace* stacktrace = esl::system::Stacktrace::get(e);
+		if(stacktrace) {
+			logger.error << "Stacktrace:\n";
+			stacktrace->dump(logger.error);
+		}
+	}
+	catch (...) {
+		logger.error << "unknown exception" << std::endl;
+	}
+
+	return false;
+}
+
+unsigned short Socket::checkRequestLimits(RequestContext& requestContext) noexcept {
+	MHD_Connection* mhdConnection = &requestContext.connection.mhdConnection;
+
+	if(settings.tlsClientAuthRequired && !requestContext.request.getClientCertificate()) {
+		Metrics::get().tlsClientRejected.fetch_add(1, std::memory_order_relaxed);
+		return 403;
+	}
+
+	if(settings.maxHeaderCount > 0
+			&& MHD_get_connection_values(mhdConnection, MHD_HEADER_KIND, nullptr, nullptr) > static_cast<int>(settings.maxHeaderCount)) {
+		Metrics::get().requestsRejectedHeaders.fetch_add(1, std::memory_order_relaxed);
+		return 431;
+	}
+
+	if(settings.maxHeaderSize > 0) {
+		const MHD_ConnectionInfo* headerSizeInfo = MHD_get_connection_info(mhdConnection, MHD_CONNECTION_INFO_REQUEST_HEADER_SIZE);
+		if(headerSizeInfo && headerSizeInfo->header_size > settings.maxHeaderSize) {
+			Metrics::get().requestsRejectedHeaders.fetch_add(1, std::memory_order_relaxed);
+			return 431;
+		}
+	}
+
+	// "100-continue" is the only expectation defined
+	const char* expect = requestContext.request.findHeader(MHD_HTTP_HEADER_EXPECT);
+	if(expect) {
+		static const char continueExpectation[] = "100-continue";
+		std::size_t i = 0;
+		for(; continueExpectation[i] != 0 && std::tolower(static_cast<unsigned char>(expect[i])) == continueExpectation[i]; ++i) {
+		}
+		if(continueExpectation[i] != 0 || expect[i] != 0) {
+			Metrics::get().requestsRejectedExpectation.fetch_add(1, std::memory_order_relaxed);
+			return 417;
+		}
+	}
+
+	std::uint64_t contentLength;
+	if(requestContext.maxBodySize > 0 && requestContext.request.getContentLength(contentLength) && contentLength > requestContext.maxBodySize) {
+		Metrics::get().requestsRejectedBodySize.fetch_add(1, std::memory_order_relaxed);
+		return 413;
+	}
+
+	return 0;
+}
+
+bool Socket::rejectRequest(RequestContext& requestContext, unsigned short statusCode) noexcept {
+	requestContext.rejected = true;
+
+	const std::shared_ptr<MHD_Response>* mhdResponse = statusCodeResponses->find(statusCode);
+	if(mhdResponse == nullptr || !requestContext.connection.sendShared(statusCode, *mhdResponse)) {
+		return false;
+	}
+
+	// MHD neither sends "100 Continue" nor reads the body, if a response has been queued before
+	bool rv = requestContext.connection.sendQueue();
+	requestContext.timeline.responseQueued = std::chrono::steady_clock::now();
+	requestContext.setConnectionState(ConnectionContext::State::sending);
+	return rv;
+}
+
+void Socket::dispatchAccept(RequestContext& requestContext) noexcept {
+	MHD_Connection* mhdConnection = &requestContext.connection.mhdConnection;
+
+	// MHD calls mhdAcceptHandler again after the connection has been resumed
+	MHD_suspend_connection(mhdConnection);
+	try {
+		executor->submit([this, &requestContext, mhdConnection]() {
+			requestContext.acceptFailed = !acceptRequest(requestContext);
+			MHD_resume_connection(mhdConnection);
+		});
+	}
+	catch(...) {
+		requestContext.acceptFailed = true;
+		MHD_resume_connection(mhdConnection);
+	}
+}
+
+void Socket::dispatchWrite(RequestContext& requestContext, const char* uploadData, std::size_t uploadDataSize) noexcept {
+	MHD_Connection* mhdConnection = &requestContext.connection.mhdConnection;
+
+	/* Upload data is not consumed while the connection is suspended,
+	 * so MHD calls mhdAcceptHandler with the same data again after resuming. */
+	MHD_suspend_connection(mhdConnection);
+	try {
+		executor->submit([&requestContext, mhdConnection, uploadData, uploadDataSize]() {
+			try {
+				requestContext.writeResult = requestContext.input.getWriter().write(uploadData, uploadDataSize);
+			}
+			catch(...) {
+				requestContext.writeException = std::current_exception();
+			}
+			requestContext.writeCompleted = true;
+			MHD_resume_connection(mhdConnection);
+		});
+	}
+	catch(...) {
+		requestContext.writeException = std::current_exception();
+		requestContext.writeCompleted = true;
+		MHD_resume_connection(mhdConnection);
+	}
+}
+
+void Socket::stopDaemon() noexcept {
+	MHD_Daemon* daemon = static_cast<MHD_Daemon*>(daemonPtr);
+
+	// no connections must be added anymore while the daemon is stopping
+	proxyProtocolListener.reset();
+
+	if(certificateStore) {
+		certificateStore->stopWatcher();
+	}
+
+	// upgraded connections must be closed and suspended event streams and streams resumed before MHD_stop_daemon is called
+	if(webSocketReactor) {
+		webSocketReactor->stop();
+	}
+	if(eventStreamRegistry) {
+		eventStreamRegistry->stop();
+	}
+	if(streamNotifierRegistry) {
+		streamNotifierRegistry->stop();
+	}
+
+	// connections waiting for a read are resumed, further reads are done by the threads of MHD
+	if(fileReadAhead) {
+		fileReadAhead->stop();
+	}
+
+	if(executor) {
+		/* suspended connections must be resumed before MHD_stop_daemon is called.
+		 * So we stop accepting new connections and complete all dispatched calls first. */
+		MHD_socket listenSocket = MHD_quiesce_daemon(daemon);
+		executor->stop();
+		MHD_stop_daemon(daemon);
+		if(listenSocket >= 0) {
+#ifdef _WIN32
+			closesocket(listenSocket);
+#else
+			close(listenSocket);
+#endif
+		}
+		executor.reset();
+	}
+	else {
+		MHD_stop_daemon(daemon);
+	}
+
+	webSocketReactor.reset();
+	eventStreamRegistry.reset();
+	streamNotifierRegistry.reset();
+	fileReadAhead.reset();
+
+	Logging::releaseLevel(this);
+}
+
 bool Socket::accept(RequestContext& requestContext, const char* uploadData, std::size_t* uploadDataSize) noexcept {
 	try {
 		if(!requestContext.input) {
-			logger.debug << "No input\n";
+			MHD4ESL_LOG(logger, debug) << "No input\n";
 			*uploadDataSize = 0;
 
 			if(requestContext.connection.isResponseQueueEmpty()) {
-				logger.debug << "Nothing in response queue -> push 404 page into respone queue\n";
+				MHD4ESL_LOG(logger, debug) << "Nothing in response queue -> push 404 page into respone queue\n";
 				esl::com::http::server::Response response(404, esl::utility::MIME::Type::textHtml);
 				requestContext.connection.send(response, PAGE_404.data(), PAGE_404.size());
 			}
@@ -363,34 +1152,94 @@ bool Socket::accept(RequestContext& requestContext, const char* uploadData, std:
 			// send response queue, so this method will not be called again
 			if(!requestContext.connection.hasResponseSent()) {
 				requestContext.connection.sendQueue();
+				requestContext.timeline.responseQueued = std::chrono::steady_clock::now();
+				requestContext.setConnectionState(ConnectionContext::State::sending);
 			}
 
 			return true;
 		}
 
 		bool lastCall = (*uploadDataSize == 0);
-		std::size_t size = requestContext.input.getWriter().write(uploadData, *uploadDataSize);
+		std::size_t size = 0;
+
+		// bodies without "Content-Length" are checked while they are read
+		if(requestContext.maxBodySize > 0 && *uploadDataSize > requestContext.maxBodySize - requestContext.bodySize) {
+			Metrics::get().requestsRejectedBodySize.fetch_add(1, std::memory_order_relaxed);
+			*uploadDataSize = 0;
+
+			// a queued response of the request handler expects the complete body
+			if(!requestContext.connection.isResponseQueueEmpty()) {
+				return false;
+			}
+			return rejectRequest(requestContext, 413);
+		}
+
+		if(requestContext.smallBody) {
+			if(!lastCall) {
+				// upload data is consumed now and given to the writer after the last call
+				requestContext.smallBody->append(uploadData, *uploadDataSize);
+				requestContext.bodySize += *uploadDataSize;
+				requestContext.setConnectionState(ConnectionContext::State::uploading);
+				if(requestContext.connectionContext) {
+					requestContext.connectionContext->addBodyBytesReceived(*uploadDataSize);
+				}
+				*uploadDataSize = 0;
+				return true;
+			}
+			if(!flushSmallBody(requestContext, size)) {
+				return true;
+			}
+		}
+
+		// size is npos already if the writer has not accepted the complete collected body
+		if(size != esl::io::Writer::npos) {
+			if(executor) {
+				if(!requestContext.writeCompleted) {
+					dispatchWrite(requestContext, uploadData, *uploadDataSize);
+					return true;
+				}
+
+				requestContext.writeCompleted = false;
+				if(requestContext.writeException) {
+					std::exception_ptr writeException = requestContext.writeException;
+					requestContext.writeException = nullptr;
+					std::rethrow_exception(writeException);
+				}
+				size = requestContext.writeResult;
+			}
+			else {
+				size = requestContext.input.getWriter().write(uploadData, *uploadDataSize);
+			}
+		}
 
 		if(lastCall || size == esl::io::Writer::npos) {
 			*uploadDataSize = 0;
+			requestContext.timeline.uploadCompleted = std::chrono::steady_clock::now();
 
 			//logger.debug << "Reset input object\n";
 			//requestContext.input = esl::utility::io::Input();
 
 			// drop connection
 			if(requestContext.connection.isResponseQueueEmpty()) {
-				logger.debug << "There was no response sent -> drop connection\n";
+				MHD4ESL_LOG(logger, debug) << "There was no response sent -> drop connection\n";
 				return false;
 			}
 
 			// send response queue, so this method will not be called again
 			if(!requestContext.connection.hasResponseSent()) {
 				requestContext.connection.sendQueue();
+				requestContext.timeline.responseQueued = std::chrono::steady_clock::now();
+				requestContext.setConnectionState(ConnectionContext::State::sending);
 			}
 			return true;
 		}
 
 		*uploadDataSize -= size;
+		requestContext.bodySize += size;
+		requestContext.setConnectionState(ConnectionContext::State::uploading);
+		if(requestContext.connectionContext) {
+			requestContext.connectionContext->addBodyBytesReceived(size);
+		}
 
 		return true;
 	}
@@ -415,11 +1264,97 @@ bool Socket::accept(RequestContext& requestContext, const char* uploadData, std:
 	// send response queue, so this method will not be called again
 	if(!requestContext.connection.hasResponseSent()) {
 		requestContext.connection.sendQueue();
+		requestContext.timeline.responseQueued = std::chrono::steady_clock::now();
+		requestContext.setConnectionState(ConnectionContext::State::sending);
+	}
+
+	return true;
+}
+
+bool Socket::flushSmallBody(RequestContext& requestContext, std::size_t& size) {
+	std::string& body = *requestContext.smallBody;
+
+	while(requestContext.smallBodyPos < body.size()) {
+		if(executor) {
+			if(!requestContext.writeCompleted) {
+				dispatchWrite(requestContext, body.data() + requestContext.smallBodyPos, body.size() - requestContext.smallBodyPos);
+				return false;
+			}
+
+			requestContext.writeCompleted = false;
+			if(requestContext.writeException) {
+				std::exception_ptr writeException = requestContext.writeException;
+				requestContext.writeException = nullptr;
+				std::rethrow_exception(writeException);
+			}
+			size = requestContext.writeResult;
+		}
+		else {
+			size = requestContext.input.getWriter().write(body.data() + requestContext.smallBodyPos, body.size() - requestContext.smallBodyPos);
+		}
+
+		if(size == esl::io::Writer::npos) {
+			break;
+		}
+		requestContext.smallBodyPos += size;
 	}
 
+	if(size != esl::io::Writer::npos) {
+		size = 0;
+	}
+	body.clear();
+	requestContext.smallBody = nullptr;
 	return true;
 }
 
+void Socket::exportTrace(RequestContext& requestContext, bool completed) noexcept {
+	try {
+		esl::com::http::server::MHDSocket::Trace trace;
+
+		if(requestContext.traceContext) {
+			trace.traceId = requestContext.traceContext->getTraceId();
+			trace.spanId = requestContext.traceContext->getSpanId();
+			trace.parentSpanId = requestContext.traceContext->getParentSpanId();
+			trace.traceFlags = requestContext.traceContext->getTraceFlags();
+		}
+		else {
+			trace.traceId = Request::createTraceId(16);
+			trace.spanId = Request::createTraceId(8);
+		}
+
+		trace.method = requestContext.request.getMethodName();
+		trace.path = requestContext.request.getPath();
+		const MHD_ConnectionInfo* statusInfo = MHD_get_connection_info(&requestContext.connection.mhdConnection, MHD_CONNECTION_INFO_HTTP_STATUS);
+		if(statusInfo) {
+			trace.statusCode = static_cast<unsigned short>(statusInfo->http_status);
+		}
+		trace.completed = completed;
+
+		trace.headersReceived = requestContext.timeline.headersReceived;
+		trace.acceptReturned = requestContext.timeline.acceptReturned;
+		trace.uploadCompleted = requestContext.timeline.uploadCompleted;
+		trace.responseQueued = requestContext.timeline.responseQueued;
+		trace.requestCompleted = requestContext.timeline.requestCompleted;
+
+		// the wall clock is taken once per trace instead of at every timestamp
+		trace.startTime = std::chrono::system_clock::now() - std::chrono::duration_cast<std::chrono::system_clock::duration>(
+				std::chrono::steady_clock::now() - trace.headersReceived);
+
+		if(settings.traceExporter) {
+			settings.traceExporter(trace);
+		}
+		if(traceExporter) {
+			traceExporter->add(std::move(trace));
+		}
+	}
+	catch (const std::exception& e) {
+		logger.warn << "Exporting trace failed: " << e.what() << std::endl;
+	}
+	catch (...) {
+		logger.warn << "Exporting trace failed: unknown exception" << std::endl;
+	}
+}
+
 } /* namespace server */
 } /* namespace http */
 } /* namespace com */
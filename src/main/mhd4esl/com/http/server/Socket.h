@@ -25,12 +25,15 @@
 #include <esl/com/http/server/Request.h>
 #include <esl/object/Object.h>
 
+#include <atomic>
 #include <condition_variable>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <string.h> // size_t
+#include <unordered_map>
 #include <utility>
 
 #include <microhttpd.h>
@@ -43,7 +46,19 @@ namespace com {
 namespace http {
 namespace server {
 
+class CertificateStore;
+class ClientCertificateCache;
+struct ConnectionContext;
+class EventStreamRegistry;
+class StreamNotifierRegistry;
+class Executor;
+class FileReadAhead;
+class ProxyProtocolListener;
 class RequestContext;
+class StatusCodeResponses;
+class TraceExporter;
+class TrustedProxies;
+class WebSocketReactor;
 
 class Socket : public esl::com::http::server::Socket {
 public:
@@ -56,7 +71,24 @@ public:
 
 	bool wait(std::uint32_t ms);
 
+	void reloadCertificates();
+
+	/* available for Settings::externalLoop while listening */
+	int getEventFd() const;
+	void run();
+	long getTimeout() const;
+
+	esl::com::http::server::MHDSocket::Introspection getIntrospection() const;
+
+	esl::com::http::server::MHDSocket::Limits getLimits() const;
+	void setLimits(const esl::com::http::server::MHDSocket::Limits& limits);
+
+	/* Returns the GnuTLS priority string of Settings::tlsPriorities and Settings::tlsEcdheAead,
+	 * empty if the default priorities of MHD are used */
+	static std::string getTlsPriorities(const std::string& tlsPriorities, bool tlsEcdheAead);
+
 private:
+	static MHD_Result mhdAcceptPolicy(void* cls, const sockaddr* address, socklen_t addressLength) noexcept;
 	static MHD_Result mhdAcceptHandler(void* cls,
 	        MHD_Connection* connection,
 	        const char* url,
@@ -65,7 +97,38 @@ private:
 	        const char* uploadData,
 	        size_t* uploadDataSize,
 	        void** connectionSpecificDataPtr) noexcept;
-	static bool accept(RequestContext& requestContext, const char* uploadData, size_t* uploadDataSize) noexcept;
+	static void mhdRequestCompletedHandler(void* cls,
+	        MHD_Connection* connection,
+	        void** connectionSpecificDataPtr,
+	        MHD_RequestTerminationCode toe) noexcept;
+	static void mhdConnectionNotifyHandler(void* cls,
+			MHD_Connection* connection,
+			void** socketContext,
+			MHD_ConnectionNotificationCode toe) noexcept;
+	/* called for new and closed connections if settings.runtimeLimits is true */
+	void addLimitedConnection(ConnectionContext& connectionContext, MHD_Connection* mhdConnection) noexcept;
+	void removeLimitedConnection(ConnectionContext& connectionContext) noexcept;
+	/* applies a changed connection timeout at the next request of the connection */
+	void updateConnectionTimeout(RequestContext& requestContext) noexcept;
+	/* lets the request update the state of its connection for introspection */
+	void trackRequest(RequestContext& requestContext) noexcept;
+	bool acceptRequest(RequestContext& requestContext) noexcept;
+	bool acceptRequestHandler(RequestContext& requestContext) noexcept;
+	/* returns the status code to reject the request with before its body is read or 0 */
+	unsigned short checkRequestLimits(RequestContext& requestContext) noexcept;
+	bool rejectRequest(RequestContext& requestContext, unsigned short statusCode) noexcept;
+	/* lets the request collect its body if it is small enough */
+	void collectSmallBody(RequestContext& requestContext) noexcept;
+	bool accept(RequestContext& requestContext, const char* uploadData, size_t* uploadDataSize) noexcept;
+	/* Writes the collected body. Returns false if a write has been dispatched to the executor.
+	 * Sets size to Writer::npos if the writer does not accept more data. */
+	bool flushSmallBody(RequestContext& requestContext, std::size_t& size);
+	void dispatchAccept(RequestContext& requestContext) noexcept;
+	void dispatchWrite(RequestContext& requestContext, const char* uploadData, size_t uploadDataSize) noexcept;
+	void stopDaemon() noexcept;
+	/* throws an exception if the socket does not use an external loop or if it is not listening */
+	void* getExternalLoopDaemon() const;
+	void exportTrace(RequestContext& requestContext, bool completed) noexcept;
 
 	void accessThreadInc() noexcept {}
 	void accessThreadDec() noexcept {}
@@ -74,7 +137,36 @@ private:
 	const esl::com::http::server::RequestHandler* requestHandler = nullptr;
 	void* daemonPtr = nullptr; // MHD_Daemon*
 	bool usingTLS = false;
+	bool suspendable = false;
 	std::function<void()> onReleasedHandler;
+	std::unique_ptr<Executor> executor;
+	std::unique_ptr<TrustedProxies> trustedProxies;
+	std::unique_ptr<ProxyProtocolListener> proxyProtocolListener;
+	std::unique_ptr<WebSocketReactor> webSocketReactor;
+	std::unique_ptr<EventStreamRegistry> eventStreamRegistry;
+	/* set only if the daemon supports suspend/resume */
+	std::unique_ptr<StreamNotifierRegistry> streamNotifierRegistry;
+	std::unique_ptr<FileReadAhead> fileReadAhead;
+	std::unique_ptr<CertificateStore> certificateStore;
+	/* set only if client certificates are requested, clientCa is the PEM content of settings.tlsClientCa */
+	std::unique_ptr<ClientCertificateCache> clientCertificateCache;
+	std::string clientCa;
+	/* empty if the default priorities of MHD are used */
+	std::string tlsPriorities;
+	std::unique_ptr<StatusCodeResponses> statusCodeResponses;
+	std::unique_ptr<TraceExporter> traceExporter;
+
+	/* limits that are enforced by mhd4esl if settings.runtimeLimits is true */
+	std::atomic<unsigned int> connectionLimit{0};
+	std::atomic<unsigned int> perIpConnectionLimit{0};
+	std::atomic<unsigned int> connectionTimeout{0};
+	std::atomic<unsigned int> connectionCount{0};
+	std::mutex ipConnectionsMutex;
+	std::unordered_map<std::string, unsigned int> ipConnections;
+
+	/* intrusive list of the open connections if settings.introspection is true */
+	mutable std::mutex connectionsMutex;
+	ConnectionContext* connections = nullptr;
 
 
 	/* ****************** *
@@ -0,0 +1,92 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/StatusCodeResponses.h>
+#include <mhd4esl/com/http/server/Connection.h>
+
+#include <esl/com/http/server/Response.h>
+#include <esl/system/Stacktrace.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+const unsigned short commonStatusCodes[] = { 400, 401, 403, 404, 405, 406, 408, 409, 410, 411, 412, 413, 414, 415, 416, 417, 422, 429, 431, 500, 501, 502, 503, 504 };
+}
+
+StatusCodeResponses::StatusCodeResponses(bool aSkipCustomMessages)
+: skipCustomMessages(aSkipCustomMessages)
+{
+	for(unsigned short statusCode : commonStatusCodes) {
+		// the default message and MIME type are taken from the exception itself, so they match the slow path
+		esl::com::http::server::exception::StatusCode exception(statusCode);
+		esl::com::http::server::Response response(statusCode, exception.getMimeType());
+
+		Entry entry;
+		entry.statusCode = statusCode;
+		entry.message = exception.what();
+		entry.mimeType = exception.getMimeType().toString();
+
+		MHD_Response* mhdResponse = MHD_create_response_from_buffer(entry.message.size(), const_cast<char*>(entry.message.data()), MHD_RESPMEM_MUST_COPY);
+		if(mhdResponse == nullptr) {
+			throw esl::system::Stacktrace::add(std::runtime_error("Cannot create response for status code " + std::to_string(statusCode)));
+		}
+		Connection::addHeaders(response, mhdResponse);
+		entry.mhdResponse = std::shared_ptr<MHD_Response>(mhdResponse, MHD_destroy_response);
+
+		entries.push_back(std::move(entry));
+	}
+}
+
+const std::shared_ptr<MHD_Response>* StatusCodeResponses::find(const esl::com::http::server::exception::StatusCode& exception) const noexcept {
+	const unsigned short statusCode = exception.getStatusCode();
+
+	for(const auto& entry : entries) {
+		if(entry.statusCode != statusCode) {
+			continue;
+		}
+		if(skipCustomMessages || (std::strcmp(exception.what(), entry.message.c_str()) == 0 && exception.getMimeType().toString() == entry.mimeType)) {
+			return &entry.mhdResponse;
+		}
+		break;
+	}
+
+	return nullptr;
+}
+
+const std::shared_ptr<MHD_Response>* StatusCodeResponses::find(unsigned short statusCode) const noexcept {
+	for(const auto& entry : entries) {
+		if(entry.statusCode == statusCode) {
+			return &entry.mhdResponse;
+		}
+	}
+
+	return nullptr;
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
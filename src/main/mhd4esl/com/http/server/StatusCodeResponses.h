@@ -0,0 +1,67 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_STATUSCODERESPONSES_H_
+#define MHD4ESL_COM_HTTP_SERVER_STATUSCODERESPONSES_H_
+
+#include <esl/com/http/server/exception/StatusCode.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <microhttpd.h>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Pre-built responses of common status codes with their default message. They are shared by all
+ * connections, so answering an exception::StatusCode does not allocate or copy a body. */
+class StatusCodeResponses {
+public:
+	/* If custom messages are skipped, the pre-built response is used for every exception of its status code. */
+	StatusCodeResponses(bool skipCustomMessages);
+
+	/* Returns the response for the exception or nullptr if it has to be built from the exception. */
+	const std::shared_ptr<MHD_Response>* find(const esl::com::http::server::exception::StatusCode& exception) const noexcept;
+
+	/* Returns the response with the default message or nullptr if the status code is not pre-built. */
+	const std::shared_ptr<MHD_Response>* find(unsigned short statusCode) const noexcept;
+
+private:
+	struct Entry {
+		unsigned short statusCode;
+		std::string message;
+		std::string mimeType;
+		std::shared_ptr<MHD_Response> mhdResponse;
+	};
+
+	const bool skipCustomMessages;
+	std::vector<Entry> entries;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_STATUSCODERESPONSES_H_ */
@@ -0,0 +1,130 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/StreamNotifier.h>
+#include <mhd4esl/com/http/server/StreamNotifierRegistry.h>
+#include <mhd4esl/com/http/server/Metrics.h>
+
+#include <microhttpd.h>
+
+#include <chrono>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+StreamNotifier::StreamNotifier(MHD_Connection& aMhdConnection, StreamNotifierRegistry* aRegistry)
+: mhdConnection(&aMhdConnection),
+  registry(aRegistry),
+  suspendable(aRegistry != nullptr)
+{
+	// a notifier that is not registered must not suspend, because nobody would resume it when the daemon stops
+	if(registry && !registry->add(*this)) {
+		registry = nullptr;
+		suspendable = false;
+	}
+}
+
+StreamNotifier::~StreamNotifier() {
+	if(registry) {
+		registry->remove(*this);
+	}
+}
+
+void StreamNotifier::notify() {
+	MHD_Connection* resumeConnection = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(mhdConnection == nullptr) {
+			return;
+		}
+
+		if(suspended) {
+			suspended = false;
+			resumeConnection = mhdConnection;
+		}
+		else {
+			// the content reader might be between reading and waiting
+			notified = true;
+			condVar.notify_one();
+		}
+	}
+
+	if(resumeConnection) {
+		MHD_resume_connection(resumeConnection);
+	}
+}
+
+void StreamNotifier::wait() noexcept {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if(notified) {
+		notified = false;
+		return;
+	}
+
+	if(suspendable) {
+		// MHD calls the content reader again after the connection has been resumed
+		suspended = true;
+		MHD_suspend_connection(mhdConnection);
+		Metrics::get().streamSuspends.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	// MHD has to get the chance to stop the connection
+	condVar.wait_for(lock, std::chrono::seconds(1), [this] { return notified; });
+	notified = false;
+}
+
+void StreamNotifier::detach() noexcept {
+	// removed before locking the mutex, because the registry locks the mutex of the notifier while it stops
+	if(registry) {
+		registry->remove(*this);
+		registry = nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	mhdConnection = nullptr;
+	suspended = false;
+}
+
+void StreamNotifier::stop() noexcept {
+	MHD_Connection* resumeConnection = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		suspendable = false;
+		if(suspended) {
+			suspended = false;
+			resumeConnection = mhdConnection;
+		}
+	}
+
+	if(resumeConnection) {
+		MHD_resume_connection(resumeConnection);
+	}
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
@@ -0,0 +1,75 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_STREAMNOTIFIER_H_
+#define MHD4ESL_COM_HTTP_SERVER_STREAMNOTIFIER_H_
+
+#include <esl/com/http/server/MHDConnection.h>
+
+#include <condition_variable>
+#include <mutex>
+
+struct MHD_Connection;
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+class StreamNotifierRegistry;
+
+/* Wakes up the content reader of a streamed body whose reader had no data. The connection is suspended
+ * while it waits. Without suspend/resume the content reader waits for at most a second instead. */
+class StreamNotifier : public esl::com::http::server::MHDConnection::Notifier {
+public:
+	/* The connection is suspended only if a registry is given, i.e. if the daemon supports suspending connections */
+	StreamNotifier(MHD_Connection& mhdConnection, StreamNotifierRegistry* registry);
+	~StreamNotifier();
+
+	void notify() override;
+
+	/* Called by the content reader if the reader has returned 0. It returns immediately
+	 * if notify() has been called since the last call, so the reader is read again. */
+	void wait() noexcept;
+
+	/* called if MHD has destroyed the response */
+	void detach() noexcept;
+
+	/* Called by the registry before the daemon is stopped. It resumes the connection if it is suspended
+	 * and the connection is not suspended anymore. */
+	void stop() noexcept;
+
+private:
+	MHD_Connection* mhdConnection;
+	StreamNotifierRegistry* registry;
+	bool suspendable;
+
+	std::mutex mutex;
+	std::condition_variable condVar;
+	bool notified = false;
+	bool suspended = false;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_STREAMNOTIFIER_H_ */
@@ -0,0 +1,64 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/StreamNotifierRegistry.h>
+#include <mhd4esl/com/http/server/StreamNotifier.h>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+bool StreamNotifierRegistry::add(StreamNotifier& streamNotifier) noexcept {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if(stopped) {
+		return false;
+	}
+
+	try {
+		streamNotifiers.insert(&streamNotifier);
+	}
+	catch(...) {
+		return false;
+	}
+	return true;
+}
+
+void StreamNotifierRegistry::remove(StreamNotifier& streamNotifier) noexcept {
+	std::lock_guard<std::mutex> lock(mutex);
+	streamNotifiers.erase(&streamNotifier);
+}
+
+void StreamNotifierRegistry::stop() noexcept {
+	// the lock is kept while resuming, so MHD cannot destroy the connection of a notifier in the meantime
+	std::lock_guard<std::mutex> lock(mutex);
+
+	stopped = true;
+	for(StreamNotifier* streamNotifier : streamNotifiers) {
+		streamNotifier->stop();
+	}
+	streamNotifiers.clear();
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
@@ -0,0 +1,56 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_STREAMNOTIFIERREGISTRY_H_
+#define MHD4ESL_COM_HTTP_SERVER_STREAMNOTIFIERREGISTRY_H_
+
+#include <mutex>
+#include <unordered_set>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+class StreamNotifier;
+
+/* Stream notifiers of a socket that might suspend their connection. MHD_stop_daemon must not be called
+ * while connections are suspended, so all of them are resumed by stop() before. */
+class StreamNotifierRegistry {
+public:
+	/* returns false if the registry has been stopped already or the notifier cannot be added */
+	bool add(StreamNotifier& streamNotifier) noexcept;
+	void remove(StreamNotifier& streamNotifier) noexcept;
+
+	/* resumes all suspended connections, the notifiers do not suspend their connections anymore */
+	void stop() noexcept;
+
+private:
+	std::mutex mutex;
+	bool stopped = false;
+	std::unordered_set<StreamNotifier*> streamNotifiers;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_STREAMNOTIFIERREGISTRY_H_ */
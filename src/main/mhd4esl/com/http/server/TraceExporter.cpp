@@ -0,0 +1,197 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/TraceExporter.h>
+#include <mhd4esl/com/http/server/Json.h>
+#include <mhd4esl/com/http/server/Metrics.h>
+
+#include <esl/Logger.h>
+#include <esl/system/Stacktrace.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+esl::Logger logger("mhd4esl::com::http::server::TraceExporter");
+
+/* OTLP JSON encodes 64 bit integers as strings */
+void appendUnixNano(std::string& json, const esl::com::http::server::MHDSocket::Trace& trace, std::chrono::steady_clock::time_point timePoint) {
+	const auto unixTime = trace.startTime.time_since_epoch() + (timePoint - trace.headersReceived);
+	json += '"';
+	json += std::to_string(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(unixTime).count()));
+	json += '"';
+}
+
+void appendEvent(std::string& json, bool& first, const esl::com::http::server::MHDSocket::Trace& trace, const char* name, std::chrono::steady_clock::time_point timePoint) {
+	if(timePoint == std::chrono::steady_clock::time_point()) {
+		return;
+	}
+
+	json += first ? "{\"timeUnixNano\":" : ",{\"timeUnixNano\":";
+	appendUnixNano(json, trace, timePoint);
+	json += ",\"name\":\"";
+	json += name;
+	json += "\"}";
+	first = false;
+}
+}
+
+TraceExporter::TraceExporter(const std::string& path, std::size_t aMaxQueueSize)
+: file(path, std::ios::out | std::ios::app | std::ios::binary),
+  maxQueueSize(aMaxQueueSize)
+{
+	if(!file) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot open trace file \"" + path + "\""));
+	}
+	thread = std::thread(&TraceExporter::run, this);
+}
+
+TraceExporter::~TraceExporter() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+	}
+	condVar.notify_one();
+	thread.join();
+}
+
+void TraceExporter::add(esl::com::http::server::MHDSocket::Trace&& trace) noexcept {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(traces.size() >= maxQueueSize) {
+			Metrics::get().tracesDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		try {
+			traces.push_back(std::move(trace));
+		}
+		catch(...) {
+			Metrics::get().tracesDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+	condVar.notify_one();
+}
+
+std::string TraceExporter::toJson(const esl::com::http::server::MHDSocket::Trace& trace) {
+	std::string json;
+	json.reserve(1024);
+
+	json += "{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":\"service.name\",\"value\":{\"stringValue\":\"mhd4esl\"}}]},"
+			"\"scopeSpans\":[{\"scope\":{\"name\":\"mhd4esl\"},\"spans\":[{\"traceId\":";
+	Json::appendString(json, trace.traceId);
+	json += ",\"spanId\":";
+	Json::appendString(json, trace.spanId);
+	if(!trace.parentSpanId.empty()) {
+		json += ",\"parentSpanId\":";
+		Json::appendString(json, trace.parentSpanId);
+	}
+	json += ",\"flags\":";
+	json += std::to_string(static_cast<unsigned int>(trace.traceFlags));
+	json += ",\"name\":";
+	Json::appendString(json, trace.method + " " + trace.path);
+	// SPAN_KIND_SERVER
+	json += ",\"kind\":2,\"startTimeUnixNano\":";
+	appendUnixNano(json, trace, trace.headersReceived);
+	json += ",\"endTimeUnixNano\":";
+	appendUnixNano(json, trace, trace.requestCompleted);
+
+	json += ",\"attributes\":[{\"key\":\"http.request.method\",\"value\":{\"stringValue\":";
+	Json::appendString(json, trace.method);
+	json += "}},{\"key\":\"url.path\",\"value\":{\"stringValue\":";
+	Json::appendString(json, trace.path);
+	json += "}}";
+	if(trace.statusCode != 0) {
+		json += ",{\"key\":\"http.response.status_code\",\"value\":{\"intValue\":\"";
+		json += std::to_string(trace.statusCode);
+		json += "\"}}";
+	}
+	json += "],\"events\":[";
+
+	bool first = true;
+	appendEvent(json, first, trace, "accept.returned", trace.acceptReturned);
+	appendEvent(json, first, trace, "upload.completed", trace.uploadCompleted);
+	appendEvent(json, first, trace, "response.queued", trace.responseQueued);
+
+	// STATUS_CODE_ERROR for server errors and terminated requests, STATUS_CODE_UNSET otherwise
+	json += (!trace.completed || trace.statusCode >= 500) ? "],\"status\":{\"code\":2}}]}]}]}" : "],\"status\":{}}]}]}]}";
+
+	return json;
+}
+
+void TraceExporter::run() noexcept {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(true) {
+		condVar.wait(lock, [this] { return stopped || !traces.empty(); });
+		if(traces.empty()) {
+			break;
+		}
+
+		// the queue is written by request threads, so it is not locked while formatting
+		std::deque<esl::com::http::server::MHDSocket::Trace> pending;
+		pending.swap(traces);
+		lock.unlock();
+
+		std::size_t failures = 0;
+		for(const auto& trace : pending) {
+			bool written = false;
+			try {
+				file << toJson(trace) << '\n';
+				written = static_cast<bool>(file);
+			}
+			catch(const std::exception& e) {
+				logger.warn << "Formatting trace failed: " << e.what() << std::endl;
+			}
+
+			if(written) {
+				Metrics::get().tracesExported.fetch_add(1, std::memory_order_relaxed);
+			}
+			else {
+				Metrics::get().tracesFailed.fetch_add(1, std::memory_order_relaxed);
+				++failures;
+				// the next traces are written again, e.g. if the disk is not full anymore
+				file.clear();
+			}
+		}
+
+		if(!file.flush()) {
+			logger.warn << "Flushing trace file failed" << std::endl;
+			file.clear();
+		}
+		if(failures > 0) {
+			logger.warn << "Writing " << failures << " traces failed" << std::endl;
+		}
+
+		lock.lock();
+	}
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
@@ -0,0 +1,68 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_TRACEEXPORTER_H_
+#define MHD4ESL_COM_HTTP_SERVER_TRACEEXPORTER_H_
+
+#include <esl/com/http/server/MHDSocket.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Appends traces to a file as OTLP JSON lines, i.e. one ExportTraceServiceRequest with one span per line.
+ * Traces are formatted and written by a separate thread. If its queue is full, traces are dropped. */
+class TraceExporter {
+public:
+	TraceExporter(const std::string& path, std::size_t maxQueueSize);
+	~TraceExporter();
+
+	void add(esl::com::http::server::MHDSocket::Trace&& trace) noexcept;
+
+	static std::string toJson(const esl::com::http::server::MHDSocket::Trace& trace);
+
+private:
+	void run() noexcept;
+
+	std::ofstream file;
+	const std::size_t maxQueueSize;
+
+	std::mutex mutex;
+	std::condition_variable condVar;
+	std::deque<esl::com::http::server::MHDSocket::Trace> traces;
+	bool stopped = false;
+	std::thread thread;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_TRACEEXPORTER_H_ */
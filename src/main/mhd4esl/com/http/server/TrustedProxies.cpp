@@ -0,0 +1,197 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/TrustedProxies.h>
+
+#include <esl/system/Stacktrace.h>
+#include <esl/utility/String.h>
+
+#ifdef _WIN32
+#include <Winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+
+/* removes spaces, quotes, brackets of IPv6 addresses and port numbers */
+std::string stripNode(std::string node) {
+	node = esl::utility::String::trim(node);
+	if(node.size() >= 2 && node.front() == '"' && node.back() == '"') {
+		node = node.substr(1, node.size() - 2);
+	}
+
+	if(!node.empty() && node.front() == '[') {
+		std::string::size_type pos = node.find(']');
+		return pos == std::string::npos ? std::string() : node.substr(1, pos - 1);
+	}
+
+	// a single colon is a port separator of an IPv4 address
+	std::string::size_type pos = node.find(':');
+	if(pos != std::string::npos && node.find(':', pos + 1) == std::string::npos) {
+		node.resize(pos);
+	}
+
+	return node;
+}
+
+} /* anonymous namespace */
+
+TrustedProxies::TrustedProxies(const std::vector<std::string>& aNetworks) {
+	for(const auto& networkStr : aNetworks) {
+		Network network;
+		std::string::size_type pos = networkStr.find('/');
+
+		if(!parseAddress(networkStr.substr(0, pos), network.address)) {
+	    	throw esl::system::Stacktrace::add(std::runtime_error("Invalid trusted proxy \"" + networkStr + "\""));
+		}
+
+		unsigned int maxPrefixLength = network.address.getSize() * 8;
+		network.prefixLength = maxPrefixLength;
+		if(pos != std::string::npos) {
+			network.prefixLength = esl::utility::String::toNumber<unsigned int>(networkStr.substr(pos + 1));
+			if(network.prefixLength > maxPrefixLength) {
+		    	throw esl::system::Stacktrace::add(std::runtime_error("Invalid prefix length of trusted proxy \"" + networkStr + "\""));
+			}
+		}
+
+		networks.push_back(network);
+	}
+}
+
+bool TrustedProxies::isTrusted(const Address& address) const noexcept {
+	for(const auto& network : networks) {
+		if(network.address.family != address.family) {
+			continue;
+		}
+
+		unsigned int fullBytes = network.prefixLength / 8;
+		unsigned int remainingBits = network.prefixLength % 8;
+
+		if(std::memcmp(network.address.bytes, address.bytes, fullBytes) != 0) {
+			continue;
+		}
+		if(remainingBits > 0) {
+			std::uint8_t mask = static_cast<std::uint8_t>(0xFF << (8 - remainingBits));
+			if((network.address.bytes[fullBytes] & mask) != (address.bytes[fullBytes] & mask)) {
+				continue;
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+bool TrustedProxies::resolve(const char* forwarded, const char* forwardedFor, Address& client) const {
+	std::vector<std::string> addresses;
+
+	if(forwarded) {
+		// e.g. Forwarded: for=192.0.2.43, for="[2001:db8:cafe::17]:4711";proto=https
+		for(const auto& element : esl::utility::String::split(forwarded, ',')) {
+			std::string forValue;
+			for(auto pair : esl::utility::String::split(element, ';')) {
+				pair = esl::utility::String::trim(pair);
+				if(pair.size() > 4 && std::tolower(static_cast<unsigned char>(pair[0])) == 'f'
+						&& std::tolower(static_cast<unsigned char>(pair[1])) == 'o'
+						&& std::tolower(static_cast<unsigned char>(pair[2])) == 'r'
+						&& pair[3] == '=') {
+					forValue = pair.substr(4);
+				}
+			}
+			addresses.push_back(stripNode(forValue));
+		}
+	}
+	else if(forwardedFor) {
+		for(const auto& element : esl::utility::String::split(forwardedFor, ',')) {
+			addresses.push_back(stripNode(element));
+		}
+	}
+
+	return resolve(addresses, client);
+}
+
+bool TrustedProxies::resolve(const std::vector<std::string>& addresses, Address& client) const {
+	bool found = false;
+
+	for(auto iter = addresses.rbegin(); iter != addresses.rend(); ++iter) {
+		Address address;
+
+		// stop at obfuscated or invalid entries, everything left of it cannot be verified
+		if(!parseAddress(*iter, address)) {
+			break;
+		}
+
+		client = address;
+		found = true;
+		if(!isTrusted(address)) {
+			break;
+		}
+	}
+
+	return found;
+}
+
+bool TrustedProxies::parseAddress(const std::string& str, Address& address) noexcept {
+	in_addr addr4;
+	in6_addr addr6;
+
+	if(inet_pton(AF_INET, str.c_str(), &addr4) == 1) {
+		address.family = Address::Family::ipv4;
+		std::memcpy(address.bytes, &addr4, 4);
+		return true;
+	}
+
+	if(inet_pton(AF_INET6, str.c_str(), &addr6) == 1) {
+		setIPv6Address(reinterpret_cast<const unsigned char*>(&addr6), address);
+		return true;
+	}
+
+	return false;
+}
+
+void TrustedProxies::setIPv6Address(const unsigned char* bytes, Address& address) noexcept {
+	static const unsigned char ipv4MappedPrefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+
+	if(std::memcmp(bytes, ipv4MappedPrefix, sizeof(ipv4MappedPrefix)) == 0) {
+		address.family = Address::Family::ipv4;
+		std::memcpy(address.bytes, bytes + 12, 4);
+	}
+	else {
+		address.family = Address::Family::ipv6;
+		std::memcpy(address.bytes, bytes, 16);
+	}
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
@@ -0,0 +1,68 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_TRUSTEDPROXIES_H_
+#define MHD4ESL_COM_HTTP_SERVER_TRUSTEDPROXIES_H_
+
+#include <esl/com/http/server/MHDRequest.h>
+
+#include <string>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+class TrustedProxies {
+public:
+	using Address = esl::com::http::server::MHDRequest::Address;
+
+	/* networks are addresses with optional prefix length, e.g. "10.0.0.0/8", "192.168.1.7" or "fd00::/8" */
+	TrustedProxies(const std::vector<std::string>& networks);
+
+	bool isTrusted(const Address& address) const noexcept;
+
+	/* Determines the client address from header "Forwarded" or, if it does not exist, from "X-Forwarded-For".
+	 * Addresses are checked from right to left and the first address that is not trusted is the client. */
+	bool resolve(const char* forwarded, const char* forwardedFor, Address& client) const;
+
+	static bool parseAddress(const std::string& str, Address& address) noexcept;
+
+	/* sets the 16 bytes of an IPv6 address, IPv4-mapped addresses become IPv4 addresses */
+	static void setIPv6Address(const unsigned char* bytes, Address& address) noexcept;
+
+private:
+	struct Network {
+		Address address;
+		unsigned int prefixLength;
+	};
+
+	bool resolve(const std::vector<std::string>& addresses, Address& client) const;
+
+	std::vector<Network> networks;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_TRUSTEDPROXIES_H_ */
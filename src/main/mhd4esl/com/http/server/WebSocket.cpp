@@ -0,0 +1,649 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/WebSocket.h>
+#include <mhd4esl/com/http/server/ConnectionContext.h>
+#include <mhd4esl/com/http/server/Request.h>
+#include <mhd4esl/com/http/server/WebSocketReactor.h>
+#include <mhd4esl/Logging.h>
+
+#include <esl/Logger.h>
+#include <esl/system/Stacktrace.h>
+
+#include <gnutls/gnutls.h>
+#include <gnutls/crypto.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+esl::Logger logger("mhd4esl::com::http::server::WebSocket");
+
+const char* webSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+const std::size_t readBufferSize = 16 * 1024;
+const std::chrono::seconds closeTimeout(5);
+
+#ifdef MSG_NOSIGNAL
+const int sendFlags = MSG_NOSIGNAL;
+#else
+const int sendFlags = 0;
+#endif
+
+bool hasToken(const char* value, const char* token) noexcept {
+	if(value == nullptr) {
+		return false;
+	}
+
+	const std::size_t tokenSize = std::strlen(token);
+	while(*value != 0) {
+		while(*value == ' ' || *value == '\t' || *value == ',') {
+			++value;
+		}
+
+		const char* begin = value;
+		while(*value != 0 && *value != ',') {
+			++value;
+		}
+
+		const char* end = value;
+		while(end > begin && (end[-1] == ' ' || end[-1] == '\t')) {
+			--end;
+		}
+
+		if(static_cast<std::size_t>(end - begin) == tokenSize
+				&& std::equal(begin, end, token, [](char c1, char c2) {
+					return std::tolower(static_cast<unsigned char>(c1)) == std::tolower(static_cast<unsigned char>(c2));
+				})) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool isValidUtf8(const unsigned char* data, std::size_t size) noexcept {
+	std::size_t i = 0;
+
+	while(i < size) {
+		// skip ASCII 8 bytes at once
+		if(i + 8 <= size) {
+			std::uint64_t word;
+			std::memcpy(&word, data + i, 8);
+			if((word & 0x8080808080808080ULL) == 0) {
+				i += 8;
+				continue;
+			}
+		}
+
+		const unsigned char c = data[i];
+		if(c < 0x80) {
+			++i;
+			continue;
+		}
+
+		std::size_t n;
+		std::uint32_t codePoint;
+		if((c & 0xE0) == 0xC0) {
+			n = 1;
+			codePoint = c & 0x1F;
+		}
+		else if((c & 0xF0) == 0xE0) {
+			n = 2;
+			codePoint = c & 0x0F;
+		}
+		else if((c & 0xF8) == 0xF0) {
+			n = 3;
+			codePoint = c & 0x07;
+		}
+		else {
+			return false;
+		}
+
+		if(i + n >= size) {
+			return false;
+		}
+		for(std::size_t k = 1; k <= n; ++k) {
+			if((data[i + k] & 0xC0) != 0x80) {
+				return false;
+			}
+			codePoint = (codePoint << 6) | (data[i + k] & 0x3F);
+		}
+
+		// reject overlong encodings, surrogates and values beyond U+10FFFF
+		if((n == 1 && codePoint < 0x80) || (n == 2 && codePoint < 0x800) || (n == 3 && codePoint < 0x10000)
+				|| codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+			return false;
+		}
+
+		i += n + 1;
+	}
+
+	return true;
+}
+
+bool isValidCloseCode(std::uint16_t code) noexcept {
+	if(code < 1000 || code >= 5000) {
+		return false;
+	}
+	if(code >= 3000) {
+		return true;
+	}
+	return code <= 1014 && code != 1004 && code != 1005 && code != 1006;
+}
+
+std::string toBase64(const unsigned char* data, std::size_t size) {
+	static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::string rv;
+	rv.reserve(((size + 2) / 3) * 4);
+
+	for(std::size_t i = 0; i < size; i += 3) {
+		std::uint32_t value = static_cast<std::uint32_t>(data[i]) << 16;
+		if(i + 1 < size) {
+			value |= static_cast<std::uint32_t>(data[i + 1]) << 8;
+		}
+		if(i + 2 < size) {
+			value |= data[i + 2];
+		}
+
+		rv += table[(value >> 18) & 0x3F];
+		rv += table[(value >> 12) & 0x3F];
+		rv += i + 1 < size ? table[(value >> 6) & 0x3F] : '=';
+		rv += i + 2 < size ? table[value & 0x3F] : '=';
+	}
+
+	return rv;
+}
+
+bool setNonBlocking(MHD_socket socket) noexcept {
+#ifdef _WIN32
+	u_long mode = 1;
+	return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+	const int flags = fcntl(socket, F_GETFL, 0);
+	return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+}
+
+WebSocket::WebSocket(WebSocketReactor& aReactor, MHD_socket aSocket, MHD_UpgradeResponseHandle& aUrh, Upgrade&& upgrade)
+: WebSocketFrameParser(upgrade.settings.maxMessageSize),
+  reactor(aReactor),
+  socket(aSocket),
+  urh(aUrh),
+  handler(std::move(upgrade.handler)),
+  settings(std::move(upgrade.settings))
+{ }
+
+bool WebSocket::send(const void* data, std::size_t size, bool isBinary) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if(terminated || closeSent) {
+		return false;
+	}
+	return enqueue(isBinary ? binary : text, data, size, false);
+}
+
+void WebSocket::close(std::uint16_t code, const std::string& reason) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if(terminated || closeSent) {
+		return;
+	}
+
+	unsigned char payload[125];
+	const std::size_t reasonSize = std::min(reason.size(), sizeof(payload) - 2);
+	payload[0] = static_cast<unsigned char>(code >> 8);
+	payload[1] = static_cast<unsigned char>(code);
+	std::memcpy(payload + 2, reason.data(), reasonSize);
+
+	enqueue(closeFrame, payload, 2 + reasonSize, true);
+	closeSent = true;
+	closeDeadline = std::chrono::steady_clock::now() + closeTimeout;
+}
+
+std::size_t WebSocket::getQueuedSize() const noexcept {
+	std::lock_guard<std::mutex> lock(mutex);
+	return sendBuffer.size() - sendOffset;
+}
+
+bool WebSocket::isUpgradeRequest(const Request& request) noexcept {
+	if(request.getMethodName() != "GET") {
+		return false;
+	}
+
+	// the key is a base64 encoded 16 byte value
+	const char* key = request.findHeader("Sec-WebSocket-Key");
+	const char* version = request.findHeader("Sec-WebSocket-Version");
+
+	return key != nullptr && std::strlen(key) == 24
+			&& version != nullptr && std::strcmp(version, "13") == 0
+			&& hasToken(request.findHeader("Upgrade"), "websocket")
+			&& hasToken(request.findHeader("Connection"), "upgrade");
+}
+
+std::string WebSocket::createAcceptKey(const std::string& key) {
+	const std::string input = key + webSocketGuid;
+	unsigned char digest[20];
+
+	if(gnutls_hash_fast(GNUTLS_DIG_SHA1, input.data(), input.size(), digest) != 0) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot compute value of header \"Sec-WebSocket-Accept\""));
+	}
+
+	return toBase64(digest, sizeof(digest));
+}
+
+void WebSocket::mhdUpgradeHandler(void* cls,
+		MHD_Connection*,
+		void*,
+		const char* extraIn,
+		size_t extraInSize,
+		MHD_socket socket,
+		MHD_UpgradeResponseHandle* urh) noexcept
+{
+	ConnectionContext& connectionContext = *static_cast<ConnectionContext*>(cls);
+	std::unique_ptr<Upgrade> upgrade = std::move(connectionContext.webSocketUpgrade);
+	connectionContext.setState(ConnectionContext::State::upgraded);
+
+	if(!upgrade || connectionContext.webSocketReactor == nullptr) {
+		logger.error << "Upgrade of connection without WebSocket\n";
+		MHD_upgrade_action(urh, MHD_UPGRADE_ACTION_CLOSE);
+		return;
+	}
+
+	// the thread of the reactor serves all sessions, so it must never block on a socket
+	if(!setNonBlocking(socket)) {
+		logger.error << "Cannot set WebSocket to non-blocking mode: " << std::strerror(errno) << "\n";
+		MHD_upgrade_action(urh, MHD_UPGRADE_ACTION_CLOSE);
+		return;
+	}
+
+	try {
+		std::shared_ptr<WebSocket> webSocket = std::make_shared<WebSocket>(*connectionContext.webSocketReactor, socket, *urh, std::move(*upgrade));
+
+		// data the client has sent already after the upgrade request
+		webSocket->inputBuffer.assign(extraIn, extraInSize);
+
+		connectionContext.webSocketReactor->add(std::move(webSocket));
+		return;
+	}
+	catch (const std::exception& e) {
+		logger.error << "std::exception::what(): " << e.what() << std::endl;
+	}
+	catch (...) {
+		logger.error << "unknown exception" << std::endl;
+	}
+
+	MHD_upgrade_action(urh, MHD_UPGRADE_ACTION_CLOSE);
+}
+
+void WebSocket::open() noexcept {
+	try {
+		handler->onOpen(shared_from_this());
+	}
+	catch (const std::exception& e) {
+		logger.warn << "std::exception::what(): " << e.what() << std::endl;
+		fail(1011);
+		return;
+	}
+	catch (...) {
+		logger.warn << "unknown exception" << std::endl;
+		fail(1011);
+		return;
+	}
+
+	if(!inputBuffer.empty()) {
+		processFrames(inputBuffer);
+	}
+}
+
+void WebSocket::onReadable() noexcept {
+	char buffer[readBufferSize];
+
+	auto size = ::recv(socket, buffer, sizeof(buffer), 0);
+	if(size > 0) {
+		// data after a close frame is ignored
+		if(!closeReceived) {
+			try {
+				inputBuffer.append(buffer, static_cast<std::size_t>(size));
+			}
+			catch(...) {
+				fail(1011);
+				return;
+			}
+			processFrames(inputBuffer);
+		}
+		return;
+	}
+
+	// nothing to read anymore, the reactor calls again on the next EPOLLIN
+	if(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+		return;
+	}
+
+	terminate(closeReceived ? closeCode : 1006);
+}
+
+void WebSocket::onWritable() noexcept {
+	bool notify = false;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(terminated) {
+			return;
+		}
+
+		flush();
+		if(sendBuffer.empty() && blocked) {
+			blocked = false;
+			notify = !closeSent;
+		}
+	}
+
+	if(notify) {
+		try {
+			handler->onWritable(*this);
+		}
+		catch (const std::exception& e) {
+			logger.warn << "std::exception::what(): " << e.what() << std::endl;
+			fail(1011);
+			return;
+		}
+		catch (...) {
+			logger.warn << "unknown exception" << std::endl;
+			fail(1011);
+			return;
+		}
+	}
+
+	terminateIfClosed();
+}
+
+void WebSocket::checkCloseTimeout(std::chrono::steady_clock::time_point now) noexcept {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(terminated || !closeSent || now < closeDeadline) {
+			return;
+		}
+	}
+
+	MHD4ESL_LOG(logger, debug) << "Timeout of WebSocket closing handshake\n";
+	terminate(closeReceived ? closeCode : 1006);
+}
+
+void WebSocket::terminate(std::uint16_t code) noexcept {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(terminated) {
+			return;
+		}
+		terminated = true;
+
+		sendBuffer.clear();
+		sendOffset = 0;
+		if(registered) {
+			reactor.removeEvents(*this);
+			registered = false;
+		}
+	}
+
+	try {
+		handler->onClose(*this, code);
+	}
+	catch (const std::exception& e) {
+		logger.warn << "std::exception::what(): " << e.what() << std::endl;
+	}
+	catch (...) {
+		logger.warn << "unknown exception" << std::endl;
+	}
+
+	// handlers usually keep the session, so the reference cycle is broken here
+	handler.reset();
+
+	MHD_upgrade_action(&urh, MHD_UPGRADE_ACTION_CLOSE);
+}
+
+void WebSocket::abort() noexcept {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(terminated) {
+			return;
+		}
+		terminated = true;
+	}
+
+	handler.reset();
+	MHD_upgrade_action(&urh, MHD_UPGRADE_ACTION_CLOSE);
+}
+
+bool WebSocket::isTerminated() const noexcept {
+	std::lock_guard<std::mutex> lock(mutex);
+	return terminated;
+}
+
+void WebSocket::registerEvents() noexcept {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if(!terminated && !registered) {
+		reactor.setEvents(*this, true, writeRequested);
+		registered = true;
+	}
+}
+
+bool WebSocket::processControlFrame(unsigned char opcode, const unsigned char* payload, std::size_t size) noexcept {
+	switch(opcode) {
+	case ping: {
+		std::lock_guard<std::mutex> lock(mutex);
+		if(!closeSent && !terminated) {
+			try {
+				enqueue(pong, payload, size, true);
+			}
+			catch(...) {
+			}
+		}
+		return true;
+	}
+	case pong:
+		return true;
+	case closeFrame:
+		if(size == 1) {
+			fail(1002);
+			return false;
+		}
+
+		closeCode = 1005;
+		if(size >= 2) {
+			closeCode = static_cast<std::uint16_t>((payload[0] << 8) | payload[1]);
+			if(!isValidCloseCode(closeCode) || !isValidUtf8(payload + 2, size - 2)) {
+				fail(1002);
+				return false;
+			}
+		}
+		closeReceived = true;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if(!closeSent && !terminated) {
+				try {
+					enqueue(closeFrame, payload, std::min<std::size_t>(size, 2), true);
+				}
+				catch(...) {
+				}
+				closeSent = true;
+				closeDeadline = std::chrono::steady_clock::now() + closeTimeout;
+			}
+		}
+
+		terminateIfClosed();
+		return false;
+	default:
+		fail(1002);
+		return false;
+	}
+}
+
+bool WebSocket::deliverMessage(const std::string& message, bool isBinary) noexcept {
+	if(!isBinary && !isValidUtf8(reinterpret_cast<const unsigned char*>(message.data()), message.size())) {
+		fail(1007);
+		return false;
+	}
+
+	try {
+		handler->onMessage(*this, message, isBinary);
+	}
+	catch (const std::exception& e) {
+		logger.warn << "std::exception::what(): " << e.what() << std::endl;
+		fail(1011);
+		return false;
+	}
+	catch (...) {
+		logger.warn << "unknown exception" << std::endl;
+		fail(1011);
+		return false;
+	}
+
+	return true;
+}
+
+void WebSocket::fail(std::uint16_t code) noexcept {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(!closeSent && !terminated) {
+			const unsigned char payload[2] = { static_cast<unsigned char>(code >> 8), static_cast<unsigned char>(code) };
+			try {
+				enqueue(closeFrame, payload, sizeof(payload), true);
+			}
+			catch(...) {
+			}
+			closeSent = true;
+		}
+	}
+
+	terminate(code);
+}
+
+void WebSocket::terminateIfClosed() noexcept {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(terminated || !closeReceived || !closeSent || !sendBuffer.empty()) {
+			return;
+		}
+	}
+
+	terminate(closeCode);
+}
+
+bool WebSocket::enqueue(unsigned char opcode, const void* data, std::size_t size, bool isControlFrame) {
+	const std::size_t headerSize = size < 126 ? 2 : (size <= 0xFFFF ? 4 : 10);
+	const std::size_t queuedSize = sendBuffer.size() - sendOffset;
+
+	// a message larger than the queue is accepted if nothing else is queued
+	if(!isControlFrame && queuedSize > 0 && queuedSize + headerSize + size > settings.maxQueueSize) {
+		blocked = true;
+		return false;
+	}
+
+	// frames of servers are not masked
+	unsigned char header[10];
+	header[0] = 0x80 | opcode;
+	if(size < 126) {
+		header[1] = static_cast<unsigned char>(size);
+	}
+	else if(size <= 0xFFFF) {
+		header[1] = 126;
+		header[2] = static_cast<unsigned char>(size >> 8);
+		header[3] = static_cast<unsigned char>(size);
+	}
+	else {
+		header[1] = 127;
+		for(std::size_t i = 0; i < 8; ++i) {
+			header[2 + i] = static_cast<unsigned char>(static_cast<std::uint64_t>(size) >> (56 - 8 * i));
+		}
+	}
+
+	sendBuffer.reserve(sendBuffer.size() + headerSize + size);
+	sendBuffer.append(reinterpret_cast<const char*>(header), headerSize);
+	sendBuffer.append(static_cast<const char*>(data), size);
+
+	flush();
+	return true;
+}
+
+void WebSocket::flush() noexcept {
+	// small frames queued in the meantime are sent with one call
+	while(sendOffset < sendBuffer.size()) {
+		auto size = ::send(socket, sendBuffer.data() + sendOffset, sendBuffer.size() - sendOffset, sendFlags);
+
+		if(size < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			// on EAGAIN the remaining data stays queued and the reactor waits for EPOLLOUT
+			if(errno != EAGAIN && errno != EWOULDBLOCK) {
+				// the reactor terminates the session if the connection is broken
+				sendBuffer.clear();
+				sendOffset = 0;
+			}
+			break;
+		}
+		sendOffset += static_cast<std::size_t>(size);
+	}
+
+	if(sendOffset == sendBuffer.size()) {
+		sendBuffer.clear();
+		sendOffset = 0;
+	}
+	else if(sendOffset >= readBufferSize) {
+		sendBuffer.erase(0, sendOffset);
+		sendOffset = 0;
+	}
+
+	const bool write = !sendBuffer.empty();
+	if(registered && write != writeRequested) {
+		reactor.setEvents(*this, false, write);
+	}
+	writeRequested = write;
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
@@ -0,0 +1,120 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_WEBSOCKET_H_
+#define MHD4ESL_COM_HTTP_SERVER_WEBSOCKET_H_
+
+#include <esl/com/http/server/MHDWebSocket.h>
+
+#include <mhd4esl/com/http/server/WebSocketFrameParser.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <microhttpd.h>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+class Request;
+class WebSocketReactor;
+
+class WebSocket : public esl::com::http::server::MHDWebSocket::Session, public std::enable_shared_from_this<WebSocket>, private WebSocketFrameParser {
+friend class WebSocketReactor;
+public:
+	/* kept in the ConnectionContext until MHD calls the upgrade handler */
+	struct Upgrade {
+		std::shared_ptr<esl::com::http::server::MHDWebSocket::Handler> handler;
+		esl::com::http::server::MHDWebSocket::Settings settings;
+	};
+
+	WebSocket(WebSocketReactor& reactor, MHD_socket socket, MHD_UpgradeResponseHandle& urh, Upgrade&& upgrade);
+
+	bool send(const void* data, std::size_t size, bool binary) override;
+	void close(std::uint16_t code, const std::string& reason) override;
+	std::size_t getQueuedSize() const noexcept override;
+
+	static bool isUpgradeRequest(const Request& request) noexcept;
+
+	/* value of header "Sec-WebSocket-Accept" for the value of header "Sec-WebSocket-Key" */
+	static std::string createAcceptKey(const std::string& key);
+
+	static void mhdUpgradeHandler(void* cls,
+			MHD_Connection* connection,
+			void* requestContext,
+			const char* extraIn,
+			size_t extraInSize,
+			MHD_socket socket,
+			MHD_UpgradeResponseHandle* urh) noexcept;
+
+private:
+	/* methods called by the thread of the reactor */
+	void open() noexcept;
+	void onReadable() noexcept;
+	void onWritable() noexcept;
+	void checkCloseTimeout(std::chrono::steady_clock::time_point now) noexcept;
+	void terminate(std::uint16_t code) noexcept;
+	void abort() noexcept;
+	bool isTerminated() const noexcept;
+	void registerEvents() noexcept;
+
+	bool processControlFrame(unsigned char opcode, const unsigned char* payload, std::size_t size) noexcept override;
+	bool deliverMessage(const std::string& message, bool isBinary) noexcept override;
+	void fail(std::uint16_t code) noexcept override;
+	void terminateIfClosed() noexcept;
+
+	/* requires a lock of mutex */
+	bool enqueue(unsigned char opcode, const void* data, std::size_t size, bool isControlFrame);
+	void flush() noexcept;
+
+	WebSocketReactor& reactor;
+	const MHD_socket socket;
+	MHD_UpgradeResponseHandle& urh;
+	std::shared_ptr<esl::com::http::server::MHDWebSocket::Handler> handler;
+	const esl::com::http::server::MHDWebSocket::Settings settings;
+
+	/* used by the thread of the reactor only */
+	std::string inputBuffer;
+	bool closeReceived = false;
+	std::uint16_t closeCode = 1005;
+
+	mutable std::mutex mutex;
+	std::string sendBuffer;
+	std::size_t sendOffset = 0;
+	bool registered = false;
+	bool writeRequested = false;
+	bool blocked = false;
+	bool closeSent = false;
+	bool terminated = false;
+	std::chrono::steady_clock::time_point closeDeadline;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_WEBSOCKET_H_ */
@@ -0,0 +1,178 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/WebSocketFrameParser.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+const std::size_t maxIdleMessageCapacity = 64 * 1024;
+}
+
+WebSocketFrameParser::WebSocketFrameParser(std::size_t aMaxMessageSize)
+: maxMessageSize(aMaxMessageSize)
+{ }
+
+bool WebSocketFrameParser::processFrames(std::string& input) noexcept {
+	std::size_t pos = 0;
+
+	while(true) {
+		unsigned char* data = reinterpret_cast<unsigned char*>(&input[0]) + pos;
+		const std::size_t available = input.size() - pos;
+
+		if(available < 2) {
+			break;
+		}
+
+		const bool fin = (data[0] & 0x80) != 0;
+		const unsigned char opcode = data[0] & 0x0F;
+
+		// no extension has been negotiated and frames of clients must be masked
+		if((data[0] & 0x70) != 0 || (data[1] & 0x80) == 0) {
+			fail(1002);
+			return false;
+		}
+
+		std::uint64_t payloadSize = data[1] & 0x7F;
+		std::size_t headerSize = 2;
+		if(payloadSize == 126) {
+			if(available < 4) {
+				break;
+			}
+			payloadSize = (static_cast<std::uint64_t>(data[2]) << 8) | data[3];
+			headerSize = 4;
+		}
+		else if(payloadSize == 127) {
+			if(available < 10) {
+				break;
+			}
+			payloadSize = 0;
+			for(std::size_t i = 2; i < 10; ++i) {
+				payloadSize = (payloadSize << 8) | data[i];
+			}
+			headerSize = 10;
+		}
+		headerSize += 4;
+
+		if(opcode & 0x08) {
+			if(!fin || payloadSize > 125) {
+				fail(1002);
+				return false;
+			}
+		}
+		else if(payloadSize > maxMessageSize - std::min(message.size(), maxMessageSize)) {
+			fail(1009);
+			return false;
+		}
+
+		if(available < headerSize || available - headerSize < payloadSize) {
+			break;
+		}
+
+		unsigned char* payload = data + headerSize;
+		const std::size_t size = static_cast<std::size_t>(payloadSize);
+		mask(payload, size, payload - 4);
+		pos += headerSize + size;
+
+		if(opcode & 0x08) {
+			if(!processControlFrame(opcode, payload, size)) {
+				return false;
+			}
+			continue;
+		}
+
+		switch(opcode) {
+		case continuation:
+			if(messageOpcode == continuation) {
+				fail(1002);
+				return false;
+			}
+			break;
+		case text:
+		case binary:
+			if(messageOpcode != continuation) {
+				fail(1002);
+				return false;
+			}
+			messageOpcode = opcode;
+			break;
+		default:
+			fail(1002);
+			return false;
+		}
+
+		try {
+			message.append(reinterpret_cast<const char*>(payload), size);
+		}
+		catch(...) {
+			fail(1011);
+			return false;
+		}
+
+		if(fin) {
+			const bool isBinary = (messageOpcode == binary);
+			messageOpcode = continuation;
+
+			const bool delivered = deliverMessage(message, isBinary);
+			if(message.capacity() > maxIdleMessageCapacity) {
+				std::string().swap(message);
+			}
+			else {
+				message.clear();
+			}
+
+			if(!delivered) {
+				return false;
+			}
+		}
+	}
+
+	input.erase(0, pos);
+	return true;
+}
+
+void WebSocketFrameParser::mask(unsigned char* data, std::size_t size, const unsigned char* maskingKey) noexcept {
+	// the key repeats every 4 bytes, so it repeats in the same way for 8 byte words
+	std::uint32_t key32;
+	std::memcpy(&key32, maskingKey, 4);
+	const std::uint64_t key64 = (static_cast<std::uint64_t>(key32) << 32) | key32;
+
+	std::size_t i = 0;
+	for(; i + 8 <= size; i += 8) {
+		std::uint64_t word;
+		std::memcpy(&word, data + i, 8);
+		word ^= key64;
+		std::memcpy(data + i, &word, 8);
+	}
+	for(; i < size; ++i) {
+		data[i] ^= maskingKey[i & 3];
+	}
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
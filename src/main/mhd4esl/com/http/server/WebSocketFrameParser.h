@@ -0,0 +1,74 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_WEBSOCKETFRAMEPARSER_H_
+#define MHD4ESL_COM_HTTP_SERVER_WEBSOCKETFRAMEPARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+/* Reads the frames a client sends over a WebSocket: it unmasks them in place, reassembles
+ * fragmented messages and closes with 1002 or 1009 on frames that violate RFC 6455.
+ * Messages, control frames and errors are passed to the derived class. */
+class WebSocketFrameParser {
+public:
+	WebSocketFrameParser(std::size_t maxMessageSize);
+	virtual ~WebSocketFrameParser() = default;
+
+	/* Processes all complete frames of input and removes them from input.
+	 * Returns false if parsing has stopped because of a close frame or an error. */
+	bool processFrames(std::string& input) noexcept;
+
+	/* XORs data with the 4 byte masking key, 8 bytes at once */
+	static void mask(unsigned char* data, std::size_t size, const unsigned char* maskingKey) noexcept;
+
+protected:
+	enum Opcode : unsigned char {
+		continuation = 0x0,
+		text = 0x1,
+		binary = 0x2,
+		closeFrame = 0x8,
+		ping = 0x9,
+		pong = 0xA
+	};
+
+private:
+	/* these methods return false to stop parsing */
+	virtual bool processControlFrame(unsigned char opcode, const unsigned char* payload, std::size_t size) noexcept = 0;
+	virtual bool deliverMessage(const std::string& message, bool isBinary) noexcept = 0;
+	virtual void fail(std::uint16_t code) noexcept = 0;
+
+	const std::size_t maxMessageSize;
+	std::string message;
+	unsigned char messageOpcode = continuation;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_WEBSOCKETFRAMEPARSER_H_ */
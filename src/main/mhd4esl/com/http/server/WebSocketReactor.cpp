@@ -0,0 +1,288 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/com/http/server/WebSocketReactor.h>
+#include <mhd4esl/com/http/server/WebSocket.h>
+
+#include <esl/Logger.h>
+#include <esl/system/Stacktrace.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+esl::Logger logger("mhd4esl::com::http::server::WebSocketReactor");
+
+const std::size_t maxEvents = 64;
+const int timeoutCheckIntervalMs = 1000;
+}
+
+WebSocketReactor::~WebSocketReactor() {
+	stop();
+}
+
+#ifndef __linux__
+
+void WebSocketReactor::add(std::shared_ptr<WebSocket>) {
+	throw esl::system::Stacktrace::add(std::runtime_error("WebSocket is not supported on this platform"));
+}
+
+void WebSocketReactor::stop() noexcept {
+}
+
+void WebSocketReactor::setEvents(WebSocket&, bool, bool) noexcept {
+}
+
+void WebSocketReactor::removeEvents(WebSocket&) noexcept {
+}
+
+void WebSocketReactor::run() noexcept {
+}
+
+void WebSocketReactor::openPending() noexcept {
+}
+
+void WebSocketReactor::erase(WebSocket&) noexcept {
+}
+
+#else
+
+void WebSocketReactor::add(std::shared_ptr<WebSocket> webSocket) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if(stopped) {
+		throw esl::system::Stacktrace::add(std::runtime_error("Cannot add WebSocket to stopped reactor"));
+	}
+
+	if(!thread.joinable()) {
+		epollFd = epoll_create1(EPOLL_CLOEXEC);
+		wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+		epoll_event event;
+		std::memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.ptr = nullptr;
+
+		if(epollFd < 0 || wakeupFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeupFd, &event) != 0) {
+			int error = errno;
+			if(epollFd >= 0) {
+				::close(epollFd);
+				epollFd = -1;
+			}
+			if(wakeupFd >= 0) {
+				::close(wakeupFd);
+				wakeupFd = -1;
+			}
+			throw esl::system::Stacktrace::add(std::runtime_error(std::string("Cannot create epoll instance for WebSockets: ") + std::strerror(error)));
+		}
+
+		thread = std::thread(&WebSocketReactor::run, this);
+	}
+
+	pendingOpens.push_back(webSocket);
+	try {
+		webSockets[webSocket.get()] = webSocket;
+	}
+	catch(...) {
+		pendingOpens.pop_back();
+		throw;
+	}
+
+	std::uint64_t value = 1;
+	if(write(wakeupFd, &value, sizeof(value)) != sizeof(value)) {
+		logger.warn << "Cannot wake up WebSocket reactor\n";
+	}
+}
+
+void WebSocketReactor::stop() noexcept {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(stopped) {
+			return;
+		}
+		stopped = true;
+	}
+
+	if(thread.joinable()) {
+		std::uint64_t value = 1;
+		if(write(wakeupFd, &value, sizeof(value)) != sizeof(value)) {
+			logger.warn << "Cannot wake up WebSocket reactor\n";
+		}
+		thread.join();
+	}
+
+	// the thread of the reactor has been stopped, so remaining sessions are closed by this thread
+	for(auto& webSocket : pendingOpens) {
+		webSocket->abort();
+		webSockets.erase(webSocket.get());
+	}
+	pendingOpens.clear();
+
+	for(auto& entry : webSockets) {
+		entry.second->close(1001, "");
+		entry.second->terminate(1001);
+	}
+	webSockets.clear();
+
+	if(epollFd >= 0) {
+		::close(epollFd);
+		epollFd = -1;
+	}
+	if(wakeupFd >= 0) {
+		::close(wakeupFd);
+		wakeupFd = -1;
+	}
+}
+
+void WebSocketReactor::setEvents(WebSocket& webSocket, bool add, bool write) noexcept {
+	epoll_event event;
+	std::memset(&event, 0, sizeof(event));
+	event.events = write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+	event.data.ptr = &webSocket;
+
+	if(epoll_ctl(epollFd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, webSocket.socket, &event) != 0) {
+		logger.warn << "Cannot register WebSocket events: " << std::strerror(errno) << "\n";
+	}
+}
+
+void WebSocketReactor::removeEvents(WebSocket& webSocket) noexcept {
+	epoll_event event;
+	std::memset(&event, 0, sizeof(event));
+
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, webSocket.socket, &event);
+}
+
+void WebSocketReactor::run() noexcept {
+	epoll_event events[maxEvents];
+	auto nextTimeoutCheck = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutCheckIntervalMs);
+
+	while(true) {
+		int count = epoll_wait(epollFd, events, maxEvents, timeoutCheckIntervalMs);
+		if(count < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			logger.error << "epoll_wait failed for WebSockets: " << std::strerror(errno) << "\n";
+			return;
+		}
+
+		for(int i = 0; i < count; ++i) {
+			if(events[i].data.ptr == nullptr) {
+				std::uint64_t value;
+				if(read(wakeupFd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+					logger.warn << "Cannot read wakeup event of WebSocket reactor\n";
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if(stopped) {
+						return;
+					}
+				}
+				openPending();
+				continue;
+			}
+
+			WebSocket& webSocket = *static_cast<WebSocket*>(events[i].data.ptr);
+			const std::uint32_t flags = events[i].events;
+
+			if(flags & EPOLLIN) {
+				webSocket.onReadable();
+			}
+			if((flags & EPOLLOUT) && !webSocket.isTerminated()) {
+				webSocket.onWritable();
+			}
+			if((flags & (EPOLLERR | EPOLLHUP)) && !(flags & EPOLLIN)) {
+				webSocket.terminate(1006);
+			}
+
+			if(webSocket.isTerminated()) {
+				erase(webSocket);
+			}
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if(now >= nextTimeoutCheck) {
+			nextTimeoutCheck = now + std::chrono::milliseconds(timeoutCheckIntervalMs);
+
+			std::vector<std::shared_ptr<WebSocket>> checkWebSockets;
+			try {
+				std::lock_guard<std::mutex> lock(mutex);
+				checkWebSockets.reserve(webSockets.size());
+				for(auto& entry : webSockets) {
+					checkWebSockets.push_back(entry.second);
+				}
+			}
+			catch(...) {
+				continue;
+			}
+
+			for(auto& webSocket : checkWebSockets) {
+				webSocket->checkCloseTimeout(now);
+				if(webSocket->isTerminated()) {
+					erase(*webSocket);
+				}
+			}
+		}
+	}
+}
+
+void WebSocketReactor::openPending() noexcept {
+	std::vector<std::shared_ptr<WebSocket>> webSocketsToOpen;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		webSocketsToOpen.swap(pendingOpens);
+	}
+
+	for(auto& webSocket : webSocketsToOpen) {
+		webSocket->open();
+		webSocket->registerEvents();
+		if(webSocket->isTerminated()) {
+			erase(*webSocket);
+		}
+	}
+}
+
+void WebSocketReactor::erase(WebSocket& webSocket) noexcept {
+	std::lock_guard<std::mutex> lock(mutex);
+	webSockets.erase(&webSocket);
+}
+
+#endif
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
@@ -0,0 +1,73 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_COM_HTTP_SERVER_WEBSOCKETREACTOR_H_
+#define MHD4ESL_COM_HTTP_SERVER_WEBSOCKETREACTOR_H_
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+class WebSocket;
+
+/* Waits with epoll for I/O of all WebSocket sessions of a socket and calls their handlers by one thread.
+ * The thread is started when the first session is added. */
+class WebSocketReactor {
+public:
+	WebSocketReactor() = default;
+	~WebSocketReactor();
+
+	/* the session is opened by the thread of the reactor */
+	void add(std::shared_ptr<WebSocket> webSocket);
+
+	/* closes all sessions with code 1001 (going away) */
+	void stop() noexcept;
+
+	void setEvents(WebSocket& webSocket, bool add, bool write) noexcept;
+	void removeEvents(WebSocket& webSocket) noexcept;
+
+private:
+	void run() noexcept;
+	void openPending() noexcept;
+	void erase(WebSocket& webSocket) noexcept;
+
+	std::mutex mutex;
+	bool stopped = false;
+	int epollFd = -1;
+	int wakeupFd = -1;
+	std::thread thread;
+
+	std::unordered_map<WebSocket*, std::shared_ptr<WebSocket>> webSockets;
+	std::vector<std::shared_ptr<WebSocket>> pendingOpens;
+};
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#endif /* MHD4ESL_COM_HTTP_SERVER_WEBSOCKETREACTOR_H_ */
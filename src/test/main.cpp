@@ -0,0 +1,60 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/Test.h>
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+/* Runs all tests, or all benchmarks if the first argument is "benchmark".
+ * Further arguments select tests or benchmarks by name. */
+int main(int argc, const char* argv[]) {
+	bool benchmark = argc > 1 && std::strcmp(argv[1], "benchmark") == 0;
+	int firstName = benchmark ? 2 : 1;
+	unsigned int failures = 0;
+
+	for(const mhd4esl::test::Test* test : mhd4esl::test::Test::getTests()) {
+		if(test->benchmark != benchmark) {
+			continue;
+		}
+
+		bool selected = (argc <= firstName);
+		for(int i = firstName; i < argc; ++i) {
+			selected |= (std::strcmp(argv[i], test->name) == 0);
+		}
+		if(!selected) {
+			continue;
+		}
+
+		try {
+			test->function();
+			std::cout << "[  OK  ] " << test->name << std::endl;
+		}
+		catch(const std::exception& e) {
+			std::cout << "[FAILED] " << test->name << ": " << e.what() << std::endl;
+			++failures;
+		}
+		catch(...) {
+			std::cout << "[FAILED] " << test->name << ": unknown exception" << std::endl;
+			++failures;
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MHD4ESL_TEST_H_
+#define MHD4ESL_TEST_H_
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace test {
+
+/* Tests register themselves with MHD4ESL_TEST or MHD4ESL_BENCHMARK and are run by main.
+ * A test fails if it throws an exception, e.g. by MHD4ESL_CHECK. */
+struct Test {
+	using Function = void(*)();
+
+	Test(const char* aName, Function aFunction, bool aBenchmark = false)
+	: name(aName),
+	  function(aFunction),
+	  benchmark(aBenchmark)
+	{
+		getTests().push_back(this);
+	}
+
+	static std::vector<const Test*>& getTests() {
+		static std::vector<const Test*> tests;
+		return tests;
+	}
+
+	const char* name;
+	Function function;
+	bool benchmark;
+};
+
+class Failure : public std::runtime_error {
+public:
+	Failure(const char* file, int line, const char* expression)
+	: std::runtime_error(std::string(file) + ":" + std::to_string(line) + ": check failed: " + expression)
+	{ }
+};
+
+} /* namespace test */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
+
+#define MHD4ESL_TEST(name) \
+	static void name(); \
+	static const ::mhd4esl::test::Test name##Test(#name, &name); \
+	static void name()
+
+#define MHD4ESL_BENCHMARK(name) \
+	static void name(); \
+	static const ::mhd4esl::test::Test name##Test(#name, &name, true); \
+	static void name()
+
+#define MHD4ESL_CHECK(expression) \
+	do { \
+		if(!(expression)) { \
+			throw ::mhd4esl::test::Failure(__FILE__, __LINE__, #expression); \
+		} \
+	} while(false)
+
+#define MHD4ESL_CHECK_THROWS(expression) \
+	do { \
+		bool thrown = false; \
+		try { \
+			expression; \
+		} \
+		catch(const ::mhd4esl::test::Failure&) { \
+			throw; \
+		} \
+		catch(...) { \
+			thrown = true; \
+		} \
+		if(!thrown) { \
+			throw ::mhd4esl::test::Failure(__FILE__, __LINE__, "exception expected from " #expression); \
+		} \
+	} while(false)
+
+#endif /* MHD4ESL_TEST_H_ */
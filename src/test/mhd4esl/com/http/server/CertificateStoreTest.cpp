@@ -0,0 +1,145 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/Test.h>
+#include <mhd4esl/com/http/server/CertificateStore.h>
+
+#include <gnutls/gnutls.h>
+#include <gnutls/abstract.h>
+
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+
+/* Fixtures have been created with "openssl ocsp" for server.crt, which is issued by ca.crt.
+ * wrong-issuer.der is signed by other-ca.crt and expired.der has been valid for one minute. */
+std::string readResource(const std::string& name) {
+	std::ifstream file(std::string(MHD4ESL_TEST_RESOURCES "/ocsp/") + name, std::ios::in | std::ios::binary);
+	if(!file) {
+		throw std::runtime_error("Cannot open resource \"" + name + "\"");
+	}
+
+	std::ostringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+
+struct Chain {
+	Chain(std::initializer_list<const char*> names) {
+		for(const char* name : names) {
+			std::string pem = readResource(name);
+			gnutls_datum_t datum;
+			datum.data = reinterpret_cast<unsigned char*>(&pem[0]);
+			datum.size = static_cast<unsigned int>(pem.size());
+
+			gnutls_pcert_st pcert;
+			if(gnutls_pcert_import_x509_raw(&pcert, &datum, GNUTLS_X509_FMT_PEM, 0) < 0) {
+				throw std::runtime_error(std::string("Cannot import certificate \"") + name + "\"");
+			}
+			pcerts.push_back(pcert);
+		}
+	}
+
+	~Chain() {
+		for(auto& pcert : pcerts) {
+			gnutls_pcert_deinit(&pcert);
+		}
+	}
+
+	std::vector<gnutls_pcert_st> pcerts;
+};
+
+void checkOcspResponse(const char* name, std::initializer_list<const char*> chainNames) {
+	Chain chain(chainNames);
+	CertificateStore::OcspResponse ocspResponse;
+	ocspResponse.der = readResource(name);
+	CertificateStore::checkOcspResponse(ocspResponse, chain.pcerts);
+}
+
+} /* anonymous namespace */
+
+MHD4ESL_TEST(ocspGood) {
+	Chain chain({ "server.crt", "ca.crt" });
+	CertificateStore::OcspResponse ocspResponse;
+	ocspResponse.der = readResource("good.der");
+
+	CertificateStore::checkOcspResponse(ocspResponse, chain.pcerts);
+	MHD4ESL_CHECK(ocspResponse.thisUpdate > 0);
+	MHD4ESL_CHECK(ocspResponse.nextUpdate > ocspResponse.thisUpdate);
+}
+
+MHD4ESL_TEST(ocspRevoked) {
+	MHD4ESL_CHECK_THROWS(checkOcspResponse("revoked.der", { "server.crt", "ca.crt" }));
+}
+
+MHD4ESL_TEST(ocspExpired) {
+	MHD4ESL_CHECK_THROWS(checkOcspResponse("expired.der", { "server.crt", "ca.crt" }));
+}
+
+MHD4ESL_TEST(ocspWrongIssuer) {
+	MHD4ESL_CHECK_THROWS(checkOcspResponse("wrong-issuer.der", { "server.crt", "ca.crt" }));
+}
+
+MHD4ESL_TEST(ocspWithoutIssuer) {
+	MHD4ESL_CHECK_THROWS(checkOcspResponse("good.der", { "server.crt" }));
+}
+
+MHD4ESL_TEST(ocspOfOtherCertificate) {
+	MHD4ESL_CHECK_THROWS(checkOcspResponse("good.der", { "ca.crt", "ca.crt" }));
+}
+
+/* The watcher checks the files once per interval and sleeps in between,
+ * so it uses almost no CPU time while it runs for several intervals. */
+MHD4ESL_TEST(certificateWatcherSleeps) {
+	std::vector<esl::com::http::server::MHDSocket::Settings::Certificate> files(1);
+	files[0].hostname = "localhost";
+	files[0].certificateFile = MHD4ESL_TEST_RESOURCES "/tls/ecdsa.crt";
+	files[0].keyFile = MHD4ESL_TEST_RESOURCES "/tls/ecdsa.key";
+
+	CertificateStore certificateStore(files, nullptr, 0);
+	certificateStore.reload();
+
+	const std::clock_t start = std::clock();
+	certificateStore.startWatcher(1, 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(3500));
+	certificateStore.stopWatcher();
+	const std::clock_t cpuTime = std::clock() - start;
+
+	MHD4ESL_CHECK(cpuTime < CLOCKS_PER_SEC / 10);
+	MHD4ESL_CHECK(certificateStore.find("localhost") != nullptr);
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
@@ -0,0 +1,87 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/Test.h>
+#include <mhd4esl/com/http/server/ETag.h>
+
+#include <cstring>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+
+std::uint64_t xxh64(const char* str) {
+	return ETag::xxh64(str, std::strlen(str));
+}
+
+} /* anonymous namespace */
+
+/* reference values of the xxHash implementation, the last input covers the four lanes and the tail */
+MHD4ESL_TEST(etagXxh64) {
+	MHD4ESL_CHECK(xxh64("") == 0xef46db3751d8e999ULL);
+	MHD4ESL_CHECK(xxh64("abc") == 0x44bc2cf5ad770999ULL);
+	MHD4ESL_CHECK(xxh64("Nobody inspects the spammish repetition") == 0xfbcea83c8a378bf1ULL);
+}
+
+MHD4ESL_TEST(etagCreate) {
+	MHD4ESL_CHECK(ETag::create("abc", 3) == "\"44bc2cf5ad770999\"");
+	MHD4ESL_CHECK(ETag::create("", 0) == "\"ef46db3751d8e999\"");
+}
+
+MHD4ESL_TEST(etagMatchesAny) {
+	MHD4ESL_CHECK(ETag::matches("*", "\"abc\""));
+	MHD4ESL_CHECK(ETag::matches(" * ", "\"abc\""));
+	MHD4ESL_CHECK(!ETag::matches("*x", "\"abc\""));
+	MHD4ESL_CHECK(!ETag::matches(nullptr, "\"abc\""));
+}
+
+MHD4ESL_TEST(etagMatchesWeak) {
+	MHD4ESL_CHECK(ETag::matches("\"abc\"", "\"abc\""));
+	MHD4ESL_CHECK(ETag::matches("W/\"abc\"", "\"abc\""));
+	MHD4ESL_CHECK(ETag::matches("\"abc\"", "W/\"abc\""));
+	MHD4ESL_CHECK(ETag::matches("W/\"abc\"", "W/\"abc\""));
+	MHD4ESL_CHECK(!ETag::matches("W/\"abd\"", "\"abc\""));
+}
+
+MHD4ESL_TEST(etagMatchesList) {
+	MHD4ESL_CHECK(ETag::matches("\"x\", \"abc\"", "\"abc\""));
+	MHD4ESL_CHECK(ETag::matches("\"x\",W/\"abc\" ,\"y\"", "\"abc\""));
+	MHD4ESL_CHECK(ETag::matches("\"x\", \"a,b\"", "\"a,b\""));
+	MHD4ESL_CHECK(!ETag::matches("\"x\", \"y\"", "\"abc\""));
+	MHD4ESL_CHECK(!ETag::matches("\"a,b\"", "\"a\""));
+}
+
+MHD4ESL_TEST(etagMatchesMalformed) {
+	MHD4ESL_CHECK(!ETag::matches("", "\"abc\""));
+	MHD4ESL_CHECK(!ETag::matches(" , ,", "\"abc\""));
+	MHD4ESL_CHECK(!ETag::matches("abc", "\"abc\""));
+	MHD4ESL_CHECK(!ETag::matches("\"abc", "\"abc\""));
+	MHD4ESL_CHECK(!ETag::matches("W/", "\"abc\""));
+	MHD4ESL_CHECK(!ETag::matches("w/\"abc\"", "\"abc\""));
+	MHD4ESL_CHECK(!ETag::matches("abc", "abc"));
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
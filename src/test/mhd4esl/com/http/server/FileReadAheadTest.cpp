@@ -0,0 +1,137 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/Test.h>
+#include <mhd4esl/com/http/server/FileReadAhead.h>
+#include <mhd4esl/com/http/server/FileStream.h>
+
+#include <microhttpd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+
+/* file with random content of a size that is not a multiple of FileStream::blockSize */
+class TemporaryFile {
+public:
+	TemporaryFile(std::size_t size) {
+		char pathTemplate[] = "/tmp/mhd4esl-test-XXXXXX";
+		int fd = mkstemp(pathTemplate);
+		if(fd < 0) {
+			throw std::runtime_error("Cannot create temporary file");
+		}
+		path = pathTemplate;
+
+		std::mt19937 random(1);
+		for(std::size_t i = 0; i < size; ++i) {
+			content.push_back(static_cast<char>(random()));
+		}
+		bool written = (write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+		close(fd);
+		if(!written) {
+			throw std::runtime_error("Cannot write temporary file");
+		}
+	}
+
+	~TemporaryFile() {
+		std::remove(path.c_str());
+	}
+
+	std::string path;
+	std::string content;
+};
+
+/* reads the file by the content reader of MHD until it has read maxSize bytes or the end of the file */
+std::string readFileStream(FileReadAhead& readAhead, const TemporaryFile& file, std::size_t maxSize, ssize_t& result) {
+	int fd = open(file.path.c_str(), O_RDONLY);
+	MHD4ESL_CHECK(fd >= 0);
+
+	// the connection is not used without registry, because the stream does not suspend it then
+	MHD_Connection& mhdConnection = *reinterpret_cast<MHD_Connection*>(&readAhead);
+	FileStream* fileStream = new FileStream(readAhead, fd, file.content.size(), mhdConnection, nullptr);
+
+	std::string content;
+	char buffer[32 * 1024];
+	while(content.size() < maxSize) {
+		result = FileStream::contentReaderCallback(fileStream, content.size(), buffer, sizeof(buffer));
+		if(result < 0) {
+			break;
+		}
+		content.append(buffer, static_cast<std::size_t>(result));
+	}
+	FileStream::contentReaderFreeCallback(fileStream);
+
+	return content;
+}
+
+} /* anonymous namespace */
+
+MHD4ESL_TEST(fileStreamReadsFile) {
+	TemporaryFile file(3 * FileStream::blockSize + 4711);
+	FileReadAhead readAhead(2);
+
+	for(int i = 0; i < 10; ++i) {
+		ssize_t result = 0;
+		MHD4ESL_CHECK(readFileStream(readAhead, file, file.content.size() + 1, result) == file.content);
+		MHD4ESL_CHECK(result == MHD_CONTENT_READER_END_OF_STREAM);
+	}
+	readAhead.stop();
+}
+
+MHD4ESL_TEST(fileStreamDestroyedWhileReading) {
+	TemporaryFile file(8 * FileStream::blockSize);
+	FileReadAhead readAhead(2);
+
+	// the stream is deleted by the completion of the read in progress
+	for(int i = 0; i < 10; ++i) {
+		ssize_t result = 0;
+		std::string content = readFileStream(readAhead, file, FileStream::blockSize + 1, result);
+		MHD4ESL_CHECK(content == file.content.substr(0, content.size()));
+	}
+	readAhead.stop();
+}
+
+MHD4ESL_TEST(fileReadAheadAfterStop) {
+	TemporaryFile file(FileStream::blockSize / 2);
+	FileReadAhead readAhead(1);
+	readAhead.stop();
+
+	// reads are done by the calling thread after the read ahead has been stopped
+	ssize_t result = 0;
+	MHD4ESL_CHECK(readFileStream(readAhead, file, file.content.size() + 1, result) == file.content);
+	MHD4ESL_CHECK(result == MHD_CONTENT_READER_END_OF_STREAM);
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
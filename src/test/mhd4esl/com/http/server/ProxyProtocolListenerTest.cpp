@@ -0,0 +1,218 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/Test.h>
+#include <mhd4esl/com/http/server/ProxyProtocolListener.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <cstdint>
+#include <string>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+
+struct Parsed {
+	ProxyProtocolListener::Result result;
+	std::size_t headerSize = 0;
+	sockaddr_storage clientAddress;
+	socklen_t clientAddressSize = 0;
+};
+
+Parsed parse(const std::string& data) {
+	Parsed parsed;
+	parsed.result = ProxyProtocolListener::parse(reinterpret_cast<const unsigned char*>(data.data()), data.size(), parsed.headerSize, parsed.clientAddress, parsed.clientAddressSize);
+	return parsed;
+}
+
+std::string getAddress(const Parsed& parsed) {
+	char buffer[INET6_ADDRSTRLEN] = { 0 };
+	if(parsed.clientAddress.ss_family == AF_INET) {
+		inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in&>(parsed.clientAddress).sin_addr, buffer, sizeof(buffer));
+	}
+	else if(parsed.clientAddress.ss_family == AF_INET6) {
+		inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6&>(parsed.clientAddress).sin6_addr, buffer, sizeof(buffer));
+	}
+	return buffer;
+}
+
+std::uint16_t getPort(const Parsed& parsed) {
+	if(parsed.clientAddress.ss_family == AF_INET) {
+		return ntohs(reinterpret_cast<const sockaddr_in&>(parsed.clientAddress).sin_port);
+	}
+	if(parsed.clientAddress.ss_family == AF_INET6) {
+		return ntohs(reinterpret_cast<const sockaddr_in6&>(parsed.clientAddress).sin6_port);
+	}
+	return 0;
+}
+
+/* signature, version and command, family and protocol, length of the addresses */
+std::string createV2(unsigned char command, unsigned char family, const std::string& addresses) {
+	std::string header("\x0D\x0A\x0D\x0A\x00\x0D\x0A\x51\x55\x49\x54\x0A", 12);
+	header += static_cast<char>(0x20 | command);
+	header += static_cast<char>(family);
+	header += static_cast<char>(addresses.size() >> 8);
+	header += static_cast<char>(addresses.size() & 0xFF);
+	return header + addresses;
+}
+
+} /* anonymous namespace */
+
+MHD4ESL_TEST(proxyProtocolV1Tcp4) {
+	const std::string header = "PROXY TCP4 192.0.2.1 198.51.100.2 56324 443\r\n";
+	Parsed parsed = parse(header + "GET / HTTP/1.1\r\n");
+	MHD4ESL_CHECK(parsed.result == ProxyProtocolListener::Result::complete);
+	MHD4ESL_CHECK(parsed.headerSize == header.size());
+	MHD4ESL_CHECK(parsed.clientAddressSize == sizeof(sockaddr_in));
+	MHD4ESL_CHECK(getAddress(parsed) == "192.0.2.1");
+	MHD4ESL_CHECK(getPort(parsed) == 56324);
+}
+
+MHD4ESL_TEST(proxyProtocolV1Tcp6) {
+	const std::string header = "PROXY TCP6 2001:db8::1 2001:db8::2 4711 80\r\n";
+	Parsed parsed = parse(header);
+	MHD4ESL_CHECK(parsed.result == ProxyProtocolListener::Result::complete);
+	MHD4ESL_CHECK(parsed.headerSize == header.size());
+	MHD4ESL_CHECK(parsed.clientAddressSize == sizeof(sockaddr_in6));
+	MHD4ESL_CHECK(getAddress(parsed) == "2001:db8::1");
+	MHD4ESL_CHECK(getPort(parsed) == 4711);
+}
+
+MHD4ESL_TEST(proxyProtocolV1Unknown) {
+	Parsed parsed = parse("PROXY UNKNOWN\r\n");
+	MHD4ESL_CHECK(parsed.result == ProxyProtocolListener::Result::complete);
+	MHD4ESL_CHECK(parsed.headerSize == 15);
+	MHD4ESL_CHECK(parsed.clientAddressSize == 0);
+
+	// the addresses behind UNKNOWN are ignored
+	parsed = parse("PROXY UNKNOWN ffff::1 ffff::2 1 2\r\n");
+	MHD4ESL_CHECK(parsed.result == ProxyProtocolListener::Result::complete);
+	MHD4ESL_CHECK(parsed.clientAddressSize == 0);
+}
+
+MHD4ESL_TEST(proxyProtocolV1Invalid) {
+	MHD4ESL_CHECK(parse("GET / HTTP/1.1\r\n").result == ProxyProtocolListener::Result::invalid);
+	MHD4ESL_CHECK(parse("PROXY TCP4 192.0.2.1 198.51.100.2 56324\r\n").result == ProxyProtocolListener::Result::invalid);
+	MHD4ESL_CHECK(parse("PROXY TCP4 2001:db8::1 198.51.100.2 56324 443\r\n").result == ProxyProtocolListener::Result::invalid);
+	MHD4ESL_CHECK(parse("PROXY TCP4 192.0.2.1 198.51.100.2 65536 443\r\n").result == ProxyProtocolListener::Result::invalid);
+	MHD4ESL_CHECK(parse("PROXY UDP4 192.0.2.1 198.51.100.2 56324 443\r\n").result == ProxyProtocolListener::Result::invalid);
+}
+
+MHD4ESL_TEST(proxyProtocolV1Truncated) {
+	const std::string header = "PROXY TCP4 192.0.2.1 198.51.100.2 56324 443\r\n";
+	MHD4ESL_CHECK(parse("").result == ProxyProtocolListener::Result::incomplete);
+	MHD4ESL_CHECK(parse("PRO").result == ProxyProtocolListener::Result::incomplete);
+	for(std::size_t size = 1; size < header.size(); ++size) {
+		MHD4ESL_CHECK(parse(header.substr(0, size)).result == ProxyProtocolListener::Result::incomplete);
+	}
+}
+
+/* the specification limits a line of version 1 to 107 bytes including CRLF */
+MHD4ESL_TEST(proxyProtocolV1MaxSize) {
+	const std::string prefix = "PROXY UNKNOWN ";
+	const std::string longest = prefix + std::string(107 - prefix.size() - 2, 'x') + "\r\n";
+	MHD4ESL_CHECK(longest.size() == 107);
+
+	Parsed parsed = parse(longest);
+	MHD4ESL_CHECK(parsed.result == ProxyProtocolListener::Result::complete);
+	MHD4ESL_CHECK(parsed.headerSize == 107);
+
+	MHD4ESL_CHECK(parse(prefix + std::string(107 - prefix.size() - 1, 'x') + "\r\n").result == ProxyProtocolListener::Result::invalid);
+	MHD4ESL_CHECK(parse(prefix + std::string(106 - prefix.size(), 'x')).result == ProxyProtocolListener::Result::incomplete);
+	MHD4ESL_CHECK(parse(prefix + std::string(107 - prefix.size(), 'x')).result == ProxyProtocolListener::Result::invalid);
+}
+
+MHD4ESL_TEST(proxyProtocolV2Local) {
+	const std::string header = createV2(0x00, 0x00, "");
+	Parsed parsed = parse(header + "GET / HTTP/1.1\r\n");
+	MHD4ESL_CHECK(parsed.result == ProxyProtocolListener::Result::complete);
+	MHD4ESL_CHECK(parsed.headerSize == 16);
+	MHD4ESL_CHECK(parsed.clientAddressSize == 0);
+
+	// LOCAL ignores the addresses, even if the proxy sends some
+	parsed = parse(createV2(0x00, 0x11, std::string(12, '\x01')));
+	MHD4ESL_CHECK(parsed.result == ProxyProtocolListener::Result::complete);
+	MHD4ESL_CHECK(parsed.headerSize == 28);
+	MHD4ESL_CHECK(parsed.clientAddressSize == 0);
+}
+
+MHD4ESL_TEST(proxyProtocolV2ProxyInet) {
+	// source 192.0.2.1:56324, destination 198.51.100.2:443 and a TLV behind the addresses
+	const std::string addresses("\xC0\x00\x02\x01" "\xC6\x33\x64\x02" "\xDC\x04" "\x01\xBB" "\x04\x00\x01\x00", 16);
+	const std::string header = createV2(0x01, 0x11, addresses);
+	Parsed parsed = parse(header);
+	MHD4ESL_CHECK(parsed.result == ProxyProtocolListener::Result::complete);
+	MHD4ESL_CHECK(parsed.headerSize == 32);
+	MHD4ESL_CHECK(parsed.clientAddressSize == sizeof(sockaddr_in));
+	MHD4ESL_CHECK(getAddress(parsed) == "192.0.2.1");
+	MHD4ESL_CHECK(getPort(parsed) == 56324);
+}
+
+MHD4ESL_TEST(proxyProtocolV2ProxyInet6) {
+	std::string addresses(36, '\0');
+	addresses[0] = '\x20';
+	addresses[1] = '\x01';
+	addresses[2] = '\x0d';
+	addresses[3] = '\xb8';
+	addresses[15] = '\x01';
+	addresses[32] = '\x12';
+	addresses[33] = '\x67';
+	Parsed parsed = parse(createV2(0x01, 0x21, addresses));
+	MHD4ESL_CHECK(parsed.result == ProxyProtocolListener::Result::complete);
+	MHD4ESL_CHECK(parsed.headerSize == 52);
+	MHD4ESL_CHECK(parsed.clientAddressSize == sizeof(sockaddr_in6));
+	MHD4ESL_CHECK(getAddress(parsed) == "2001:db8::1");
+	MHD4ESL_CHECK(getPort(parsed) == 4711);
+}
+
+MHD4ESL_TEST(proxyProtocolV2Invalid) {
+	// version 1 in the version field and an unknown command
+	std::string header = createV2(0x01, 0x11, std::string(12, '\0'));
+	header[12] = '\x11';
+	MHD4ESL_CHECK(parse(header).result == ProxyProtocolListener::Result::invalid);
+	MHD4ESL_CHECK(parse(createV2(0x02, 0x11, std::string(12, '\0'))).result == ProxyProtocolListener::Result::invalid);
+
+	header = createV2(0x01, 0x11, std::string(12, '\0'));
+	header[11] = '\x0B';
+	MHD4ESL_CHECK(parse(header).result == ProxyProtocolListener::Result::invalid);
+
+	// addresses that are too short for the family are ignored
+	Parsed parsed = parse(createV2(0x01, 0x21, std::string(12, '\0')));
+	MHD4ESL_CHECK(parsed.result == ProxyProtocolListener::Result::complete);
+	MHD4ESL_CHECK(parsed.clientAddressSize == 0);
+}
+
+MHD4ESL_TEST(proxyProtocolV2Truncated) {
+	const std::string header = createV2(0x01, 0x11, std::string(12, '\x01'));
+	for(std::size_t size = 1; size < header.size(); ++size) {
+		MHD4ESL_CHECK(parse(header.substr(0, size)).result == ProxyProtocolListener::Result::incomplete);
+	}
+	MHD4ESL_CHECK(parse(header).result == ProxyProtocolListener::Result::complete);
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
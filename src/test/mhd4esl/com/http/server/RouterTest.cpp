@@ -0,0 +1,155 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/Test.h>
+#include <mhd4esl/com/http/server/Router.h>
+
+#include <esl/com/http/server/RequestContext.h>
+#include <esl/com/http/server/RequestHandler.h>
+#include <esl/io/Input.h>
+
+#include <string>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+
+class Handler : public esl::com::http::server::RequestHandler {
+public:
+	esl::io::Input accept(esl::com::http::server::RequestContext&) const override {
+		return esl::io::Input();
+	}
+};
+
+/* path parameter at index of the last found route */
+std::string getParameter(const std::string& path, const Router::Parameters& parameters, std::size_t index) {
+	MHD4ESL_CHECK(index < parameters.size);
+	return path.substr(parameters.slots[index].first, parameters.slots[index].second);
+}
+
+} /* anonymous namespace */
+
+MHD4ESL_TEST(routerPrefersStaticSegments) {
+	Handler me, user, rest;
+	Router router;
+	router.add("GET", "/users/me", me);
+	router.add("GET", "/users/{id}", user);
+	router.add("GET", "/users/{path...}", rest);
+	router.build();
+
+	Router::Parameters parameters;
+	MHD4ESL_CHECK(router.find("GET", "/users/me", parameters) == &me);
+	MHD4ESL_CHECK(parameters.size == 0);
+
+	MHD4ESL_CHECK(router.find("GET", "/users/42", parameters) == &user);
+	MHD4ESL_CHECK(parameters.size == 1);
+	MHD4ESL_CHECK(parameters.names != nullptr && parameters.names->at(0) == "id");
+	MHD4ESL_CHECK(getParameter("/users/42", parameters, 0) == "42");
+
+	MHD4ESL_CHECK(router.find("GET", "/users/42/posts", parameters) == &rest);
+	MHD4ESL_CHECK(getParameter("/users/42/posts", parameters, 0) == "42/posts");
+
+	MHD4ESL_CHECK(router.find("GET", "/user", parameters) == nullptr);
+	MHD4ESL_CHECK(parameters.names == nullptr);
+}
+
+MHD4ESL_TEST(routerBacktracks) {
+	Handler meGet, userPost, abc, axd;
+	Router router;
+	router.add("GET", "/users/me", meGet);
+	router.add("POST", "/users/{id}", userPost);
+	router.add("GET", "/a/b/c", abc);
+	router.add("GET", "/a/{x}/d", axd);
+	router.build();
+
+	Router::Parameters parameters;
+	// the static route has no endpoint for POST, so the parameter route is used
+	MHD4ESL_CHECK(router.find("POST", "/users/me", parameters) == &userPost);
+	MHD4ESL_CHECK(getParameter("/users/me", parameters, 0) == "me");
+
+	// the static segment "b" matches, but its subtree does not
+	MHD4ESL_CHECK(router.find("GET", "/a/b/d", parameters) == &axd);
+	MHD4ESL_CHECK(parameters.size == 1);
+	MHD4ESL_CHECK(getParameter("/a/b/d", parameters, 0) == "b");
+	MHD4ESL_CHECK(router.find("GET", "/a/b/c", parameters) == &abc);
+	MHD4ESL_CHECK(parameters.size == 0);
+}
+
+MHD4ESL_TEST(routerCatchAll) {
+	Handler files, any;
+	Router router;
+	router.add("GET", "/static/*", files);
+	router.add("*", "/any/{rest...}", any);
+	router.build();
+
+	Router::Parameters parameters;
+	MHD4ESL_CHECK(router.find("GET", "/static/css/site.css", parameters) == &files);
+	MHD4ESL_CHECK(parameters.names->at(0) == "*");
+	MHD4ESL_CHECK(getParameter("/static/css/site.css", parameters, 0) == "css/site.css");
+	MHD4ESL_CHECK(router.find("GET", "/static/", parameters) == &files);
+	MHD4ESL_CHECK(getParameter("/static/", parameters, 0) == "");
+	MHD4ESL_CHECK(router.find("GET", "/static", parameters) == nullptr);
+
+	// GET routes answer HEAD requests, "*" matches every method
+	MHD4ESL_CHECK(router.find("HEAD", "/static/a", parameters) == &files);
+	MHD4ESL_CHECK(router.find("POST", "/static/a", parameters) == nullptr);
+	MHD4ESL_CHECK(router.find("PROPFIND", "/any/x/y", parameters) == &any);
+	MHD4ESL_CHECK(getParameter("/any/x/y", parameters, 0) == "x/y");
+}
+
+MHD4ESL_TEST(routerAllowedMethods) {
+	Handler handler;
+	Router router;
+	router.add("GET", "/users/me", handler);
+	router.add("POST", "/users/{id}", handler);
+	router.add("DELETE", "/users/{id}", handler);
+	router.add("PROPFIND", "/users/{id}", handler);
+	router.build();
+
+	Router::Parameters parameters;
+	MHD4ESL_CHECK(router.find("PUT", "/users/me", parameters) == nullptr);
+	MHD4ESL_CHECK(router.getAllowedMethods("/users/me") == "GET, HEAD, POST, DELETE, PROPFIND");
+	MHD4ESL_CHECK(router.getAllowedMethods("/users/42") == "POST, DELETE, PROPFIND");
+	MHD4ESL_CHECK(router.getAllowedMethods("/users/42/posts") == "");
+	MHD4ESL_CHECK(router.getAllowedMethods("/other") == "");
+}
+
+MHD4ESL_TEST(routerRejectsInvalidRoutes) {
+	Handler handler;
+	Router router;
+	router.add("GET", "/users/{id}", handler);
+
+	MHD4ESL_CHECK_THROWS(router.add("GET", "users", handler));
+	MHD4ESL_CHECK_THROWS(router.add("GET", "/users{id}", handler));
+	MHD4ESL_CHECK_THROWS(router.add("GET", "/{path...}/x", handler));
+	MHD4ESL_CHECK_THROWS(router.add("GET", "/users/{name", handler));
+	MHD4ESL_CHECK_THROWS(router.add("GET", "/users/{id}", handler));
+
+	router.build();
+	MHD4ESL_CHECK_THROWS(router.add("POST", "/users", handler));
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
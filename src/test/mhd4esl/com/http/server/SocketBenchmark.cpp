@@ -0,0 +1,362 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/Test.h>
+#include <mhd4esl/com/http/server/CertificateStore.h>
+#include <mhd4esl/com/http/server/Socket.h>
+
+#include <esl/com/http/server/MHDSocket.h>
+
+#include <gnutls/gnutls.h>
+#include <gnutls/abstract.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+
+const unsigned int handshakeCount = 200;
+const std::size_t transferSize = 64 * 1024 * 1024;
+const std::size_t recordSize = 16 * 1024;
+const char* rsaOnly = "NORMAL:-SIGN-ALL:+SIGN-RSA-SHA256:+SIGN-RSA-PSS-RSAE-SHA256";
+const char* tls12 = "NORMAL:-VERS-TLS1.3";
+const char* tls12RsaOnly = "NORMAL:-VERS-TLS1.3:-SIGN-ALL:+SIGN-RSA-SHA256:+SIGN-RSA-PSS-RSAE-SHA256";
+
+/* The server has an ECDSA and an RSA certificate for "localhost". Clients that accept RSA signatures only
+ * let the server fall back from the preferred ECDSA certificate. */
+struct Configuration {
+	const char* name;
+	bool tlsEcdheAead;
+	const char* clientPriorities;
+};
+
+const Configuration configurations[] = {
+	{ "default, ECDSA", false, "NORMAL" },
+	{ "default, RSA", false, rsaOnly },
+	{ "tls-ecdhe-aead, ECDSA", true, "NORMAL" },
+	{ "tls-ecdhe-aead, RSA", true, rsaOnly },
+	{ "tls-ecdhe-aead, TLS 1.2, ECDSA", true, tls12 },
+	{ "tls-ecdhe-aead, TLS 1.2, RSA", true, tls12RsaOnly }
+};
+
+void check(int rc, const char* what) {
+	if(rc < 0) {
+		throw std::runtime_error(std::string(what) + ": " + gnutls_strerror(rc));
+	}
+}
+
+/* state of a server session for the hook and the certificate callback, that work like the ones of Socket */
+struct ServerSession {
+	const CertificateStore& certificateStore;
+	CertificateStore::ClientPkAlgorithms clientPkAlgorithms;
+};
+
+int clientHelloHook(gnutls_session_t session, unsigned int, unsigned int, unsigned int, const gnutls_datum_t* message) {
+	CertificateStore::parseClientHello(*message, static_cast<ServerSession*>(gnutls_session_get_ptr(session))->clientPkAlgorithms);
+	return 0;
+}
+
+int retrieveCertificate(gnutls_session_t session, const gnutls_cert_retr_st* info, gnutls_pcert_st** pcert, unsigned int* pcertLength,
+		gnutls_ocsp_data_st** ocsp, unsigned int* ocspLength, gnutls_privkey_t* pkey, unsigned int* flags) {
+	const ServerSession& serverSession = *static_cast<const ServerSession*>(gnutls_session_get_ptr(session));
+	const CertificateStore::Certificate* certificate = serverSession.certificateStore.find("localhost",
+			serverSession.clientPkAlgorithms.algorithms, serverSession.clientPkAlgorithms.count);
+	if(certificate == nullptr) {
+		return -1;
+	}
+
+	*pkey = certificate->key;
+	*pcertLength = static_cast<unsigned int>(certificate->chain.size());
+	*pcert = const_cast<gnutls_pcert_st*>(certificate->chain.data());
+	*ocsp = nullptr;
+	*ocspLength = 0;
+	*flags = 0;
+	return 0;
+}
+
+/* TCP listener on 127.0.0.1 with a port chosen by the kernel */
+class Loopback {
+public:
+	Loopback() {
+		listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+		if(listenFd < 0) {
+			throw std::runtime_error("Cannot create socket");
+		}
+
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t addressLength = sizeof(address);
+		if(::bind(listenFd, reinterpret_cast<sockaddr*>(&address), addressLength) != 0
+				|| ::listen(listenFd, 16) != 0
+				|| ::getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0) {
+			::close(listenFd);
+			throw std::runtime_error("Cannot listen on loopback address");
+		}
+		port = address.sin_port;
+	}
+
+	~Loopback() {
+		::close(listenFd);
+	}
+
+	int accept() const {
+		int fd = ::accept(listenFd, nullptr, nullptr);
+		if(fd < 0) {
+			throw std::runtime_error("Cannot accept connection");
+		}
+		return fd;
+	}
+
+	int connect() const {
+		int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+		if(fd < 0) {
+			throw std::runtime_error("Cannot create socket");
+		}
+
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = port;
+		if(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+			::close(fd);
+			throw std::runtime_error("Cannot connect to loopback address");
+		}
+		return fd;
+	}
+
+private:
+	int listenFd;
+	in_port_t port;
+};
+
+class Session {
+public:
+	Session(unsigned int flags, int fd)
+	: fd(fd)
+	{
+		check(gnutls_init(&session, flags), "Cannot create TLS session");
+	}
+
+	~Session() {
+		gnutls_deinit(session);
+		::close(fd);
+	}
+
+	void handshake() {
+		gnutls_transport_set_int(session, fd);
+		int rc;
+		do {
+			rc = gnutls_handshake(session);
+		} while(rc < 0 && !gnutls_error_is_fatal(rc));
+		check(rc, "TLS handshake failed");
+	}
+
+	gnutls_session_t session;
+
+private:
+	int fd;
+};
+
+class Benchmark {
+public:
+	Benchmark(const Configuration& aConfiguration, const CertificateStore& aCertificateStore)
+	: configuration(aConfiguration),
+	  certificateStore(aCertificateStore),
+	  serverPriorities(Socket::getTlsPriorities("", configuration.tlsEcdheAead))
+	{
+		check(gnutls_certificate_allocate_credentials(&serverCredentials), "Cannot create server credentials");
+		gnutls_certificate_set_retrieve_function3(serverCredentials, retrieveCertificate);
+		check(gnutls_certificate_allocate_credentials(&clientCredentials), "Cannot create client credentials");
+	}
+
+	~Benchmark() {
+		gnutls_certificate_free_credentials(serverCredentials);
+		gnutls_certificate_free_credentials(clientCredentials);
+	}
+
+	/* returns the description of the negotiated session */
+	std::string runHandshakes(unsigned int count) {
+		std::string description;
+		run([this, count, &description]() {
+			for(unsigned int i = 0; i < count; ++i) {
+				Session server(GNUTLS_SERVER, loopback.accept());
+				ServerSession serverSession{certificateStore, {}};
+				initServer(server, serverSession);
+				server.handshake();
+
+				char* desc = gnutls_session_get_desc(server.session);
+				description = desc;
+				gnutls_free(desc);
+			}
+		}, [this, count]() {
+			for(unsigned int i = 0; i < count; ++i) {
+				Session client(GNUTLS_CLIENT, loopback.connect());
+				initClient(client);
+				client.handshake();
+			}
+		});
+		return description;
+	}
+
+	void runTransfer(std::size_t size) {
+		run([this, size]() {
+			Session server(GNUTLS_SERVER, loopback.accept());
+			ServerSession serverSession{certificateStore, {}};
+			initServer(server, serverSession);
+			server.handshake();
+
+			std::vector<char> record(recordSize, 'x');
+			for(std::size_t sent = 0; sent < size;) {
+				ssize_t rc = gnutls_record_send(server.session, record.data(), std::min(record.size(), size - sent));
+				if(rc < 0 && !gnutls_error_is_fatal(static_cast<int>(rc))) {
+					continue;
+				}
+				check(static_cast<int>(rc), "Cannot send TLS record");
+				sent += static_cast<std::size_t>(rc);
+			}
+		}, [this, size]() {
+			Session client(GNUTLS_CLIENT, loopback.connect());
+			initClient(client);
+			client.handshake();
+
+			std::vector<char> record(recordSize);
+			for(std::size_t received = 0; received < size;) {
+				ssize_t rc = gnutls_record_recv(client.session, record.data(), record.size());
+				if(rc < 0 && !gnutls_error_is_fatal(static_cast<int>(rc))) {
+					continue;
+				}
+				check(static_cast<int>(rc), "Cannot receive TLS record");
+				if(rc == 0) {
+					throw std::runtime_error("Connection closed during transfer");
+				}
+				received += static_cast<std::size_t>(rc);
+			}
+		});
+	}
+
+private:
+	void initServer(Session& server, ServerSession& serverSession) {
+		gnutls_session_set_ptr(server.session, &serverSession);
+		gnutls_handshake_set_hook_function(server.session, GNUTLS_HANDSHAKE_CLIENT_HELLO, GNUTLS_HOOK_PRE, clientHelloHook);
+		check(gnutls_credentials_set(server.session, GNUTLS_CRD_CERTIFICATE, serverCredentials), "Cannot set server credentials");
+		if(serverPriorities.empty()) {
+			check(gnutls_set_default_priority(server.session), "Cannot set default priorities");
+		}
+		else {
+			check(gnutls_priority_set_direct(server.session, serverPriorities.c_str(), nullptr), "Cannot set server priorities");
+		}
+	}
+
+	void initClient(Session& client) {
+		check(gnutls_server_name_set(client.session, GNUTLS_NAME_DNS, "localhost", 9), "Cannot set server name");
+		check(gnutls_credentials_set(client.session, GNUTLS_CRD_CERTIFICATE, clientCredentials), "Cannot set client credentials");
+		check(gnutls_priority_set_direct(client.session, configuration.clientPriorities, nullptr), "Cannot set client priorities");
+	}
+
+	/* runs the client in another thread and rethrows its exception */
+	template<typename Server, typename Client>
+	void run(Server server, Client client) {
+		std::exception_ptr clientException;
+		std::thread clientThread([&client, &clientException]() {
+			try {
+				client();
+			}
+			catch(...) {
+				clientException = std::current_exception();
+			}
+		});
+
+		try {
+			server();
+		}
+		catch(...) {
+			// the client fails as well as soon as the server closes its connection
+			clientThread.join();
+			throw;
+		}
+		clientThread.join();
+
+		if(clientException) {
+			std::rethrow_exception(clientException);
+		}
+	}
+
+	const Configuration& configuration;
+	const CertificateStore& certificateStore;
+	const std::string serverPriorities;
+	Loopback loopback;
+	gnutls_certificate_credentials_t serverCredentials;
+	gnutls_certificate_credentials_t clientCredentials;
+};
+
+} /* anonymous namespace */
+
+/* Handshakes per second and throughput of a single connection for the TLS settings of Socket */
+MHD4ESL_BENCHMARK(tlsHandshakeAndThroughput) {
+	std::vector<esl::com::http::server::MHDSocket::Settings::Certificate> files(2);
+	files[0].hostname = "localhost";
+	files[0].certificateFile = MHD4ESL_TEST_RESOURCES "/tls/ecdsa.crt";
+	files[0].keyFile = MHD4ESL_TEST_RESOURCES "/tls/ecdsa.key";
+	files[1].hostname = "localhost";
+	files[1].certificateFile = MHD4ESL_TEST_RESOURCES "/tls/rsa.crt";
+	files[1].keyFile = MHD4ESL_TEST_RESOURCES "/tls/rsa.key";
+
+	CertificateStore certificateStore(files, nullptr, 0);
+	certificateStore.reload();
+
+	for(const Configuration& configuration : configurations) {
+		Benchmark benchmark(configuration, certificateStore);
+
+		auto start = std::chrono::steady_clock::now();
+		std::string description = benchmark.runHandshakes(handshakeCount);
+		std::chrono::duration<double> handshakeTime = std::chrono::steady_clock::now() - start;
+
+		start = std::chrono::steady_clock::now();
+		benchmark.runTransfer(transferSize);
+		std::chrono::duration<double> transferTime = std::chrono::steady_clock::now() - start;
+
+		std::cout << configuration.name << ": " << description << "\n"
+				<< "  " << static_cast<unsigned long>(handshakeCount / handshakeTime.count()) << " handshakes/s, "
+				<< static_cast<unsigned long>(transferSize / transferTime.count() / (1024 * 1024)) << " MiB/s\n";
+	}
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
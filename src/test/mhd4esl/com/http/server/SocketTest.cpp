@@ -0,0 +1,350 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/Test.h>
+#include <mhd4esl/com/http/server/ETag.h>
+#include <mhd4esl/com/http/server/Socket.h>
+
+#include <esl/com/http/server/MHDResponseCache.h>
+#include <esl/com/http/server/MHDSocket.h>
+#include <esl/com/http/server/RequestContext.h>
+#include <esl/com/http/server/RequestHandler.h>
+#include <esl/com/http/server/Response.h>
+#include <esl/io/Input.h>
+#include <esl/io/output/String.h>
+#include <esl/utility/MIME.h>
+
+#include <gnutls/gnutls.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+
+const char* rsaOnly = "NORMAL:-SIGN-ALL:+SIGN-RSA-SHA256:+SIGN-RSA-PSS-RSAE-SHA256";
+
+class Handler : public esl::com::http::server::RequestHandler {
+public:
+	esl::io::Input accept(esl::com::http::server::RequestContext&) const override {
+		return esl::io::Input();
+	}
+};
+
+/* Sends "Hello" with status 200. Responses of path "/cached" may be cached for a minute. */
+class HelloHandler : public esl::com::http::server::RequestHandler {
+public:
+	esl::io::Input accept(esl::com::http::server::RequestContext& requestContext) const override {
+		++calls;
+
+		esl::com::http::server::Response response(200, esl::utility::MIME::Type::textPlain);
+		if(requestContext.getPath() == "/cached") {
+			response.addHeader("Cache-Control", "max-age=60");
+		}
+		requestContext.getConnection().send(response, esl::io::output::String::create("Hello"));
+		return esl::io::Input();
+	}
+
+	mutable std::atomic<unsigned int> calls{0};
+};
+
+void check(int rc, const char* what) {
+	if(rc < 0) {
+		throw std::runtime_error(std::string(what) + ": " + gnutls_strerror(rc));
+	}
+}
+
+/* port of 127.0.0.1 that has been free a moment ago */
+std::uint16_t getFreePort() {
+	int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0) {
+		throw std::runtime_error("Cannot create socket");
+	}
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(address);
+	if(::bind(fd, reinterpret_cast<sockaddr*>(&address), addressLength) != 0
+			|| ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0) {
+		::close(fd);
+		throw std::runtime_error("Cannot bind to loopback address");
+	}
+	::close(fd);
+	return ntohs(address.sin_port);
+}
+
+/* socket on a free port of 127.0.0.1 that listens until it is destroyed */
+class Server {
+public:
+	Server(std::vector<std::pair<std::string, std::string>> settings, const esl::com::http::server::RequestHandler& requestHandler)
+	: port(getFreePort()),
+	  socket(createSettings(std::move(settings), port))
+	{
+		socket.listen(requestHandler, nullptr);
+	}
+
+	~Server() {
+		socket.release();
+	}
+
+	const std::uint16_t port;
+
+private:
+	static esl::com::http::server::MHDSocket::Settings createSettings(std::vector<std::pair<std::string, std::string>> settings, std::uint16_t port) {
+		settings.emplace_back("port", std::to_string(port));
+		return esl::com::http::server::MHDSocket::Settings(settings);
+	}
+
+	Socket socket;
+};
+
+/* HTTPS settings with an ECDSA and an RSA certificate for "localhost" */
+std::vector<std::pair<std::string, std::string>> createHttpsSettings() {
+	return {
+		{ "https", "true" },
+		{ "tls-certificate", "localhost;" MHD4ESL_TEST_RESOURCES "/tls/ecdsa.crt;" MHD4ESL_TEST_RESOURCES "/tls/ecdsa.key" },
+		{ "tls-certificate", "localhost;" MHD4ESL_TEST_RESOURCES "/tls/rsa.crt;" MHD4ESL_TEST_RESOURCES "/tls/rsa.key" }
+	};
+}
+
+struct HttpResponse {
+	std::string statusLine;
+	std::string etag;
+	std::string body;
+};
+
+/* sends a GET request by plain HTTP and reads the response until the server closes the connection */
+HttpResponse httpGet(std::uint16_t port, const std::string& path, const std::string& ifNoneMatch = "") {
+	int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0) {
+		throw std::runtime_error("Cannot create socket");
+	}
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	if(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+		::close(fd);
+		throw std::runtime_error("Cannot connect to loopback address");
+	}
+
+	std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n";
+	if(!ifNoneMatch.empty()) {
+		request += "If-None-Match: " + ifNoneMatch + "\r\n";
+	}
+	request += "\r\n";
+	if(::send(fd, request.data(), request.size(), 0) != static_cast<ssize_t>(request.size())) {
+		::close(fd);
+		throw std::runtime_error("Cannot send request");
+	}
+
+	std::string data;
+	char buffer[1024];
+	ssize_t size;
+	while((size = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+		data.append(buffer, static_cast<std::size_t>(size));
+	}
+	::close(fd);
+
+	HttpResponse response;
+	const std::size_t headerEnd = data.find("\r\n\r\n");
+	if(headerEnd == std::string::npos) {
+		throw std::runtime_error("Incomplete response");
+	}
+	response.statusLine = data.substr(0, data.find("\r\n"));
+	response.body = data.substr(headerEnd + 4);
+
+	// MHD writes the header names as they have been added
+	const std::size_t etagPos = data.find("\r\nETag: ");
+	if(etagPos != std::string::npos && etagPos < headerEnd) {
+		const std::size_t valuePos = etagPos + 8;
+		response.etag = data.substr(valuePos, data.find("\r\n", valuePos) - valuePos);
+	}
+	return response;
+}
+
+class Client {
+public:
+	Client(std::uint16_t port, const char* hostname, const char* priorities) {
+		fd = ::socket(AF_INET, SOCK_STREAM, 0);
+		if(fd < 0) {
+			throw std::runtime_error("Cannot create socket");
+		}
+
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(port);
+		if(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+			::close(fd);
+			throw std::runtime_error("Cannot connect to loopback address");
+		}
+
+		gnutls_certificate_allocate_credentials(&credentials);
+		gnutls_init(&session, GNUTLS_CLIENT);
+		check(gnutls_server_name_set(session, GNUTLS_NAME_DNS, hostname, std::string(hostname).size()), "Cannot set server name");
+		check(gnutls_credentials_set(session, GNUTLS_CRD_CERTIFICATE, credentials), "Cannot set client credentials");
+		check(gnutls_priority_set_direct(session, priorities, nullptr), "Cannot set client priorities");
+		gnutls_transport_set_int(session, fd);
+	}
+
+	~Client() {
+		gnutls_deinit(session);
+		gnutls_certificate_free_credentials(credentials);
+		::close(fd);
+	}
+
+	int handshake() {
+		int rc;
+		do {
+			rc = gnutls_handshake(session);
+		} while(rc < 0 && !gnutls_error_is_fatal(rc));
+		return rc;
+	}
+
+	std::string getDescription() {
+		char* desc = gnutls_session_get_desc(session);
+		std::string description = desc ? desc : "";
+		gnutls_free(desc);
+		return description;
+	}
+
+	/* sends a request and returns the status line of the response */
+	std::string get(const std::string& path) {
+		const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+		check(static_cast<int>(gnutls_record_send(session, request.data(), request.size())), "Cannot send request");
+
+		std::string response;
+		while(response.find("\r\n") == std::string::npos) {
+			char buffer[1024];
+			ssize_t rc = gnutls_record_recv(session, buffer, sizeof(buffer));
+			if(rc < 0 && !gnutls_error_is_fatal(static_cast<int>(rc))) {
+				continue;
+			}
+			check(static_cast<int>(rc), "Cannot receive response");
+			if(rc == 0) {
+				break;
+			}
+			response.append(buffer, static_cast<std::size_t>(rc));
+		}
+		return response.substr(0, response.find("\r\n"));
+	}
+
+private:
+	int fd;
+	gnutls_certificate_credentials_t credentials;
+	gnutls_session_t session;
+};
+
+} /* anonymous namespace */
+
+/* The certificate callback and the ClientHello hook find the connection of the TLS session of MHD,
+ * so the certificate for the server name is chosen by the signature algorithms of the client. */
+MHD4ESL_TEST(socketTlsHandshake) {
+	Handler handler;
+	Server server(createHttpsSettings(), handler);
+
+	{
+		Client client(server.port, "localhost", "NORMAL");
+		MHD4ESL_CHECK(client.handshake() == GNUTLS_E_SUCCESS);
+		MHD4ESL_CHECK(client.getDescription().find("ECDSA") != std::string::npos);
+		MHD4ESL_CHECK(client.get("/").compare(0, 9, "HTTP/1.1 ") == 0);
+	}
+
+	{
+		Client client(server.port, "localhost", rsaOnly);
+		MHD4ESL_CHECK(client.handshake() == GNUTLS_E_SUCCESS);
+		MHD4ESL_CHECK(client.getDescription().find("RSA") != std::string::npos);
+		MHD4ESL_CHECK(client.getDescription().find("ECDSA") == std::string::npos);
+		MHD4ESL_CHECK(client.get("/").compare(0, 9, "HTTP/1.1 ") == 0);
+	}
+
+	{
+		Client client(server.port, "example.com", "NORMAL");
+		MHD4ESL_CHECK(client.handshake() < 0);
+	}
+}
+
+/* Cached responses and responses captured by the cache get an ETag and are answered with 304 on a match,
+ * no matter if they are sent by a hit or by the miss that has called the request handler. */
+MHD4ESL_TEST(socketResponseCacheWithAutoETag) {
+	HelloHandler helloHandler;
+	esl::com::http::server::MHDResponseCache responseCache(esl::com::http::server::MHDResponseCache::Settings(), helloHandler);
+	Server server({ { "auto-etag", "true" } }, responseCache);
+	const std::string etag = ETag::create("Hello", 5);
+
+	// miss that fills the cache and hit
+	HttpResponse response = httpGet(server.port, "/cached");
+	MHD4ESL_CHECK(response.statusLine == "HTTP/1.1 200 OK");
+	MHD4ESL_CHECK(response.etag == etag);
+	MHD4ESL_CHECK(response.body == "Hello");
+
+	response = httpGet(server.port, "/cached");
+	MHD4ESL_CHECK(response.statusLine == "HTTP/1.1 200 OK");
+	MHD4ESL_CHECK(response.etag == etag);
+	MHD4ESL_CHECK(response.body == "Hello");
+	MHD4ESL_CHECK(helloHandler.calls == 1);
+
+	// hit with a matching and with another ETag
+	response = httpGet(server.port, "/cached", etag);
+	MHD4ESL_CHECK(response.statusLine == "HTTP/1.1 304 Not Modified");
+	MHD4ESL_CHECK(response.etag == etag);
+	MHD4ESL_CHECK(response.body.empty());
+
+	response = httpGet(server.port, "/cached", "\"other\"");
+	MHD4ESL_CHECK(response.statusLine == "HTTP/1.1 200 OK");
+	MHD4ESL_CHECK(helloHandler.calls == 1);
+
+	// miss that fills the cache with a matching ETag
+	response = httpGet(server.port, "/cached?page=2", etag);
+	MHD4ESL_CHECK(response.statusLine == "HTTP/1.1 304 Not Modified");
+	MHD4ESL_CHECK(response.etag == etag);
+	MHD4ESL_CHECK(helloHandler.calls == 2);
+
+	// response that cannot be cached
+	response = httpGet(server.port, "/uncached");
+	MHD4ESL_CHECK(response.statusLine == "HTTP/1.1 200 OK");
+	MHD4ESL_CHECK(response.etag == etag);
+
+	response = httpGet(server.port, "/uncached", etag);
+	MHD4ESL_CHECK(response.statusLine == "HTTP/1.1 304 Not Modified");
+	MHD4ESL_CHECK(response.etag == etag);
+	MHD4ESL_CHECK(helloHandler.calls == 4);
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */
@@ -0,0 +1,246 @@
+/*
+ * This file is part of mhd4esl.
+ * Copyright (C) 2019-2023 Sven Lukas
+ *
+ * Mhd4esl is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Mhd4esl is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with mhd4esl.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mhd4esl/Test.h>
+#include <mhd4esl/com/http/server/WebSocketFrameParser.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mhd4esl {
+inline namespace v1_6 {
+namespace com {
+namespace http {
+namespace server {
+
+namespace {
+
+/* records everything the parser delivers as "<kind>:<payload>" */
+class Frames : public WebSocketFrameParser {
+public:
+	Frames(std::size_t maxMessageSize = 1024)
+	: WebSocketFrameParser(maxMessageSize)
+	{ }
+
+	bool add(const std::string& data) {
+		input += data;
+		return processFrames(input);
+	}
+
+	std::string input;
+	std::vector<std::string> events;
+	std::uint16_t failCode = 0;
+
+private:
+	bool processControlFrame(unsigned char opcode, const unsigned char* payload, std::size_t size) noexcept override {
+		events.push_back((opcode == ping ? "ping:" : opcode == pong ? "pong:" : "close:") + std::string(reinterpret_cast<const char*>(payload), size));
+		return opcode != closeFrame;
+	}
+
+	bool deliverMessage(const std::string& message, bool isBinary) noexcept override {
+		events.push_back((isBinary ? "binary:" : "text:") + message);
+		return true;
+	}
+
+	void fail(std::uint16_t code) noexcept override {
+		failCode = code;
+	}
+};
+
+/* creates a frame of a client, masked unless maskingKey is nullptr */
+std::string createFrame(bool fin, unsigned char opcode, const std::string& payload, const char* maskingKey = "\x12\x34\x56\x78") {
+	std::string frame;
+	frame += static_cast<char>((fin ? 0x80 : 0x00) | opcode);
+
+	const unsigned char maskBit = maskingKey ? 0x80 : 0x00;
+	if(payload.size() < 126) {
+		frame += static_cast<char>(maskBit | payload.size());
+	}
+	else if(payload.size() <= 0xFFFF) {
+		frame += static_cast<char>(maskBit | 126);
+		frame += static_cast<char>(payload.size() >> 8);
+		frame += static_cast<char>(payload.size() & 0xFF);
+	}
+	else {
+		frame += static_cast<char>(maskBit | 127);
+		for(int i = 7; i >= 0; --i) {
+			frame += static_cast<char>((static_cast<std::uint64_t>(payload.size()) >> (8 * i)) & 0xFF);
+		}
+	}
+
+	if(maskingKey == nullptr) {
+		return frame + payload;
+	}
+
+	frame.append(maskingKey, 4);
+	for(std::size_t i = 0; i < payload.size(); ++i) {
+		frame += static_cast<char>(payload[i] ^ maskingKey[i & 3]);
+	}
+	return frame;
+}
+
+} /* anonymous namespace */
+
+MHD4ESL_TEST(webSocketMask) {
+	const std::string payload = "Hello, WebSocket frame with more than 8 bytes";
+	std::string data = payload;
+	const unsigned char key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+	WebSocketFrameParser::mask(reinterpret_cast<unsigned char*>(&data[0]), data.size(), key);
+	for(std::size_t i = 0; i < data.size(); ++i) {
+		MHD4ESL_CHECK(static_cast<unsigned char>(data[i]) == (static_cast<unsigned char>(payload[i]) ^ key[i % 4]));
+	}
+
+	WebSocketFrameParser::mask(reinterpret_cast<unsigned char*>(&data[0]), data.size(), key);
+	MHD4ESL_CHECK(data == payload);
+}
+
+MHD4ESL_TEST(webSocketFrames) {
+	Frames frames;
+	MHD4ESL_CHECK(frames.add(createFrame(true, 0x1, "Hello") + createFrame(true, 0x2, std::string("\x00\xff", 2))));
+	MHD4ESL_CHECK(frames.events.size() == 2);
+	MHD4ESL_CHECK(frames.events[0] == "text:Hello");
+	MHD4ESL_CHECK(frames.events[1] == std::string("binary:\x00\xff", 9));
+	MHD4ESL_CHECK(frames.input.empty());
+	MHD4ESL_CHECK(frames.failCode == 0);
+}
+
+MHD4ESL_TEST(webSocketFramesUnmasked) {
+	Frames frames;
+	MHD4ESL_CHECK(!frames.add(createFrame(true, 0x1, "Hello", nullptr)));
+	MHD4ESL_CHECK(frames.failCode == 1002);
+	MHD4ESL_CHECK(frames.events.empty());
+}
+
+MHD4ESL_TEST(webSocketFramesReservedBits) {
+	std::string frame = createFrame(true, 0x1, "Hello");
+	frame[0] = static_cast<char>(frame[0] | 0x40);
+
+	Frames frames;
+	MHD4ESL_CHECK(!frames.add(frame));
+	MHD4ESL_CHECK(frames.failCode == 1002);
+}
+
+MHD4ESL_TEST(webSocketFramesExtendedLengths) {
+	const std::string payload16(300, 'a');
+	const std::string payload64(70000, 'b');
+
+	Frames frames(100000);
+	MHD4ESL_CHECK(frames.add(createFrame(true, 0x2, payload16) + createFrame(true, 0x2, payload64)));
+	MHD4ESL_CHECK(frames.events.size() == 2);
+	MHD4ESL_CHECK(frames.events[0] == "binary:" + payload16);
+	MHD4ESL_CHECK(frames.events[1] == "binary:" + payload64);
+	MHD4ESL_CHECK(frames.failCode == 0);
+}
+
+/* frames are delivered only when they are complete, whatever the size of the reads */
+MHD4ESL_TEST(webSocketFramesPartial) {
+	const std::string data = createFrame(true, 0x1, std::string(300, 'a')) + createFrame(true, 0x1, std::string(70000, 'b'));
+
+	Frames frames(100000);
+	for(std::size_t pos = 0; pos < data.size(); pos += 7) {
+		MHD4ESL_CHECK(frames.add(data.substr(pos, 7)));
+		MHD4ESL_CHECK(frames.events.size() == (pos + 7 < 306 ? 0 : (pos + 7 < data.size() ? 1 : 2)));
+	}
+	MHD4ESL_CHECK(frames.events.size() == 2);
+	MHD4ESL_CHECK(frames.input.empty());
+}
+
+MHD4ESL_TEST(webSocketFramesFragmented) {
+	Frames frames;
+	MHD4ESL_CHECK(frames.add(createFrame(false, 0x1, "Hel")));
+	MHD4ESL_CHECK(frames.add(createFrame(false, 0x0, "lo, ")));
+	MHD4ESL_CHECK(frames.events.empty());
+
+	// control frames may be sent between the fragments of a message
+	MHD4ESL_CHECK(frames.add(createFrame(true, 0x9, "ping") + createFrame(true, 0xA, "pong")));
+	MHD4ESL_CHECK(frames.add(createFrame(true, 0x0, "World")));
+
+	MHD4ESL_CHECK(frames.events.size() == 3);
+	MHD4ESL_CHECK(frames.events[0] == "ping:ping");
+	MHD4ESL_CHECK(frames.events[1] == "pong:pong");
+	MHD4ESL_CHECK(frames.events[2] == "text:Hello, World");
+
+	// the next message starts from scratch
+	MHD4ESL_CHECK(frames.add(createFrame(true, 0x2, "next")));
+	MHD4ESL_CHECK(frames.events.back() == "binary:next");
+	MHD4ESL_CHECK(frames.failCode == 0);
+}
+
+MHD4ESL_TEST(webSocketFramesInvalidFragments) {
+	// continuation without a message
+	Frames frames1;
+	MHD4ESL_CHECK(!frames1.add(createFrame(true, 0x0, "x")));
+	MHD4ESL_CHECK(frames1.failCode == 1002);
+
+	// new message before the last fragment of the previous one
+	Frames frames2;
+	MHD4ESL_CHECK(frames2.add(createFrame(false, 0x1, "x")));
+	MHD4ESL_CHECK(!frames2.add(createFrame(true, 0x2, "y")));
+	MHD4ESL_CHECK(frames2.failCode == 1002);
+
+	// reserved opcode of data frames
+	Frames frames3;
+	MHD4ESL_CHECK(!frames3.add(createFrame(true, 0x3, "x")));
+	MHD4ESL_CHECK(frames3.failCode == 1002);
+}
+
+MHD4ESL_TEST(webSocketFramesControlFrames) {
+	// a close frame stops parsing, the data behind stays in the input
+	Frames frames;
+	const std::string trailer = createFrame(true, 0x1, "ignored");
+	MHD4ESL_CHECK(!frames.add(createFrame(true, 0x8, "\x03\xe8") + trailer));
+	MHD4ESL_CHECK(frames.events.size() == 1);
+	MHD4ESL_CHECK(frames.events[0] == "close:\x03\xe8");
+	MHD4ESL_CHECK(frames.failCode == 0);
+
+	// control frames must not have more than 125 bytes
+	Frames frames1;
+	MHD4ESL_CHECK(frames1.add(createFrame(true, 0x9, std::string(125, 'p'))));
+	MHD4ESL_CHECK(!frames1.add(createFrame(true, 0x9, std::string(126, 'p'))));
+	MHD4ESL_CHECK(frames1.failCode == 1002);
+	MHD4ESL_CHECK(frames1.events.size() == 1);
+
+	// and must not be fragmented
+	Frames frames2;
+	MHD4ESL_CHECK(!frames2.add(createFrame(false, 0x9, "p")));
+	MHD4ESL_CHECK(frames2.failCode == 1002);
+}
+
+MHD4ESL_TEST(webSocketFramesMaxMessageSize) {
+	Frames frames(10);
+	MHD4ESL_CHECK(frames.add(createFrame(true, 0x1, std::string(10, 'a'))));
+	MHD4ESL_CHECK(frames.events.size() == 1);
+
+	// the limit applies to the reassembled message and is checked before the payload has been received
+	MHD4ESL_CHECK(frames.add(createFrame(false, 0x1, std::string(6, 'a'))));
+	MHD4ESL_CHECK(!frames.add(createFrame(true, 0x0, std::string(5, 'a')).substr(0, 2)));
+	MHD4ESL_CHECK(frames.failCode == 1009);
+	MHD4ESL_CHECK(frames.events.size() == 1);
+
+	Frames frames1(1000);
+	MHD4ESL_CHECK(!frames1.add(createFrame(true, 0x2, std::string(70000, 'b')).substr(0, 10)));
+	MHD4ESL_CHECK(frames1.failCode == 1009);
+}
+
+} /* namespace server */
+} /* namespace http */
+} /* namespace com */
+} /* inline namespace v1_6 */
+} /* namespace mhd4esl */